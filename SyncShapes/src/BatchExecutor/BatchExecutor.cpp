@@ -0,0 +1,150 @@
+#include "BatchExecutor.h"
+
+#include <algorithm>
+#include <exception>
+#include <thread>
+
+namespace SyncShapes
+{
+	BatchExecutor::BatchExecutor(unsigned int workerCount) : m_WorkerCount(ResolveWorkerCount(workerCount)), m_Queues(m_WorkerCount) {}
+	BatchExecutor::~BatchExecutor() {}
+
+	unsigned int BatchExecutor::ResolveWorkerCount(unsigned int requested)
+	{
+		if (requested > 0)
+			return requested;
+
+		unsigned int hardwareThreads = std::thread::hardware_concurrency();
+		return hardwareThreads > 0 ? hardwareThreads : 1;
+	}
+
+	BatchReport BatchExecutor::Run(const std::vector<std::string>& paths, const BatchTask& task, BatchProgress* progress)
+	{
+		return RunItems(paths.size(), [&paths, &task](size_t index, std::string& error) { return task(index, paths[index], error); },
+			[&paths](size_t index) { return paths[index]; }, progress);
+	}
+
+	BatchReport BatchExecutor::Run(size_t count, const IndexTask& task, BatchProgress* progress)
+	{
+		return RunItems(count, task, [](size_t index) { return "item " + std::to_string(index); }, progress);
+	}
+
+	BatchReport BatchExecutor::RunItems(size_t count, const IndexTask& task, const std::function<std::string(size_t)>& describe, BatchProgress* progress)
+	{
+		BatchReport report;
+		report.total = count;
+
+		if (count == 0)
+			return report;
+
+		if (progress)
+			progress->total.fetch_add(count);
+
+		// Deal contiguous slices to the workers so neighbouring files start on the same core, stealing evens out the rest
+		size_t sliceSize = (count + m_WorkerCount - 1) / m_WorkerCount;
+		for (unsigned int worker = 0; worker < m_WorkerCount; ++worker) {
+			std::lock_guard<std::mutex> lock(m_Queues[worker].mutex);
+			m_Queues[worker].items.clear();
+
+			size_t begin = std::min(count, worker * sliceSize);
+			size_t end = std::min(count, begin + sliceSize);
+			for (size_t i = begin; i < end; ++i)
+				m_Queues[worker].items.push_back(i);
+		}
+
+		std::mutex failuresMutex;
+		std::atomic<size_t> succeeded(0);
+		std::atomic<size_t> cancelled(0);
+
+		unsigned int threadCount = static_cast<unsigned int>(std::min<size_t>(m_WorkerCount, count));
+		if (threadCount <= 1) {
+			// A single worker drains its own queue and then steals the rest, which is exactly the serial path
+			WorkerLoop(0, task, describe, progress, report.failures, failuresMutex, succeeded, cancelled);
+		}
+		else {
+			std::vector<std::thread> threads;
+			threads.reserve(threadCount);
+			for (unsigned int worker = 0; worker < threadCount; ++worker)
+				threads.emplace_back(&BatchExecutor::WorkerLoop, this, worker, std::cref(task), std::cref(describe), progress, std::ref(report.failures), std::ref(failuresMutex), std::ref(succeeded), std::ref(cancelled));
+
+			for (auto& thread : threads)
+				thread.join();
+		}
+
+		report.succeeded = succeeded.load();
+		report.cancelled = cancelled.load();
+
+		// Workers finish in arbitrary order, keep the report stable between runs
+		std::sort(report.failures.begin(), report.failures.end(), [](const BatchFailure& a, const BatchFailure& b) {
+			return a.path < b.path;
+			});
+
+		return report;
+	}
+
+	bool BatchExecutor::PopLocal(unsigned int worker, size_t& item)
+	{
+		std::lock_guard<std::mutex> lock(m_Queues[worker].mutex);
+		if (m_Queues[worker].items.empty())
+			return false;
+
+		item = m_Queues[worker].items.back();
+		m_Queues[worker].items.pop_back();
+		return true;
+	}
+
+	bool BatchExecutor::Steal(unsigned int thief, size_t& item)
+	{
+		for (unsigned int offset = 1; offset < m_WorkerCount; ++offset) {
+			WorkQueue& victim = m_Queues[(thief + offset) % m_WorkerCount];
+
+			std::lock_guard<std::mutex> lock(victim.mutex);
+			if (!victim.items.empty()) {
+				item = victim.items.front();
+				victim.items.pop_front();
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	void BatchExecutor::WorkerLoop(unsigned int worker, const IndexTask& task, const std::function<std::string(size_t)>& describe, BatchProgress* progress, std::vector<BatchFailure>& failures, std::mutex& failuresMutex, std::atomic<size_t>& succeeded, std::atomic<size_t>& cancelled)
+	{
+		size_t item;
+
+		// Items are never re-queued, so once every queue is empty the batch is drained
+		while (PopLocal(worker, item) || Steal(worker, item)) {
+			// Draining the queues after a cancellation keeps the counts exact
+			if (progress && progress->IsCancelled()) {
+				cancelled.fetch_add(1, std::memory_order_relaxed);
+				progress->completed.fetch_add(1, std::memory_order_relaxed);
+				continue;
+			}
+
+			std::string error;
+			bool ok = false;
+
+			try {
+				ok = task(item, error);
+			}
+			catch (const std::exception& e) {
+				error = e.what();
+			}
+			catch (...) {
+				error = "Unknown exception";
+			}
+
+			if (ok) {
+				succeeded.fetch_add(1, std::memory_order_relaxed);
+			}
+			else {
+				std::lock_guard<std::mutex> lock(failuresMutex);
+				failures.push_back({ describe(item), error.empty() ? "Unknown error" : error });
+			}
+
+			if (progress)
+				progress->completed.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace SyncShapes
+{
+	struct BatchFailure
+	{
+		std::string path;
+		std::string reason;
+	};
+
+	struct BatchReport
+	{
+		size_t total = 0;
+		size_t succeeded = 0;
+		size_t cancelled = 0; // Skipped after a cancellation request, neither succeeded nor failed
+		std::vector<BatchFailure> failures;
+	};
+
+	// Live progress of the batches of one job, written by the workers and read by an observer on another thread.
+	// Consecutive batches add to 'total', so a job made of several passes reports one combined figure.
+	struct BatchProgress
+	{
+		std::atomic<size_t> total{ 0 };
+		std::atomic<size_t> completed{ 0 };
+		std::atomic<bool> cancelRequested{ false };
+
+		inline void Reset() { total = 0; completed = 0; cancelRequested = false; }
+		inline bool IsCancelled() const { return cancelRequested.load(std::memory_order_relaxed); }
+	};
+
+	// Runs one task per input file. Returning false (or throwing) marks the file as failed, with the reason taken from 'error'.
+	using BatchTask = std::function<bool(size_t index, const std::string& path, std::string& error)>;
+	// Runs one task per index in [0, count), for work that is not a list of files
+	using IndexTask = std::function<bool(size_t index, std::string& error)>;
+
+	class BatchExecutor
+	{
+	public:
+		// A worker count of 0 uses one worker per hardware thread
+		explicit BatchExecutor(unsigned int workerCount = 0);
+		~BatchExecutor();
+
+		// 'progress' is optional, once it is cancelled the remaining items are skipped
+		BatchReport Run(const std::vector<std::string>& paths, const BatchTask& task, BatchProgress* progress = nullptr);
+		// Failures are reported as "item <index>"
+		BatchReport Run(size_t count, const IndexTask& task, BatchProgress* progress = nullptr);
+
+		inline unsigned int GetWorkerCount() const { return m_WorkerCount; }
+		static unsigned int ResolveWorkerCount(unsigned int requested);
+	private:
+		// Each worker owns a deque of item indices: it pops from the back of its own queue and steals from the front of the others
+		struct WorkQueue
+		{
+			std::mutex mutex;
+			std::deque<size_t> items;
+		};
+
+		unsigned int m_WorkerCount;
+		std::vector<WorkQueue> m_Queues;
+
+		bool PopLocal(unsigned int worker, size_t& item);
+		bool Steal(unsigned int thief, size_t& item);
+		BatchReport RunItems(size_t count, const IndexTask& task, const std::function<std::string(size_t)>& describe, BatchProgress* progress);
+		void WorkerLoop(unsigned int worker, const IndexTask& task, const std::function<std::string(size_t)>& describe, BatchProgress* progress, std::vector<BatchFailure>& failures, std::mutex& failuresMutex, std::atomic<size_t>& succeeded, std::atomic<size_t>& cancelled);
+	};
+}
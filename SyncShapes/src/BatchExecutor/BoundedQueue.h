@@ -0,0 +1,66 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+namespace SyncShapes
+{
+	// Blocking queue between the stages of a streaming pass. Push waits while 'capacity' items are queued,
+	// so a fast producer cannot run ahead of its consumers by more than that.
+	// Once closed, Push refuses new items and Pop drains what is left, then returns false.
+	template<typename T>
+	class BoundedQueue
+	{
+	public:
+		explicit BoundedQueue(size_t capacity) : m_Capacity(capacity > 0 ? capacity : 1), m_Closed(false) {}
+
+		BoundedQueue(const BoundedQueue&) = delete;
+		BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+		bool Push(T item)
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			m_NotFull.wait(lock, [this] { return m_Closed || m_Items.size() < m_Capacity; });
+			if (m_Closed)
+				return false;
+
+			m_Items.push_back(std::move(item));
+			lock.unlock();
+			m_NotEmpty.notify_one();
+			return true;
+		}
+
+		bool Pop(T& item)
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			m_NotEmpty.wait(lock, [this] { return m_Closed || !m_Items.empty(); });
+			if (m_Items.empty())
+				return false;
+
+			item = std::move(m_Items.front());
+			m_Items.pop_front();
+			lock.unlock();
+			m_NotFull.notify_one();
+			return true;
+		}
+
+		void Close()
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_Mutex);
+				m_Closed = true;
+			}
+
+			m_NotEmpty.notify_all();
+			m_NotFull.notify_all();
+		}
+	private:
+		std::mutex m_Mutex;
+		std::condition_variable m_NotEmpty;
+		std::condition_variable m_NotFull;
+		std::deque<T> m_Items;
+		size_t m_Capacity;
+		bool m_Closed;
+	};
+}
@@ -0,0 +1,106 @@
+#include "FilePrefetcher.h"
+#include "Profiler/Profiler.h"
+
+#include <algorithm>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace SyncShapes
+{
+	FilePrefetcher::FilePrefetcher(const std::vector<std::string>& paths, size_t depth) : m_Paths(paths), m_Depth(depth), m_Advised(0) {}
+
+	bool FilePrefetcher::Read(size_t index, std::vector<uint8_t>& bytes)
+	{
+		SS_PROFILE_SCOPE("read_file");
+
+		size_t adviseEnd = std::min(m_Paths.size(), index + 1 + m_Depth);
+		for (m_Advised = std::max(m_Advised, index + 1); m_Advised < adviseEnd; ++m_Advised)
+			Advise(m_Paths[m_Advised]);
+
+		return ReadFile(m_Paths[index], bytes);
+	}
+
+#ifdef _WIN32
+	void FilePrefetcher::Advise(const std::string& path)
+	{
+		// No per-file read-ahead hint without keeping a handle open, the sequential scan flag on the read covers the file itself
+		(void)path;
+	}
+
+	bool FilePrefetcher::ReadFile(const std::string& path, std::vector<uint8_t>& bytes)
+	{
+		HANDLE fileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+		if (fileHandle == INVALID_HANDLE_VALUE)
+			return false;
+
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(fileHandle, &fileSize)) {
+			CloseHandle(fileHandle);
+			return false;
+		}
+
+		bytes.resize(static_cast<size_t>(fileSize.QuadPart));
+		size_t offset = 0;
+		while (offset < bytes.size()) {
+			DWORD chunk = static_cast<DWORD>(std::min<size_t>(bytes.size() - offset, 1 << 30));
+			DWORD bytesRead = 0;
+			if (!::ReadFile(fileHandle, bytes.data() + offset, chunk, &bytesRead, NULL) || bytesRead == 0)
+				break;
+			offset += bytesRead;
+		}
+
+		CloseHandle(fileHandle);
+		return offset == bytes.size();
+	}
+#else
+	void FilePrefetcher::Advise(const std::string& path)
+	{
+		int fileDescriptor = open(path.c_str(), O_RDONLY);
+		if (fileDescriptor < 0)
+			return;
+
+#ifdef POSIX_FADV_WILLNEED
+		// Starts the read-ahead and returns, the pages stay in the page cache after the descriptor is closed
+		posix_fadvise(fileDescriptor, 0, 0, POSIX_FADV_WILLNEED);
+#endif
+		close(fileDescriptor);
+	}
+
+	bool FilePrefetcher::ReadFile(const std::string& path, std::vector<uint8_t>& bytes)
+	{
+		int fileDescriptor = open(path.c_str(), O_RDONLY);
+		if (fileDescriptor < 0)
+			return false;
+
+		struct stat fileStat;
+		if (fstat(fileDescriptor, &fileStat) != 0) {
+			close(fileDescriptor);
+			return false;
+		}
+
+		bytes.resize(static_cast<size_t>(fileStat.st_size));
+		size_t offset = 0;
+		while (offset < bytes.size()) {
+			ssize_t bytesRead = read(fileDescriptor, bytes.data() + offset, bytes.size() - offset);
+			if (bytesRead < 0 && errno == EINTR)
+				continue;
+			if (bytesRead <= 0)
+				break;
+			offset += static_cast<size_t>(bytesRead);
+		}
+
+		close(fileDescriptor);
+		return offset == bytes.size();
+	}
+#endif
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace SyncShapes
+{
+	// Reads the files of a streaming pass whole, in list order. Each read first advises the kernel of the next
+	// 'depth' files, so their pages are fetched in the background while the current one is being processed.
+	class FilePrefetcher
+	{
+	public:
+		// 'paths' must outlive the prefetcher
+		FilePrefetcher(const std::vector<std::string>& paths, size_t depth);
+
+		bool Read(size_t index, std::vector<uint8_t>& bytes);
+
+		// posix_fadvise(WILLNEED) where available, a no-op elsewhere
+		static void Advise(const std::string& path);
+		static bool ReadFile(const std::string& path, std::vector<uint8_t>& bytes);
+	private:
+		const std::vector<std::string>& m_Paths;
+		size_t m_Depth;
+		size_t m_Advised; // Files before this index have been advised already
+	};
+}
@@ -0,0 +1,412 @@
+#include "ClusterIndex.h"
+#include "HnswIndex.h"
+#include "HuDistance.h"
+#include "BatchExecutor/BatchExecutor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <random>
+
+namespace SyncShapes
+{
+	namespace
+	{
+		const char ClusterMagic[4] = { 'S', 'S', 'I', 'V' };
+		const uint32_t ClusterVersion = 1;
+
+		// Training sample per centroid, more barely moves the centroids but makes every pass slower
+		const size_t SamplesPerCluster = 64;
+		const size_t ContoursPerTask = 4096;
+
+		template <typename T>
+		inline void WriteValue(std::ofstream& stream, const T& value)
+		{
+			stream.write(reinterpret_cast<const char*>(&value), sizeof(T));
+		}
+
+		template <typename T>
+		inline bool ReadValue(std::ifstream& stream, T& value)
+		{
+			return static_cast<bool>(stream.read(reinterpret_cast<char*>(&value), sizeof(T)));
+		}
+
+		// Bytes between the read position and the end of the file, the bound for any count read from it
+		inline uint64_t RemainingBytes(std::ifstream& stream)
+		{
+			std::streampos position = stream.tellg();
+			stream.seekg(0, std::ios::end);
+			std::streampos end = stream.tellg();
+			stream.seekg(position);
+			return position >= 0 && end >= position ? static_cast<uint64_t>(end - position) : 0;
+		}
+
+		inline bool IsFinite(const double* vector)
+		{
+			for (size_t i = 0; i < FeatureStore::Dimension; ++i) {
+				if (!std::isfinite(vector[i]))
+					return false;
+			}
+
+			return true;
+		}
+
+		// Calls task(slice, begin, end) for slices of [first, count) on the worker pool. Returns false if a slice threw.
+		bool RunSlices(size_t first, size_t count, unsigned int workerCount, const std::function<void(size_t slice, size_t begin, size_t end)>& task)
+		{
+			size_t sliceCount = count > first ? (count - first + ContoursPerTask - 1) / ContoursPerTask : 0;
+
+			BatchExecutor executor(workerCount);
+			BatchReport report = executor.Run(sliceCount, [&](size_t slice, std::string&) {
+				size_t begin = first + slice * ContoursPerTask;
+				task(slice, begin, std::min(count, begin + ContoursPerTask));
+				return true;
+				});
+
+			for (const auto& failure : report.failures)
+				std::cerr << "Cluster index: contour slice " << failure.path << " failed: " << failure.reason << std::endl;
+
+			return report.failures.empty();
+		}
+	}
+
+	ClusterIndex::ClusterIndex() : m_TrainingSize(0) {}
+	ClusterIndex::~ClusterIndex() {}
+
+	void ClusterIndex::Reset(const ClusterParameters& parameters)
+	{
+		m_Parameters = parameters;
+		m_TrainingSize = 0;
+		m_Centroids.clear();
+		m_Assignments.clear();
+		m_ClusterImages.clear();
+		m_ImageClusters.clear();
+	}
+
+	bool ClusterIndex::Build(const FeatureMatrix& matrix, unsigned int workerCount)
+	{
+		Reset(m_Parameters);
+
+		const size_t contourCount = matrix.GetContourCount();
+		if (contourCount == 0)
+			return true;
+
+		// Contours with an infinite moment (degenerate shapes) would drag any centroid they join to infinity
+		std::vector<size_t> sample;
+		for (size_t contour = 0; contour < contourCount; ++contour) {
+			if (IsFinite(matrix.GetContour(contour)))
+				sample.push_back(contour);
+		}
+
+		size_t clusterCount = m_Parameters.clusterCount > 0 ? m_Parameters.clusterCount : static_cast<size_t>(std::sqrt(static_cast<double>(contourCount)));
+		clusterCount = std::max<size_t>(1, std::min(clusterCount, std::max<size_t>(sample.size(), 1)));
+
+		std::mt19937_64 random(m_Parameters.seed);
+		if (sample.size() > clusterCount * SamplesPerCluster) {
+			std::shuffle(sample.begin(), sample.end(), random);
+			sample.resize(clusterCount * SamplesPerCluster);
+			std::sort(sample.begin(), sample.end());
+		}
+
+		m_Centroids.assign(clusterCount * Stride, 0.0);
+
+		if (!sample.empty()) {
+			// k-means++ seeding: every next centroid is drawn with probability proportional to the squared distance to the nearest one so far
+			std::vector<double> nearest(sample.size(), std::numeric_limits<double>::infinity());
+			size_t chosen = std::uniform_int_distribution<size_t>(0, sample.size() - 1)(random);
+
+			for (size_t cluster = 0; cluster < clusterCount; ++cluster) {
+				std::copy_n(matrix.GetContour(sample[chosen]), Stride, m_Centroids.data() + cluster * Stride);
+
+				double total = 0.0;
+				for (size_t point = 0; point < sample.size(); ++point) {
+					double distance = HuDistance::Distance(matrix.GetContour(sample[point]), GetCentroid(cluster));
+					nearest[point] = std::min(nearest[point], distance * distance);
+					total += nearest[point];
+				}
+
+				if (total <= 0.0) {
+					chosen = std::uniform_int_distribution<size_t>(0, sample.size() - 1)(random);
+					continue;
+				}
+
+				double target = std::uniform_real_distribution<double>(0.0, total)(random);
+				for (chosen = 0; chosen + 1 < sample.size(); ++chosen) {
+					target -= nearest[chosen];
+					if (target < 0.0)
+						break;
+				}
+			}
+
+			// Lloyd iterations on the sample, every slice accumulates its own sums which are reduced afterwards
+			const size_t sliceCount = (sample.size() + ContoursPerTask - 1) / ContoursPerTask;
+			std::vector<uint32_t> sampleClusters(sample.size(), NoCluster);
+			std::vector<std::vector<double>> sliceSums(sliceCount);
+			std::vector<std::vector<size_t>> sliceCounts(sliceCount);
+
+			for (uint32_t iteration = 0; iteration < m_Parameters.iterations; ++iteration) {
+				std::vector<size_t> sliceChanges(sliceCount, 0);
+
+				bool assigned = RunSlices(0, sample.size(), workerCount, [&](size_t slice, size_t begin, size_t end) {
+					sliceSums[slice].assign(clusterCount * Stride, 0.0);
+					sliceCounts[slice].assign(clusterCount, 0);
+
+					for (size_t point = begin; point < end; ++point) {
+						const double* vector = matrix.GetContour(sample[point]);
+						uint32_t cluster = FindNearest(vector);
+						sliceChanges[slice] += cluster != sampleClusters[point] ? 1 : 0;
+						sampleClusters[point] = cluster;
+
+						++sliceCounts[slice][cluster];
+						for (size_t i = 0; i < Stride; ++i)
+							sliceSums[slice][cluster * Stride + i] += vector[i];
+					}
+					});
+
+				// Sums of a failed slice are missing, the centroids would be wrong
+				if (!assigned) {
+					Reset(m_Parameters);
+					return false;
+				}
+
+				for (size_t cluster = 0; cluster < clusterCount; ++cluster) {
+					size_t count = 0;
+					double sum[Stride] = {};
+					for (size_t slice = 0; slice < sliceCount; ++slice) {
+						count += sliceCounts[slice][cluster];
+						for (size_t i = 0; i < Stride; ++i)
+							sum[i] += sliceSums[slice][cluster * Stride + i];
+					}
+
+					// An empty cluster restarts from a random sample contour
+					double* centroid = m_Centroids.data() + cluster * Stride;
+					if (count == 0) {
+						size_t point = std::uniform_int_distribution<size_t>(0, sample.size() - 1)(random);
+						std::copy_n(matrix.GetContour(sample[point]), Stride, centroid);
+						continue;
+					}
+
+					for (size_t i = 0; i < Stride; ++i)
+						centroid[i] = sum[i] / static_cast<double>(count);
+				}
+
+				size_t changes = 0;
+				for (size_t sliceChange : sliceChanges)
+					changes += sliceChange;
+				if (changes == 0)
+					break;
+			}
+		}
+
+		m_TrainingSize = contourCount;
+		if (!Assign(matrix, 0, workerCount)) {
+			Reset(m_Parameters);
+			return false;
+		}
+
+		BuildLists(matrix);
+		return true;
+	}
+
+	std::vector<size_t> ClusterIndex::FindCandidates(const double* query, size_t queryCount, size_t probeCount) const
+	{
+		std::vector<size_t> candidates;
+		const size_t clusterCount = GetClusterCount();
+		if (clusterCount == 0)
+			return candidates;
+
+		probeCount = std::max<size_t>(1, std::min(probeCount, clusterCount));
+
+		std::vector<bool> probed(clusterCount, false);
+		std::vector<std::pair<double, uint32_t>> distances(clusterCount);
+		for (size_t contour = 0; contour < queryCount; ++contour) {
+			for (size_t cluster = 0; cluster < clusterCount; ++cluster) {
+				double distance = HuDistance::Distance(query + contour * Stride, GetCentroid(cluster));
+				distances[cluster] = { std::isnan(distance) ? std::numeric_limits<double>::infinity() : distance, static_cast<uint32_t>(cluster) };
+			}
+
+			std::partial_sort(distances.begin(), distances.begin() + probeCount, distances.end());
+			for (size_t probe = 0; probe < probeCount; ++probe)
+				probed[distances[probe].second] = true;
+		}
+
+		for (size_t cluster = 0; cluster < clusterCount; ++cluster) {
+			if (probed[cluster])
+				candidates.insert(candidates.end(), m_ClusterImages[cluster].begin(), m_ClusterImages[cluster].end());
+		}
+
+		std::sort(candidates.begin(), candidates.end());
+		candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+		return candidates;
+	}
+
+	bool ClusterIndex::Save(const std::string& path, uint64_t signature) const
+	{
+		std::string tempPath = path + ".tmp";
+		std::ofstream outputFileStream(tempPath, std::ios::binary | std::ios::trunc);
+		if (!outputFileStream.is_open()) {
+			std::cerr << "Failed to open output file: " << tempPath << std::endl;
+			return false;
+		}
+
+		outputFileStream.write(ClusterMagic, sizeof(ClusterMagic));
+		WriteValue(outputFileStream, ClusterVersion);
+		WriteValue(outputFileStream, m_Parameters.clusterCount);
+		WriteValue(outputFileStream, m_Parameters.iterations);
+		WriteValue(outputFileStream, m_Parameters.seed);
+		WriteValue(outputFileStream, signature);
+		WriteValue(outputFileStream, m_TrainingSize);
+		WriteValue(outputFileStream, static_cast<uint64_t>(GetClusterCount()));
+		WriteValue(outputFileStream, static_cast<uint64_t>(m_Assignments.size()));
+		outputFileStream.write(reinterpret_cast<const char*>(m_Centroids.data()), m_Centroids.size() * sizeof(double));
+		outputFileStream.write(reinterpret_cast<const char*>(m_Assignments.data()), m_Assignments.size() * sizeof(uint32_t));
+
+		outputFileStream.close();
+		if (outputFileStream.fail()) {
+			std::cerr << "Failed to write cluster index: " << tempPath << std::endl;
+			return false;
+		}
+
+		std::remove(path.c_str());
+		return std::rename(tempPath.c_str(), path.c_str()) == 0;
+	}
+
+	bool ClusterIndex::Load(const std::string& path, uint64_t& signature)
+	{
+		std::ifstream inputFileStream(path, std::ios::binary);
+		if (!inputFileStream.is_open())
+			return false;
+
+		char magic[4];
+		uint32_t version = 0;
+		ClusterParameters parameters = m_Parameters;
+		uint64_t trainingSize = 0;
+		uint64_t clusterCount = 0;
+		uint64_t contourCount = 0;
+
+		if (!inputFileStream.read(magic, sizeof(magic)) || std::memcmp(magic, ClusterMagic, sizeof(magic)) != 0
+			|| !ReadValue(inputFileStream, version) || version != ClusterVersion
+			|| !ReadValue(inputFileStream, parameters.clusterCount) || !ReadValue(inputFileStream, parameters.iterations)
+			|| !ReadValue(inputFileStream, parameters.seed) || !ReadValue(inputFileStream, signature)
+			|| !ReadValue(inputFileStream, trainingSize) || !ReadValue(inputFileStream, clusterCount) || !ReadValue(inputFileStream, contourCount)) {
+			std::cerr << "Unsupported cluster index format: " << path << std::endl;
+			return false;
+		}
+
+		// Build never makes more clusters than asked for, and both tables must fit in the rest of the file
+		const uint64_t remaining = RemainingBytes(inputFileStream);
+		const uint64_t centroidBytes = Stride * sizeof(double);
+		if ((parameters.clusterCount > 0 && clusterCount > parameters.clusterCount)
+			|| clusterCount > remaining / centroidBytes || contourCount > (remaining - clusterCount * centroidBytes) / sizeof(uint32_t)) {
+			std::cerr << "Cluster index is corrupted: " << path << std::endl;
+			return false;
+		}
+
+		Reset(parameters);
+		m_TrainingSize = trainingSize;
+		m_Centroids.resize(static_cast<size_t>(clusterCount * Stride));
+		m_Assignments.resize(static_cast<size_t>(contourCount));
+
+		bool valid = static_cast<bool>(inputFileStream.read(reinterpret_cast<char*>(m_Centroids.data()), m_Centroids.size() * sizeof(double)))
+			&& static_cast<bool>(inputFileStream.read(reinterpret_cast<char*>(m_Assignments.data()), m_Assignments.size() * sizeof(uint32_t)));
+		for (size_t contour = 0; valid && contour < m_Assignments.size(); ++contour)
+			valid = m_Assignments[contour] < clusterCount;
+
+		if (!valid) {
+			Reset(parameters);
+			std::cerr << "Cluster index is corrupted: " << path << std::endl;
+			return false;
+		}
+
+		return true;
+	}
+
+	bool ClusterIndex::Update(const std::string& path, const FeatureMatrix& matrix, unsigned int workerCount)
+	{
+		const ClusterParameters parameters = m_Parameters;
+		const size_t contourCount = matrix.GetContourCount();
+
+		uint64_t signature = 0;
+		bool loaded = Load(path, signature) && m_Parameters.clusterCount == parameters.clusterCount && m_Parameters.iterations == parameters.iterations
+			&& m_Parameters.seed == parameters.seed && GetSize() <= contourCount && 2 * m_TrainingSize >= contourCount
+			&& signature == HnswIndex::ComputeSignature(matrix.GetFeatures(), GetSize());
+
+		if (!loaded) {
+			Reset(parameters);
+			if (!Build(matrix, workerCount))
+				return false;
+		}
+		else {
+			m_Parameters.probeCount = parameters.probeCount;
+
+			bool grown = GetSize() < contourCount;
+			if (!Assign(matrix, GetSize(), workerCount)) {
+				Reset(parameters);
+				return false;
+			}
+			BuildLists(matrix);
+			if (!grown)
+				return true;
+		}
+
+		return Save(path, HnswIndex::ComputeSignature(matrix.GetFeatures(), contourCount));
+	}
+
+	uint32_t ClusterIndex::FindNearest(const double* vector) const
+	{
+		uint32_t nearest = 0;
+		double nearestDistance = std::numeric_limits<double>::infinity();
+
+		for (size_t cluster = 0; cluster < GetClusterCount(); ++cluster) {
+			double distance = HuDistance::Distance(vector, GetCentroid(cluster));
+			if (distance < nearestDistance) {
+				nearestDistance = distance;
+				nearest = static_cast<uint32_t>(cluster);
+			}
+		}
+
+		return nearest;
+	}
+
+	bool ClusterIndex::Assign(const FeatureMatrix& matrix, size_t first, unsigned int workerCount)
+	{
+		m_Assignments.resize(matrix.GetContourCount(), 0);
+		return RunSlices(first, matrix.GetContourCount(), workerCount, [&](size_t, size_t begin, size_t end) {
+			for (size_t contour = begin; contour < end; ++contour)
+				m_Assignments[contour] = FindNearest(matrix.GetContour(contour));
+			});
+	}
+
+	void ClusterIndex::BuildLists(const FeatureMatrix& matrix)
+	{
+		m_ClusterImages.assign(GetClusterCount(), std::vector<uint32_t>());
+		m_ImageClusters.assign(matrix.GetImageCount(), NoCluster);
+
+		std::vector<uint32_t> clusters;
+		for (size_t image = 0; image < matrix.GetImageCount(); ++image) {
+			clusters.assign(m_Assignments.begin() + matrix.GetContourBegin(image), m_Assignments.begin() + matrix.GetContourEnd(image));
+			std::sort(clusters.begin(), clusters.end());
+
+			// Images are visited in order, so every list comes out sorted
+			size_t longestRun = 0;
+			for (size_t runBegin = 0; runBegin < clusters.size(); ) {
+				size_t runEnd = runBegin + 1;
+				while (runEnd < clusters.size() && clusters[runEnd] == clusters[runBegin])
+					++runEnd;
+
+				m_ClusterImages[clusters[runBegin]].push_back(static_cast<uint32_t>(image));
+				if (runEnd - runBegin > longestRun) {
+					longestRun = runEnd - runBegin;
+					m_ImageClusters[image] = clusters[runBegin];
+				}
+
+				runBegin = runEnd;
+			}
+		}
+	}
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "FeatureMatrix.h"
+
+namespace SyncShapes
+{
+	struct ClusterParameters
+	{
+		uint32_t clusterCount = 0; // 0 = about the square root of the contour count
+		uint32_t iterations = 16;  // k-means refinement passes
+		uint32_t probeCount = 4;   // Clusters searched per query contour, the recall/latency knob
+		uint64_t seed = 7;
+	};
+
+	// Inverted file over the Hu vectors of a FeatureMatrix: k-means centroids, every contour assigned to the nearest one,
+	// and per cluster the images owning one of its contours. A query only scores the images listed in the clusters
+	// nearest to its contours. Contour and image ids are those of the matrix the index was built for.
+	class ClusterIndex
+	{
+	public:
+		static constexpr size_t Stride = FeatureMatrix::Stride;
+
+		ClusterIndex();
+		~ClusterIndex();
+
+		void Reset(const ClusterParameters& parameters);
+		// Trains the centroids on a sample of the contours and assigns all of them, both on 'workerCount' workers.
+		// Returns false, with the index left empty, if a worker failed.
+		bool Build(const FeatureMatrix& matrix, unsigned int workerCount);
+
+		// Images with a contour in one of the 'probeCount' clusters nearest to any query contour, ascending
+		std::vector<size_t> FindCandidates(const double* query, size_t queryCount, size_t probeCount) const;
+
+		bool Save(const std::string& path, uint64_t signature) const;
+		// Brings the index persisted at 'path' up to date with 'matrix'. Centroids trained on a prefix of its contours are kept
+		// and only the new contours are assigned, until the index has grown to twice its training size. Returns false if building
+		// or saving fails, a failed build leaves the index empty.
+		bool Update(const std::string& path, const FeatureMatrix& matrix, unsigned int workerCount);
+
+		inline bool IsEmpty() const { return m_Assignments.empty(); }
+		inline size_t GetSize() const { return m_Assignments.size(); }
+		inline size_t GetImageCount() const { return m_ImageClusters.size(); }
+		inline size_t GetClusterCount() const { return m_Centroids.size() / Stride; }
+		inline const double* GetCentroid(size_t cluster) const { return m_Centroids.data() + cluster * Stride; }
+		inline const std::vector<uint32_t>& GetClusterImages(size_t cluster) const { return m_ClusterImages[cluster]; }
+		// The cluster holding most of the image's contours, for browsing. Images without contours have none.
+		inline uint32_t GetImageCluster(size_t image) const { return m_ImageClusters[image]; }
+		inline const ClusterParameters& GetParameters() const { return m_Parameters; }
+		inline void SetProbeCount(uint32_t probeCount) { m_Parameters.probeCount = probeCount; }
+
+		static constexpr uint32_t NoCluster = static_cast<uint32_t>(-1);
+	private:
+		ClusterParameters m_Parameters;
+		uint64_t m_TrainingSize; // Contours present when the centroids were trained
+		std::vector<double> m_Centroids;
+		std::vector<uint32_t> m_Assignments; // Cluster of every contour
+		std::vector<std::vector<uint32_t>> m_ClusterImages;
+		std::vector<uint32_t> m_ImageClusters;
+
+		// Centroids and assignments only, the image lists need the matrix and are rebuilt by Update
+		bool Load(const std::string& path, uint64_t& signature);
+		uint32_t FindNearest(const double* vector) const;
+		// Assigns contours [first, GetContourCount()) in parallel, earlier assignments are kept. Returns false if a slice failed.
+		bool Assign(const FeatureMatrix& matrix, size_t first, unsigned int workerCount);
+		void BuildLists(const FeatureMatrix& matrix);
+	};
+}
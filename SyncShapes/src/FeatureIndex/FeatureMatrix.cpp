@@ -0,0 +1,107 @@
+#include "FeatureMatrix.h"
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+namespace SyncShapes
+{
+	void FeatureMatrix::AlignedDeleter::operator()(double* data) const
+	{
+		::operator delete[](data, std::align_val_t(FeatureStore::Alignment));
+	}
+
+	FeatureMatrix::FeatureMatrix() : m_Store(nullptr), m_Features(nullptr), m_Descriptors(nullptr), m_ImageCount(0) {}
+	FeatureMatrix::~FeatureMatrix() {}
+
+	void FeatureMatrix::Build(const std::unordered_map<std::string, FeatureData>& allFeatures)
+	{
+		Clear();
+
+		m_OwnedNames.reserve(allFeatures.size());
+		for (const auto& entry : allFeatures)
+			m_OwnedNames.push_back(entry.first);
+
+		// Name order lets FindImage binary search, the same ordering FeatureStore::Write uses
+		std::sort(m_OwnedNames.begin(), m_OwnedNames.end());
+
+		m_ImageCount = m_OwnedNames.size();
+		m_ContourOffsets.reserve(m_ImageCount + 1);
+		m_ContourOffsets.push_back(0);
+		for (const auto& name : m_OwnedNames)
+			m_ContourOffsets.push_back(m_ContourOffsets.back() + allFeatures.at(name).shapeFeatures.size());
+
+		size_t valueCount = std::max<size_t>(GetContourCount() * Stride, Stride);
+		m_OwnedFeatures.reset(static_cast<double*>(::operator new[](valueCount * sizeof(double), std::align_val_t(FeatureStore::Alignment))));
+		std::fill(m_OwnedFeatures.get(), m_OwnedFeatures.get() + valueCount, 0.0);
+
+		double* record = m_OwnedFeatures.get();
+		for (const auto& name : m_OwnedNames) {
+			for (const auto& featureVector : allFeatures.at(name).shapeFeatures) {
+				std::copy_n(featureVector.begin(), std::min<size_t>(featureVector.size(), FeatureStore::Dimension), record);
+				record += Stride;
+			}
+		}
+
+		m_OwnedDescriptors.reserve(m_ImageCount);
+		for (const auto& name : m_OwnedNames)
+			m_OwnedDescriptors.push_back(allFeatures.at(name).descriptor);
+
+		m_Features = m_OwnedFeatures.get();
+		m_Descriptors = m_OwnedDescriptors.data();
+	}
+
+	void FeatureMatrix::Attach(const FeatureStore& store)
+	{
+		Clear();
+
+		m_Store = &store;
+		m_Features = store.GetFeatures();
+		m_Descriptors = store.GetDescriptors();
+		m_ImageCount = store.GetImageCount();
+
+		m_ContourOffsets.resize(m_ImageCount + 1);
+		for (size_t image = 0; image < m_ImageCount; ++image)
+			m_ContourOffsets[image] = store.GetContourBegin(image);
+		m_ContourOffsets[m_ImageCount] = store.GetContourCount();
+	}
+
+	void FeatureMatrix::Clear()
+	{
+		m_OwnedFeatures.reset();
+		m_OwnedNames.clear();
+		m_OwnedDescriptors.clear();
+		m_Store = nullptr;
+		m_Features = nullptr;
+		m_Descriptors = nullptr;
+		m_ImageCount = 0;
+		m_ContourOffsets.clear();
+	}
+
+	std::string_view FeatureMatrix::GetImageName(size_t image) const
+	{
+		return m_Store ? m_Store->GetImageName(image) : std::string_view(m_OwnedNames[image]);
+	}
+
+	size_t FeatureMatrix::FindImage(std::string_view name) const
+	{
+		if (m_Store)
+			return m_Store->FindImage(name);
+
+		auto it = std::lower_bound(m_OwnedNames.begin(), m_OwnedNames.end(), name, [](const std::string& a, std::string_view b) {
+			return std::string_view(a) < b;
+			});
+
+		if (it != m_OwnedNames.end() && *it == name)
+			return static_cast<size_t>(it - m_OwnedNames.begin());
+
+		return NotFound;
+	}
+
+	size_t FeatureMatrix::FindImageOfContour(size_t contour) const
+	{
+		// First image whose range ends after the contour, empty images are skipped naturally
+		auto it = std::upper_bound(m_ContourOffsets.begin(), m_ContourOffsets.end(), contour);
+		return static_cast<size_t>(it - m_ContourOffsets.begin()) - 1;
+	}
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "FeatureStore/FeatureStore.h"
+
+namespace SyncShapes
+{
+	// All Hu vectors of an index in one contiguous, 64-byte aligned block of stride-8 records,
+	// plus an image -> contour range table. Either owns its buffer or views a mapped FeatureStore.
+	class FeatureMatrix
+	{
+	public:
+		static constexpr size_t Stride = FeatureStore::Stride;
+		static constexpr size_t NotFound = FeatureStore::NotFound;
+
+		FeatureMatrix();
+		~FeatureMatrix();
+
+		// Copies the features, images are ordered by name
+		void Build(const std::unordered_map<std::string, FeatureData>& allFeatures);
+		// Zero-copy view, 'store' must stay open while the matrix is in use
+		void Attach(const FeatureStore& store);
+		void Clear();
+
+		inline bool IsEmpty() const { return m_ImageCount == 0; }
+		inline size_t GetImageCount() const { return m_ImageCount; }
+		inline size_t GetContourCount() const { return m_ContourOffsets.empty() ? 0 : m_ContourOffsets.back(); }
+		inline size_t GetContourBegin(size_t image) const { return m_ContourOffsets[image]; }
+		inline size_t GetContourEnd(size_t image) const { return m_ContourOffsets[image + 1]; }
+		inline size_t GetContourCount(size_t image) const { return m_ContourOffsets[image + 1] - m_ContourOffsets[image]; }
+		inline const double* GetFeatures() const { return m_Features; }
+		inline const double* GetContour(size_t contour) const { return m_Features + contour * Stride; }
+		inline const double* GetImageContours(size_t image) const { return GetContour(m_ContourOffsets[image]); }
+		// One per image, null for a store written before descriptors existed
+		inline const ShapeDescriptor* GetDescriptors() const { return m_Descriptors; }
+
+		std::string_view GetImageName(size_t image) const;
+		size_t FindImage(std::string_view name) const;
+		size_t FindImageOfContour(size_t contour) const;
+	private:
+		struct AlignedDeleter { void operator()(double* data) const; };
+
+		std::unique_ptr<double[], AlignedDeleter> m_OwnedFeatures;
+		std::vector<std::string> m_OwnedNames;
+		std::vector<ShapeDescriptor> m_OwnedDescriptors;
+		const FeatureStore* m_Store;
+
+		const double* m_Features;
+		const ShapeDescriptor* m_Descriptors;
+		size_t m_ImageCount;
+		std::vector<size_t> m_ContourOffsets;
+	};
+}
@@ -0,0 +1,400 @@
+#include "HnswIndex.h"
+#include "HuDistance.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <queue>
+#include <unordered_set>
+
+namespace SyncShapes
+{
+	namespace
+	{
+		const char HnswMagic[4] = { 'S', 'S', 'H', 'N' };
+		const uint32_t HnswVersion = 1;
+
+		inline const double* VectorAt(const double* vectors, uint32_t id)
+		{
+			return vectors + static_cast<size_t>(id) * HuDistance::Stride;
+		}
+
+		template <typename T>
+		inline void WriteValue(std::ofstream& stream, const T& value)
+		{
+			stream.write(reinterpret_cast<const char*>(&value), sizeof(T));
+		}
+
+		template <typename T>
+		inline bool ReadValue(std::ifstream& stream, T& value)
+		{
+			return static_cast<bool>(stream.read(reinterpret_cast<char*>(&value), sizeof(T)));
+		}
+
+		// Bytes between the read position and the end of the file, the bound for any count read from it
+		inline uint64_t RemainingBytes(std::ifstream& stream)
+		{
+			std::streampos position = stream.tellg();
+			stream.seekg(0, std::ios::end);
+			std::streampos end = stream.tellg();
+			stream.seekg(position);
+			return position >= 0 && end >= position ? static_cast<uint64_t>(end - position) : 0;
+		}
+	}
+
+	HnswIndex::HnswIndex() : m_LevelMultiplier(0.0), m_EntryPoint(0), m_MaxLevel(-1)
+	{
+		Reset(HnswParameters());
+	}
+
+	HnswIndex::~HnswIndex() {}
+
+	void HnswIndex::Reset(const HnswParameters& parameters)
+	{
+		m_Parameters = parameters;
+		m_Parameters.M = std::max<uint32_t>(m_Parameters.M, 2);
+		m_LevelMultiplier = 1.0 / std::log(static_cast<double>(m_Parameters.M));
+		m_EntryPoint = 0;
+		m_MaxLevel = -1;
+		m_Random.seed(0x5eed);
+		m_Links.clear();
+	}
+
+	void HnswIndex::Build(const double* vectors, size_t count)
+	{
+		Reset(m_Parameters);
+		Extend(vectors, count);
+	}
+
+	void HnswIndex::Extend(const double* vectors, size_t count)
+	{
+		m_Links.reserve(count);
+		for (size_t id = m_Links.size(); id < count; ++id)
+			Insert(vectors, static_cast<uint32_t>(id));
+	}
+
+	int HnswIndex::RandomLevel()
+	{
+		std::uniform_real_distribution<double> distribution(std::numeric_limits<double>::min(), 1.0);
+		return static_cast<int>(-std::log(distribution(m_Random)) * m_LevelMultiplier);
+	}
+
+	void HnswIndex::Insert(const double* vectors, uint32_t id)
+	{
+		const double* query = VectorAt(vectors, id);
+		int level = RandomLevel();
+		m_Links.emplace_back(static_cast<size_t>(level) + 1);
+
+		if (m_MaxLevel < 0) {
+			m_EntryPoint = id;
+			m_MaxLevel = level;
+			return;
+		}
+
+		uint32_t entry = GreedyDescend(vectors, query, m_EntryPoint, m_MaxLevel, level);
+
+		for (int layer = std::min(level, m_MaxLevel); layer >= 0; --layer) {
+			std::vector<Candidate> candidates = SearchLayer(vectors, query, entry, m_Parameters.efConstruction, layer);
+			entry = candidates.front().second;
+
+			std::vector<uint32_t> neighbours = SelectNeighbours(vectors, std::move(candidates), m_Parameters.M);
+			m_Links[id][layer] = neighbours;
+
+			size_t maxLinks = layer == 0 ? 2 * m_Parameters.M : m_Parameters.M;
+			for (uint32_t neighbour : neighbours) {
+				std::vector<uint32_t>& links = m_Links[neighbour][layer];
+				links.push_back(id);
+
+				if (links.size() > maxLinks)
+					ShrinkLinks(vectors, neighbour, layer);
+			}
+		}
+
+		if (level > m_MaxLevel) {
+			m_EntryPoint = id;
+			m_MaxLevel = level;
+		}
+	}
+
+	uint32_t HnswIndex::GreedyDescend(const double* vectors, const double* query, uint32_t entry, int fromLevel, int toLevel) const
+	{
+		double entryDistance = HuDistance::Distance(query, VectorAt(vectors, entry));
+
+		for (int layer = fromLevel; layer > toLevel; --layer) {
+			bool improved = true;
+			while (improved) {
+				improved = false;
+
+				for (uint32_t neighbour : m_Links[entry][layer]) {
+					double distance = HuDistance::Distance(query, VectorAt(vectors, neighbour));
+					if (distance < entryDistance) {
+						entryDistance = distance;
+						entry = neighbour;
+						improved = true;
+					}
+				}
+			}
+		}
+
+		return entry;
+	}
+
+	std::vector<HnswIndex::Candidate> HnswIndex::SearchLayer(const double* vectors, const double* query, uint32_t entry, size_t ef, int level) const
+	{
+		std::unordered_set<uint32_t> visited;
+		visited.reserve(ef * 4);
+		visited.insert(entry);
+
+		double entryDistance = HuDistance::Distance(query, VectorAt(vectors, entry));
+
+		// Closest unexpanded candidate first, farthest kept result first
+		std::priority_queue<Candidate, std::vector<Candidate>, std::greater<Candidate>> candidates;
+		std::priority_queue<Candidate> results;
+		candidates.emplace(entryDistance, entry);
+		results.emplace(entryDistance, entry);
+
+		while (!candidates.empty()) {
+			Candidate current = candidates.top();
+			if (current.first > results.top().first && results.size() >= ef)
+				break;
+			candidates.pop();
+
+			for (uint32_t neighbour : m_Links[current.second][level]) {
+				if (!visited.insert(neighbour).second)
+					continue;
+
+				double distance = HuDistance::Distance(query, VectorAt(vectors, neighbour));
+				if (results.size() < ef || distance < results.top().first) {
+					candidates.emplace(distance, neighbour);
+					results.emplace(distance, neighbour);
+
+					if (results.size() > ef)
+						results.pop();
+				}
+			}
+		}
+
+		std::vector<Candidate> sorted;
+		sorted.reserve(results.size());
+		while (!results.empty()) {
+			sorted.push_back(results.top());
+			results.pop();
+		}
+
+		std::reverse(sorted.begin(), sorted.end());
+		return sorted;
+	}
+
+	std::vector<uint32_t> HnswIndex::SelectNeighbours(const double* vectors, std::vector<Candidate> candidates, size_t maxCount) const
+	{
+		// Keep a candidate only if it is closer to the new node than to every neighbour already kept,
+		// which spreads the links over different directions instead of one dense cluster
+		std::sort(candidates.begin(), candidates.end());
+
+		std::vector<uint32_t> selected;
+		selected.reserve(maxCount);
+
+		for (const auto& candidate : candidates) {
+			if (selected.size() >= maxCount)
+				break;
+
+			bool keep = true;
+			for (uint32_t other : selected) {
+				if (HuDistance::Distance(VectorAt(vectors, candidate.second), VectorAt(vectors, other)) < candidate.first) {
+					keep = false;
+					break;
+				}
+			}
+
+			if (keep)
+				selected.push_back(candidate.second);
+		}
+
+		return selected;
+	}
+
+	void HnswIndex::ShrinkLinks(const double* vectors, uint32_t node, int level)
+	{
+		std::vector<uint32_t>& links = m_Links[node][level];
+		const double* nodeVector = VectorAt(vectors, node);
+
+		std::vector<Candidate> candidates;
+		candidates.reserve(links.size());
+		for (uint32_t neighbour : links)
+			candidates.emplace_back(HuDistance::Distance(nodeVector, VectorAt(vectors, neighbour)), neighbour);
+
+		links = SelectNeighbours(vectors, std::move(candidates), level == 0 ? 2 * m_Parameters.M : m_Parameters.M);
+	}
+
+	std::vector<std::pair<uint32_t, double>> HnswIndex::Search(const double* vectors, const double* query, size_t k, size_t ef) const
+	{
+		std::vector<std::pair<uint32_t, double>> nearest;
+		if (m_MaxLevel < 0 || k == 0)
+			return nearest;
+
+		uint32_t entry = GreedyDescend(vectors, query, m_EntryPoint, m_MaxLevel, 0);
+		std::vector<Candidate> candidates = SearchLayer(vectors, query, entry, std::max(ef, k), 0);
+
+		size_t count = std::min(k, candidates.size());
+		nearest.reserve(count);
+		for (size_t i = 0; i < count; ++i)
+			nearest.emplace_back(candidates[i].second, candidates[i].first);
+
+		return nearest;
+	}
+
+	bool HnswIndex::Save(const std::string& path, uint64_t signature) const
+	{
+		std::string tempPath = path + ".tmp";
+		std::ofstream outputFileStream(tempPath, std::ios::binary | std::ios::trunc);
+		if (!outputFileStream.is_open()) {
+			std::cerr << "Failed to open output file: " << tempPath << std::endl;
+			return false;
+		}
+
+		outputFileStream.write(HnswMagic, sizeof(HnswMagic));
+		WriteValue(outputFileStream, HnswVersion);
+		WriteValue(outputFileStream, m_Parameters.M);
+		WriteValue(outputFileStream, m_Parameters.efConstruction);
+		WriteValue(outputFileStream, signature);
+		WriteValue(outputFileStream, static_cast<uint64_t>(m_Links.size()));
+		WriteValue(outputFileStream, m_EntryPoint);
+		WriteValue(outputFileStream, static_cast<int32_t>(m_MaxLevel));
+
+		for (const auto& levels : m_Links) {
+			WriteValue(outputFileStream, static_cast<uint32_t>(levels.size()));
+			for (const auto& links : levels) {
+				WriteValue(outputFileStream, static_cast<uint32_t>(links.size()));
+				outputFileStream.write(reinterpret_cast<const char*>(links.data()), links.size() * sizeof(uint32_t));
+			}
+		}
+
+		outputFileStream.close();
+		if (outputFileStream.fail()) {
+			std::cerr << "Failed to write approximate index: " << tempPath << std::endl;
+			return false;
+		}
+
+		std::remove(path.c_str());
+		return std::rename(tempPath.c_str(), path.c_str()) == 0;
+	}
+
+	bool HnswIndex::Load(const std::string& path, uint64_t& signature)
+	{
+		std::ifstream inputFileStream(path, std::ios::binary);
+		if (!inputFileStream.is_open())
+			return false;
+
+		char magic[4];
+		uint32_t version = 0;
+		HnswParameters parameters = m_Parameters;
+		uint64_t nodeCount = 0;
+		uint32_t entryPoint = 0;
+		int32_t maxLevel = -1;
+
+		if (!inputFileStream.read(magic, sizeof(magic)) || std::memcmp(magic, HnswMagic, sizeof(magic)) != 0
+			|| !ReadValue(inputFileStream, version) || version != HnswVersion
+			|| !ReadValue(inputFileStream, parameters.M) || !ReadValue(inputFileStream, parameters.efConstruction)
+			|| !ReadValue(inputFileStream, signature) || !ReadValue(inputFileStream, nodeCount)
+			|| !ReadValue(inputFileStream, entryPoint) || !ReadValue(inputFileStream, maxLevel)) {
+			std::cerr << "Unsupported approximate index format: " << path << std::endl;
+			return false;
+		}
+
+		// Every node takes at least a level count and one link count, so a count the file cannot hold is never allocated
+		const uint64_t nodeBytes = 2 * sizeof(uint32_t);
+		if (nodeCount > RemainingBytes(inputFileStream) / nodeBytes) {
+			std::cerr << "Approximate index is corrupted: " << path << std::endl;
+			return false;
+		}
+
+		Reset(parameters);
+		m_Links.resize(static_cast<size_t>(nodeCount));
+
+		for (auto& levels : m_Links) {
+			uint32_t levelCount = 0;
+			if (!ReadValue(inputFileStream, levelCount) || levelCount == 0 || static_cast<int32_t>(levelCount) > maxLevel + 1
+				|| levelCount > RemainingBytes(inputFileStream) / sizeof(uint32_t)) {
+				Reset(parameters);
+				std::cerr << "Approximate index is corrupted: " << path << std::endl;
+				return false;
+			}
+
+			levels.resize(levelCount);
+			for (auto& links : levels) {
+				uint32_t linkCount = 0;
+				if (!ReadValue(inputFileStream, linkCount) || linkCount > 2 * parameters.M + 1) {
+					Reset(parameters);
+					std::cerr << "Approximate index is corrupted: " << path << std::endl;
+					return false;
+				}
+
+				links.resize(linkCount);
+				inputFileStream.read(reinterpret_cast<char*>(links.data()), linkCount * sizeof(uint32_t));
+
+				if (std::any_of(links.begin(), links.end(), [nodeCount](uint32_t link) { return link >= nodeCount; })) {
+					Reset(parameters);
+					std::cerr << "Approximate index is corrupted: " << path << std::endl;
+					return false;
+				}
+			}
+		}
+
+		bool valid = inputFileStream && (nodeCount == 0 || (entryPoint < nodeCount && maxLevel >= 0
+			&& m_Links[entryPoint].size() == static_cast<size_t>(maxLevel) + 1));
+
+		// Search follows a link on a layer into that layer of the target, which must reach it
+		for (size_t node = 0; valid && node < m_Links.size(); ++node) {
+			const auto& levels = m_Links[node];
+			for (size_t layer = 0; valid && layer < levels.size(); ++layer) {
+				valid = std::all_of(levels[layer].begin(), levels[layer].end(), [this, layer](uint32_t link) { return m_Links[link].size() > layer; });
+			}
+		}
+
+		if (!valid) {
+			Reset(parameters);
+			std::cerr << "Approximate index is corrupted: " << path << std::endl;
+			return false;
+		}
+
+		m_EntryPoint = entryPoint;
+		m_MaxLevel = nodeCount > 0 ? maxLevel : -1;
+		return true;
+	}
+
+	bool HnswIndex::Update(const std::string& path, const double* vectors, size_t count)
+	{
+		uint64_t signature = 0;
+		bool loaded = Load(path, signature) && GetSize() <= count && signature == ComputeSignature(vectors, GetSize());
+
+		if (loaded && GetSize() == count)
+			return true;
+
+		if (loaded)
+			Extend(vectors, count);
+		else
+			Build(vectors, count);
+
+		return Save(path, ComputeSignature(vectors, count));
+	}
+
+	uint64_t HnswIndex::ComputeSignature(const double* vectors, size_t count)
+	{
+		uint64_t state = 0x9e3779b97f4a7c15ULL ^ count;
+		const size_t valueCount = count * HuDistance::Stride;
+
+		for (size_t i = 0; i < valueCount; ++i) {
+			uint64_t word;
+			std::memcpy(&word, vectors + i, sizeof(word));
+			state = (state ^ word) * 0x100000001b3ULL;
+			state ^= state >> 29;
+		}
+
+		return state;
+	}
+}
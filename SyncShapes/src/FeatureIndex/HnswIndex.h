@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace SyncShapes
+{
+	struct HnswParameters
+	{
+		uint32_t M = 16;               // Links per node on the upper layers, 2 * M on layer 0
+		uint32_t efConstruction = 200; // Candidate list size while inserting, higher builds a better graph
+		uint32_t efSearch = 64;        // Candidate list size while querying, the recall/latency knob
+	};
+
+	// Hierarchical navigable small world graph over stride-8 Hu vectors (see FeatureStore).
+	// Node ids are contour indices into the vector block the index was built from, the vectors themselves are not copied.
+	class HnswIndex
+	{
+	public:
+		HnswIndex();
+		~HnswIndex();
+
+		void Reset(const HnswParameters& parameters);
+		void Build(const double* vectors, size_t count);
+		// Inserts vectors [GetSize(), count), for blocks that only grew since the index was built
+		void Extend(const double* vectors, size_t count);
+
+		// Up to k nearest (id, distance) pairs, ascending
+		std::vector<std::pair<uint32_t, double>> Search(const double* vectors, const double* query, size_t k, size_t ef) const;
+
+		bool Save(const std::string& path, uint64_t signature) const;
+		bool Load(const std::string& path, uint64_t& signature);
+		// Brings the index persisted at 'path' up to date with 'count' vectors: the saved graph is reused if it was built
+		// over a prefix of them and only the new vectors are inserted, otherwise it is rebuilt. Returns false if saving fails.
+		bool Update(const std::string& path, const double* vectors, size_t count);
+
+		// Fingerprint of the first 'count' vectors, used to check the index still matches its feature store
+		static uint64_t ComputeSignature(const double* vectors, size_t count);
+
+		inline size_t GetSize() const { return m_Links.size(); }
+		inline bool IsEmpty() const { return m_Links.empty(); }
+		inline const HnswParameters& GetParameters() const { return m_Parameters; }
+		inline void SetSearchEf(uint32_t ef) { m_Parameters.efSearch = ef; }
+	private:
+		using Candidate = std::pair<double, uint32_t>;
+
+		HnswParameters m_Parameters;
+		double m_LevelMultiplier;
+		uint32_t m_EntryPoint;
+		int m_MaxLevel;
+		std::mt19937_64 m_Random;
+
+		// m_Links[node][level] = neighbours of node on that level
+		std::vector<std::vector<std::vector<uint32_t>>> m_Links;
+
+		void Insert(const double* vectors, uint32_t id);
+		int RandomLevel();
+		uint32_t GreedyDescend(const double* vectors, const double* query, uint32_t entry, int fromLevel, int toLevel) const;
+		std::vector<Candidate> SearchLayer(const double* vectors, const double* query, uint32_t entry, size_t ef, int level) const;
+		std::vector<uint32_t> SelectNeighbours(const double* vectors, std::vector<Candidate> candidates, size_t maxCount) const;
+		void ShrinkLinks(const double* vectors, uint32_t node, int level);
+	};
+}
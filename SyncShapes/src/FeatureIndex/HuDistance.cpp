@@ -0,0 +1,214 @@
+#include "HuDistance.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define SYNCSHAPES_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define SYNCSHAPES_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define SYNCSHAPES_TARGET_AVX2
+#endif
+
+namespace SyncShapes
+{
+	namespace HuDistance
+	{
+		namespace
+		{
+			constexpr double Infinity = std::numeric_limits<double>::infinity();
+
+#ifndef SYNCSHAPES_X86
+			double ScalarDistance(const double* a, const double* b)
+			{
+				double sum = 0.0;
+				for (size_t i = 0; i < Stride; ++i) {
+					double difference = a[i] - b[i];
+					sum += difference * difference;
+				}
+				return std::sqrt(sum);
+			}
+
+			double ScalarMinSummedDistance(const double* query, size_t queryCount, const double* stored, size_t storedCount)
+			{
+				double minDistance = Infinity;
+
+				for (size_t s = 0; s < storedCount; ++s) {
+					double distance = 0.0;
+					for (size_t q = 0; q < queryCount; ++q)
+						distance += ScalarDistance(query + q * Stride, stored + s * Stride);
+
+					minDistance = std::min(minDistance, distance);
+				}
+
+				return minDistance;
+			}
+#else
+			// Squared distance of one pair, left as two partial sums
+			inline __m128d SquaredDistanceSSE2(const double* a, const double* b)
+			{
+				__m128d d0 = _mm_sub_pd(_mm_loadu_pd(a), _mm_loadu_pd(b));
+				__m128d d1 = _mm_sub_pd(_mm_loadu_pd(a + 2), _mm_loadu_pd(b + 2));
+				__m128d d2 = _mm_sub_pd(_mm_loadu_pd(a + 4), _mm_loadu_pd(b + 4));
+				__m128d d3 = _mm_sub_pd(_mm_loadu_pd(a + 6), _mm_loadu_pd(b + 6));
+
+				__m128d sum = _mm_add_pd(_mm_mul_pd(d0, d0), _mm_mul_pd(d1, d1));
+				return _mm_add_pd(sum, _mm_add_pd(_mm_mul_pd(d2, d2), _mm_mul_pd(d3, d3)));
+			}
+
+			double SSE2Distance(const double* a, const double* b)
+			{
+				__m128d sum = SquaredDistanceSSE2(a, b);
+				sum = _mm_add_sd(sum, _mm_unpackhi_pd(sum, sum));
+				return _mm_cvtsd_f64(_mm_sqrt_sd(sum, sum));
+			}
+
+			double SSE2MinSummedDistance(const double* query, size_t queryCount, const double* stored, size_t storedCount)
+			{
+				double minDistance = Infinity;
+				size_t s = 0;
+
+				// Two stored contours at a time, so both square roots share one instruction
+				for (; s + 2 <= storedCount; s += 2) {
+					const double* s0 = stored + s * Stride;
+					const double* s1 = s0 + Stride;
+					__m128d accumulator = _mm_setzero_pd();
+
+					for (size_t q = 0; q < queryCount; ++q) {
+						const double* a = query + q * Stride;
+						__m128d p0 = SquaredDistanceSSE2(a, s0);
+						__m128d p1 = SquaredDistanceSSE2(a, s1);
+						__m128d squared = _mm_add_pd(_mm_unpacklo_pd(p0, p1), _mm_unpackhi_pd(p0, p1));
+						accumulator = _mm_add_pd(accumulator, _mm_sqrt_pd(squared));
+					}
+
+					double sums[2];
+					_mm_storeu_pd(sums, accumulator);
+					minDistance = std::min(minDistance, std::min(sums[0], sums[1]));
+				}
+
+				for (; s < storedCount; ++s) {
+					double distance = 0.0;
+					for (size_t q = 0; q < queryCount; ++q)
+						distance += SSE2Distance(query + q * Stride, stored + s * Stride);
+
+					minDistance = std::min(minDistance, distance);
+				}
+
+				return minDistance;
+			}
+
+			SYNCSHAPES_TARGET_AVX2 inline __m256d SquaredDistanceAVX2(const double* a, const double* b)
+			{
+				__m256d d0 = _mm256_sub_pd(_mm256_loadu_pd(a), _mm256_loadu_pd(b));
+				__m256d d1 = _mm256_sub_pd(_mm256_loadu_pd(a + 4), _mm256_loadu_pd(b + 4));
+				return _mm256_add_pd(_mm256_mul_pd(d0, d0), _mm256_mul_pd(d1, d1));
+			}
+
+			SYNCSHAPES_TARGET_AVX2 double AVX2MinSummedDistance(const double* query, size_t queryCount, const double* stored, size_t storedCount)
+			{
+				double minDistance = Infinity;
+				size_t s = 0;
+
+				// Four stored contours at a time: the four horizontal sums and square roots are done together
+				for (; s + 4 <= storedCount; s += 4) {
+					const double* s0 = stored + s * Stride;
+					__m256d accumulator = _mm256_setzero_pd();
+
+					for (size_t q = 0; q < queryCount; ++q) {
+						const double* a = query + q * Stride;
+						__m256d v0 = SquaredDistanceAVX2(a, s0);
+						__m256d v1 = SquaredDistanceAVX2(a, s0 + Stride);
+						__m256d v2 = SquaredDistanceAVX2(a, s0 + 2 * Stride);
+						__m256d v3 = SquaredDistanceAVX2(a, s0 + 3 * Stride);
+
+						__m256d h01 = _mm256_hadd_pd(v0, v1);
+						__m256d h23 = _mm256_hadd_pd(v2, v3);
+						__m256d squared = _mm256_add_pd(_mm256_blend_pd(h01, h23, 0xC), _mm256_permute2f128_pd(h01, h23, 0x21));
+						accumulator = _mm256_add_pd(accumulator, _mm256_sqrt_pd(squared));
+					}
+
+					double sums[4];
+					_mm256_storeu_pd(sums, accumulator);
+					minDistance = std::min(minDistance, std::min(std::min(sums[0], sums[1]), std::min(sums[2], sums[3])));
+				}
+
+				if (s < storedCount)
+					minDistance = std::min(minDistance, SSE2MinSummedDistance(query, queryCount, stored + s * Stride, storedCount - s));
+
+				return minDistance;
+			}
+
+			bool CpuSupportsAVX2()
+			{
+#ifdef _MSC_VER
+				int info[4];
+				__cpuid(info, 1);
+				bool osUsesXSave = (info[2] & (1 << 27)) != 0;
+				bool cpuHasAVX = (info[2] & (1 << 28)) != 0;
+				if (!osUsesXSave || !cpuHasAVX)
+					return false;
+
+				// The OS must save the YMM registers on context switches
+				if ((_xgetbv(0) & 0x6) != 0x6)
+					return false;
+
+				__cpuidex(info, 7, 0);
+				return (info[1] & (1 << 5)) != 0;
+#else
+				return __builtin_cpu_supports("avx2");
+#endif
+			}
+#endif
+
+			struct Kernel
+			{
+				double (*distance)(const double*, const double*);
+				double (*minSummedDistance)(const double*, size_t, const double*, size_t);
+				const char* name;
+			};
+
+			Kernel SelectKernel()
+			{
+#ifdef SYNCSHAPES_X86
+				// SSE2 is part of x86-64, the scalar path is only reached on other architectures
+				if (CpuSupportsAVX2())
+					return { SSE2Distance, AVX2MinSummedDistance, "AVX2" };
+
+				return { SSE2Distance, SSE2MinSummedDistance, "SSE2" };
+#else
+				return { ScalarDistance, ScalarMinSummedDistance, "Scalar" };
+#endif
+			}
+
+			const Kernel& GetKernel()
+			{
+				static const Kernel kernel = SelectKernel();
+				return kernel;
+			}
+		}
+
+		double Distance(const double* a, const double* b)
+		{
+			return GetKernel().distance(a, b);
+		}
+
+		double MinSummedDistance(const double* query, size_t queryCount, const double* stored, size_t storedCount)
+		{
+			return GetKernel().minSummedDistance(query, queryCount, stored, storedCount);
+		}
+
+		const char* GetKernelName()
+		{
+			return GetKernel().name;
+		}
+	}
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstddef>
+
+namespace SyncShapes
+{
+	// Distance kernels over stride-8, zero-padded Hu moment vectors (see FeatureStore).
+	// The best kernel for the CPU (AVX2, SSE2 or scalar) is picked once at startup.
+	namespace HuDistance
+	{
+		constexpr size_t Stride = 8;
+
+		// Euclidean distance between two padded vectors
+		double Distance(const double* a, const double* b);
+
+		// min over stored contours s of (sum over query contours q of |q - s|), the image distance used by RetrieveImages.
+		// Returns infinity when storedCount is 0.
+		double MinSummedDistance(const double* query, size_t queryCount, const double* stored, size_t storedCount);
+
+		const char* GetKernelName();
+	}
+}
@@ -0,0 +1,142 @@
+#include "QuantizedMatrix.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace SyncShapes
+{
+	QuantizedMatrix::QuantizedMatrix() : m_Compression(FeatureCompression::None), m_ContourCount(0), m_Scale(), m_Offset() {}
+	QuantizedMatrix::~QuantizedMatrix() {}
+
+	void QuantizedMatrix::Build(const FeatureMatrix& matrix, FeatureCompression compression)
+	{
+		Clear();
+
+		const size_t contourCount = matrix.GetContourCount();
+		if (compression == FeatureCompression::None || contourCount == 0)
+			return;
+
+		m_Compression = compression;
+		m_ContourCount = contourCount;
+
+		if (compression == FeatureCompression::Float32) {
+			m_Floats.resize(contourCount * Stride);
+			const double* features = matrix.GetFeatures();
+			for (size_t i = 0; i < m_Floats.size(); ++i)
+				m_Floats[i] = static_cast<float>(features[i]);
+			return;
+		}
+
+		// Range of every dimension over the finite values, a zero moment normalises to infinity
+		double minimum[Stride];
+		double maximum[Stride];
+		std::fill(minimum, minimum + Stride, std::numeric_limits<double>::infinity());
+		std::fill(maximum, maximum + Stride, -std::numeric_limits<double>::infinity());
+
+		for (size_t contour = 0; contour < contourCount; ++contour) {
+			const double* vector = matrix.GetContour(contour);
+			for (size_t d = 0; d < Stride; ++d) {
+				if (std::isfinite(vector[d])) {
+					minimum[d] = std::min(minimum[d], vector[d]);
+					maximum[d] = std::max(maximum[d], vector[d]);
+				}
+			}
+		}
+
+		for (size_t d = 0; d < Stride; ++d) {
+			if (minimum[d] > maximum[d])
+				minimum[d] = maximum[d] = 0.0;
+
+			m_Offset[d] = static_cast<float>(minimum[d]);
+			m_Scale[d] = static_cast<float>((maximum[d] - minimum[d]) / static_cast<double>(NonFiniteCode - 1));
+		}
+
+		m_Codes.resize(contourCount * Stride);
+		for (size_t contour = 0; contour < contourCount; ++contour) {
+			const double* vector = matrix.GetContour(contour);
+			uint8_t* codes = m_Codes.data() + contour * Stride;
+
+			for (size_t d = 0; d < Stride; ++d) {
+				double value = vector[d];
+				if (!std::isfinite(value))
+					codes[d] = NonFiniteCode;
+				else if (m_Scale[d] == 0.0f)
+					codes[d] = 0;
+				else
+					codes[d] = static_cast<uint8_t>(std::clamp(std::round((value - m_Offset[d]) / m_Scale[d]), 0.0, static_cast<double>(NonFiniteCode - 1)));
+			}
+		}
+	}
+
+	void QuantizedMatrix::Clear()
+	{
+		m_Compression = FeatureCompression::None;
+		m_ContourCount = 0;
+		m_Floats.clear();
+		m_Floats.shrink_to_fit();
+		m_Codes.clear();
+		m_Codes.shrink_to_fit();
+	}
+
+	void QuantizedMatrix::EncodeQuery(const double* query, size_t queryCount, std::vector<float>& encoded) const
+	{
+		encoded.resize(queryCount * Stride);
+		for (size_t q = 0; q < queryCount; ++q) {
+			for (size_t d = 0; d < Stride; ++d) {
+				double value = query[q * Stride + d];
+				encoded[q * Stride + d] = static_cast<float>(m_Compression == FeatureCompression::Int8 ? value - m_Offset[d] : value);
+			}
+		}
+	}
+
+	double QuantizedMatrix::MinSummedDistance(const float* encodedQuery, size_t queryCount, size_t contourBegin, size_t contourEnd) const
+	{
+		float minDistance = std::numeric_limits<float>::infinity();
+		float stored[Stride];
+
+		for (size_t contour = contourBegin; contour < contourEnd; ++contour) {
+			bool finite = true;
+			if (m_Compression == FeatureCompression::Int8) {
+				const uint8_t* codes = m_Codes.data() + contour * Stride;
+				for (size_t d = 0; d < Stride; ++d) {
+					finite = finite && codes[d] != NonFiniteCode;
+					stored[d] = m_Scale[d] * static_cast<float>(codes[d]);
+				}
+			}
+			else {
+				std::copy_n(m_Floats.data() + contour * Stride, Stride, stored);
+				for (size_t d = 0; d < Stride; ++d)
+					finite = finite && std::isfinite(stored[d]);
+			}
+
+			// A non-finite moment puts the contour infinitely far from a finite query, as at full precision
+			if (!finite)
+				continue;
+
+			float distance = 0.0f;
+			for (size_t q = 0; q < queryCount; ++q) {
+				const float* vector = encodedQuery + q * Stride;
+				float sum = 0.0f;
+				for (size_t d = 0; d < Stride; ++d) {
+					float difference = vector[d] - stored[d];
+					sum += difference * difference;
+				}
+				distance += std::sqrt(sum);
+			}
+
+			minDistance = std::min(minDistance, distance);
+		}
+
+		return static_cast<double>(minDistance);
+	}
+
+	const char* QuantizedMatrix::GetName(FeatureCompression compression)
+	{
+		switch (compression) {
+		case FeatureCompression::Float32: return "float32";
+		case FeatureCompression::Int8: return "int8";
+		default: return "none";
+		}
+	}
+}
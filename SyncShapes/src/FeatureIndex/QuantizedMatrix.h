@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "FeatureMatrix.h"
+
+namespace SyncShapes
+{
+	enum class FeatureCompression
+	{
+		None,
+		Float32, // 32 bytes per contour instead of 64
+		Int8     // 8 bytes per contour: one code per dimension with a per-dimension scale and offset, plus a non-finite code
+	};
+
+	// Compact copy of the Hu vectors of a FeatureMatrix for a first, approximate scan. Only the best candidates
+	// of that scan are re-ranked on the full precision matrix, whose mapped pages otherwise stay cold.
+	// Contour indices and image ranges are those of the source matrix.
+	class QuantizedMatrix
+	{
+	public:
+		static constexpr size_t Stride = FeatureMatrix::Stride;
+
+		QuantizedMatrix();
+		~QuantizedMatrix();
+
+		void Build(const FeatureMatrix& matrix, FeatureCompression compression);
+		void Clear();
+
+		inline FeatureCompression GetCompression() const { return m_Compression; }
+		inline bool IsEmpty() const { return m_ContourCount == 0; }
+		inline size_t GetContourCount() const { return m_ContourCount; }
+		inline size_t GetByteSize() const { return m_Floats.size() * sizeof(float) + m_Codes.size(); }
+
+		// Moves query contours into the code space, 'encoded' receives Stride floats per contour
+		void EncodeQuery(const double* query, size_t queryCount, std::vector<float>& encoded) const;
+		// Approximation of HuDistance::MinSummedDistance against the stored contours [contourBegin, contourEnd)
+		double MinSummedDistance(const float* encodedQuery, size_t queryCount, size_t contourBegin, size_t contourEnd) const;
+
+		static const char* GetName(FeatureCompression compression);
+	private:
+		FeatureCompression m_Compression;
+		size_t m_ContourCount;
+		std::vector<float> m_Floats;
+		std::vector<uint8_t> m_Codes;
+
+		// Int8: value = offset + scale * code. The offset is folded into the encoded query.
+		// Finite values use codes 0-254, the last code marks an infinite or NaN moment.
+		static constexpr uint8_t NonFiniteCode = 255;
+		float m_Scale[Stride];
+		float m_Offset[Stride];
+	};
+}
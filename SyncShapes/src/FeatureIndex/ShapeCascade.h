@@ -0,0 +1,42 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+
+#include "FeatureStore/FeatureStore.h"
+
+namespace SyncShapes
+{
+	// First stage of a cascaded retrieval: whole-image descriptors are compared before any Hu vector is touched,
+	// images that differ too much on one of them are not scored at all. Heuristic, the Hu distance is not bounded
+	// by these values, so the tolerance trades recall for skipped comparisons.
+	namespace ShapeCascade
+	{
+		// |a - b| relative to the larger magnitude, in [0, 1] for values of the same sign. 0 if either is unknown.
+		inline double RelativeDifference(double a, double b)
+		{
+			if (std::isnan(a) || std::isnan(b))
+				return 0.0;
+
+			double scale = std::max(std::abs(a), std::abs(b));
+			return scale > 0.0 ? std::abs(a - b) / scale : 0.0;
+		}
+
+		// Largest relative difference over the descriptor values both images know
+		inline double Difference(const ShapeDescriptor& a, const ShapeDescriptor& b)
+		{
+			double difference = RelativeDifference(a.contourCount, b.contourCount);
+			difference = std::max(difference, RelativeDifference(a.areaFraction, b.areaFraction));
+			difference = std::max(difference, RelativeDifference(a.aspectRatio, b.aspectRatio));
+			difference = std::max(difference, RelativeDifference(a.solidity, b.solidity));
+			difference = std::max(difference, RelativeDifference(a.compactness, b.compactness));
+			return difference;
+		}
+
+		// A tolerance of 1 or more accepts every image
+		inline bool Accepts(const ShapeDescriptor& query, const ShapeDescriptor& candidate, double tolerance)
+		{
+			return tolerance >= 1.0 || Difference(query, candidate) <= tolerance;
+		}
+	}
+}
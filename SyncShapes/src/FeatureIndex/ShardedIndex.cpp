@@ -0,0 +1,203 @@
+#include "ShardedIndex.h"
+#include "HuDistance.h"
+#include "TopKSelector.h"
+#include "BatchExecutor/BatchExecutor.h"
+#include "Profiler/Profiler.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+
+namespace fs = std::filesystem;
+
+namespace SyncShapes
+{
+	ShardedIndex::ShardedIndex() {}
+	ShardedIndex::~ShardedIndex() {}
+
+	bool ShardedIndex::AddShard(const std::string& name, const std::string& storePath, bool approximate)
+	{
+		for (const auto& shard : m_Shards) {
+			if (shard->name == name) {
+				std::cerr << "A dataset named " << name << " is already loaded." << std::endl;
+				return false;
+			}
+		}
+
+		auto shard = std::make_unique<Shard>();
+		shard->name = name;
+		shard->storePath = storePath;
+		shard->approximate = approximate;
+
+		if (!OpenShard(*shard))
+			return false;
+
+		m_Shards.push_back(std::move(shard));
+		return true;
+	}
+
+	bool ShardedIndex::RemoveShard(const std::string& name)
+	{
+		auto it = std::find_if(m_Shards.begin(), m_Shards.end(), [&name](const std::unique_ptr<Shard>& shard) { return shard->name == name; });
+		if (it == m_Shards.end())
+			return false;
+
+		m_Shards.erase(it);
+		return true;
+	}
+
+	bool ShardedIndex::CloseStore(const std::string& storePath)
+	{
+		bool closed = false;
+		for (auto& shard : m_Shards) {
+			if (!IsStore(*shard, storePath))
+				continue;
+
+			shard->matrix.Clear();
+			shard->approximateIndex.Reset(shard->approximateIndex.GetParameters());
+			shard->store.Close();
+			closed = true;
+		}
+
+		return closed;
+	}
+
+	void ShardedIndex::ReopenStore(const std::string& storePath)
+	{
+		for (auto& shard : m_Shards) {
+			if (!shard->store.IsOpen() && IsStore(*shard, storePath))
+				OpenShard(*shard);
+		}
+	}
+
+	void ShardedIndex::Clear()
+	{
+		m_Shards.clear();
+	}
+
+	void ShardedIndex::SetSearchEf(uint32_t ef)
+	{
+		for (auto& shard : m_Shards)
+			shard->approximateIndex.SetSearchEf(ef);
+	}
+
+	std::string ShardedIndex::GetImageDirectory(size_t shard) const
+	{
+		return fs::path(m_Shards[shard]->storePath).parent_path().parent_path().string();
+	}
+
+	bool ShardedIndex::FindQuery(const std::string& imageName, std::vector<double>& features, size_t& contourCount) const
+	{
+		for (const auto& shard : m_Shards) {
+			size_t image = shard->matrix.FindImage(imageName);
+			if (image == FeatureMatrix::NotFound)
+				continue;
+
+			contourCount = shard->matrix.GetContourCount(image);
+			const double* contours = shard->matrix.GetImageContours(image);
+			features.assign(contours, contours + contourCount * FeatureMatrix::Stride);
+			return true;
+		}
+
+		return false;
+	}
+
+	std::vector<ShardMatch> ShardedIndex::Search(const double* queryFeatures, size_t queryCount, int topK) const
+	{
+		std::vector<ShardMatch> matches;
+		if (topK <= 0 || queryCount == 0 || m_Shards.empty())
+			return matches;
+
+		// Scatter: one task per shard, each keeps its own top K
+		std::vector<std::vector<std::pair<size_t, double>>> shardResults(m_Shards.size());
+		std::vector<char> searched(m_Shards.size(), 0);
+		BatchExecutor executor(static_cast<unsigned int>(m_Shards.size()));
+		BatchReport report = executor.Run(m_Shards.size(), [&](size_t shard, std::string&) {
+			shardResults[shard] = SearchShard(*m_Shards[shard], queryFeatures, queryCount, static_cast<size_t>(topK));
+			searched[shard] = 1;
+			return true;
+			});
+
+		// The other shards still answer, a failed one is reported and left out of the ranking
+		for (size_t shard = 0; shard < m_Shards.size() && !report.failures.empty(); ++shard) {
+			if (!searched[shard])
+				std::cerr << "Search failed in dataset " << m_Shards[shard]->name << std::endl;
+		}
+
+		// Gather: any global top K match is in the top K of its own shard
+		for (size_t shard = 0; shard < m_Shards.size(); ++shard) {
+			for (const auto& match : shardResults[shard])
+				matches.push_back({ shard, std::string(m_Shards[shard]->matrix.GetImageName(match.first)), match.second });
+		}
+
+		std::sort(matches.begin(), matches.end(), [](const ShardMatch& a, const ShardMatch& b) {
+			return a.distance != b.distance ? a.distance < b.distance : a.shard != b.shard ? a.shard < b.shard : a.image < b.image;
+			});
+		if (matches.size() > static_cast<size_t>(topK))
+			matches.resize(static_cast<size_t>(topK));
+
+		return matches;
+	}
+
+	bool ShardedIndex::OpenShard(Shard& shard)
+	{
+		if (!shard.store.Open(shard.storePath)) {
+			std::cerr << "Failed to load features from: " << shard.storePath << std::endl;
+			return false;
+		}
+		shard.matrix.Attach(shard.store);
+
+		// Same file the dataset's own approximate index is kept in
+		if (shard.approximate && !shard.matrix.IsEmpty()) {
+			std::string indexFileName = (fs::path(shard.storePath).parent_path() / "output_features.hnsw").string();
+			if (!shard.approximateIndex.Update(indexFileName, shard.matrix.GetFeatures(), shard.matrix.GetContourCount()))
+				std::cerr << "Failed to save the approximate index of: " << shard.name << std::endl;
+		}
+
+		return true;
+	}
+
+	bool ShardedIndex::IsStore(const Shard& shard, const std::string& storePath)
+	{
+		std::error_code error;
+		return shard.storePath == storePath || fs::equivalent(shard.storePath, storePath, error);
+	}
+
+	std::vector<std::pair<size_t, double>> ShardedIndex::SearchShard(const Shard& shard, const double* queryFeatures, size_t queryCount, size_t topK)
+	{
+		SS_PROFILE_SCOPE("shard_search");
+
+		const FeatureMatrix& matrix = shard.matrix;
+		TopKSelector selector(topK);
+
+		if (shard.approximate && !shard.approximateIndex.IsEmpty() && shard.approximateIndex.GetSize() == matrix.GetContourCount()) {
+			// The graph proposes candidate images per query contour, which are then scored exactly
+			const size_t ef = shard.approximateIndex.GetParameters().efSearch;
+
+			std::vector<size_t> candidates;
+			for (size_t contour = 0; contour < queryCount; ++contour) {
+				for (const auto& neighbour : shard.approximateIndex.Search(matrix.GetFeatures(), queryFeatures + contour * FeatureMatrix::Stride, ef, ef))
+					candidates.push_back(matrix.FindImageOfContour(neighbour.first));
+			}
+
+			std::sort(candidates.begin(), candidates.end());
+			candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+			for (size_t image : candidates)
+				selector.Push(image, HuDistance::MinSummedDistance(queryFeatures, queryCount, matrix.GetImageContours(image), matrix.GetContourCount(image)));
+		}
+		else {
+			for (size_t image = 0; image < matrix.GetImageCount(); ++image)
+				selector.Push(image, HuDistance::MinSummedDistance(queryFeatures, queryCount, matrix.GetImageContours(image), matrix.GetContourCount(image)));
+		}
+
+		return selector.Take();
+	}
+
+	std::string ShardedIndex::GetDatasetName(const std::string& storePath)
+	{
+		fs::path datasetDirectory = fs::absolute(storePath).parent_path().parent_path().parent_path();
+		std::string name = datasetDirectory.filename().string();
+		return name.empty() ? fs::path(storePath).stem().string() : name;
+	}
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "FeatureStore/FeatureStore.h"
+#include "FeatureMatrix.h"
+#include "HnswIndex.h"
+
+namespace SyncShapes
+{
+	struct ShardMatch
+	{
+		size_t shard;
+		std::string image;
+		double distance;
+	};
+
+	// Feature stores of several datasets searched side by side. Every shard maps its own store and keeps its own
+	// approximate index. A query is scattered to all shards at once, one task per shard, and the per-shard top K
+	// lists are merged, so latency follows the largest shard rather than the sum of the datasets.
+	class ShardedIndex
+	{
+	public:
+		ShardedIndex();
+		~ShardedIndex();
+
+		ShardedIndex(const ShardedIndex&) = delete;
+		ShardedIndex& operator=(const ShardedIndex&) = delete;
+
+		// Opens a store written by UpdateFeatureStore, 'name' tags its matches and must be unique
+		bool AddShard(const std::string& name, const std::string& storePath, bool approximate);
+		bool RemoveShard(const std::string& name);
+		// Unmaps the shards reading 'storePath' so the file can be replaced. They keep their place and settings,
+		// and find nothing until ReopenStore maps the file again. Returns false if no shard reads it.
+		bool CloseStore(const std::string& storePath);
+		void ReopenStore(const std::string& storePath);
+		void Clear();
+		void SetSearchEf(uint32_t ef);
+
+		inline size_t GetShardCount() const { return m_Shards.size(); }
+		inline const std::string& GetShardName(size_t shard) const { return m_Shards[shard]->name; }
+		inline const std::string& GetStorePath(size_t shard) const { return m_Shards[shard]->storePath; }
+		inline size_t GetImageCount(size_t shard) const { return m_Shards[shard]->matrix.GetImageCount(); }
+		// The pre-processing directory the shard's images were indexed from
+		std::string GetImageDirectory(size_t shard) const;
+
+		// Copies the contours of 'imageName' out of the first shard that has it
+		bool FindQuery(const std::string& imageName, std::vector<double>& features, size_t& contourCount) const;
+		// Global top K over every shard, ascending by distance
+		std::vector<ShardMatch> Search(const double* queryFeatures, size_t queryCount, int topK) const;
+
+		// Dataset name of a store at <dataset>/pre-processing/feature-extraction/output_features.dat
+		static std::string GetDatasetName(const std::string& storePath);
+	private:
+		struct Shard
+		{
+			std::string name;
+			std::string storePath;
+			FeatureStore store;
+			FeatureMatrix matrix;
+			HnswIndex approximateIndex;
+			bool approximate = false;
+		};
+
+		std::vector<std::unique_ptr<Shard>> m_Shards;
+
+		static bool OpenShard(Shard& shard);
+		static bool IsStore(const Shard& shard, const std::string& storePath);
+		static std::vector<std::pair<size_t, double>> SearchShard(const Shard& shard, const double* queryFeatures, size_t queryCount, size_t topK);
+	};
+}
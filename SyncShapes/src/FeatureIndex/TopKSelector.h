@@ -0,0 +1,56 @@
+#pragma once
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace SyncShapes
+{
+	// Keeps the K smallest (distance, id) pairs seen so far in a bounded max-heap, O(N log K) over N pushes.
+	// Ties are broken by id so results do not depend on the scan order.
+	class TopKSelector
+	{
+	public:
+		explicit TopKSelector(size_t k) : m_K(k) { m_Heap.reserve(k); }
+
+		// Distances at or above this can be skipped without calling Push
+		inline double GetThreshold() const
+		{
+			return m_Heap.size() < m_K ? std::numeric_limits<double>::infinity() : m_Heap.front().first;
+		}
+
+		inline void Push(size_t id, double distance)
+		{
+			if (m_K == 0)
+				return;
+
+			if (m_Heap.size() < m_K) {
+				m_Heap.emplace_back(distance, id);
+				std::push_heap(m_Heap.begin(), m_Heap.end());
+			}
+			else if (std::make_pair(distance, id) < m_Heap.front()) {
+				std::pop_heap(m_Heap.begin(), m_Heap.end());
+				m_Heap.back() = { distance, id };
+				std::push_heap(m_Heap.begin(), m_Heap.end());
+			}
+		}
+
+		// Results sorted by ascending distance as (id, distance) pairs, the selector is left empty
+		std::vector<std::pair<size_t, double>> Take()
+		{
+			std::sort_heap(m_Heap.begin(), m_Heap.end());
+
+			std::vector<std::pair<size_t, double>> results;
+			results.reserve(m_Heap.size());
+			for (const auto& entry : m_Heap)
+				results.emplace_back(entry.second, entry.first);
+
+			m_Heap.clear();
+			return results;
+		}
+	private:
+		size_t m_K;
+		std::vector<std::pair<double, size_t>> m_Heap;
+	};
+}
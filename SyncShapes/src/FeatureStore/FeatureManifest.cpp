@@ -0,0 +1,171 @@
+#include "FeatureManifest.h"
+#include "Profiler/Profiler.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+namespace SyncShapes
+{
+	namespace
+	{
+		const char* ManifestHeader = "SyncShapesManifest 2";
+		const std::string PipelinePrefix = "pipeline ";
+
+		inline uint64_t Mix(uint64_t value)
+		{
+			value ^= value >> 33;
+			value *= 0xff51afd7ed558ccdULL;
+			value ^= value >> 33;
+			value *= 0xc4ceb9fe1a85ec53ULL;
+			value ^= value >> 33;
+			return value;
+		}
+
+		const size_t HashBlockSize = 1 << 20;
+		const uint64_t HashSeed = 0x9e3779b97f4a7c15ULL;
+
+		uint64_t HashBlock(uint64_t state, const uint8_t* data, size_t size)
+		{
+			size_t offset = 0;
+			for (; offset + 8 <= size; offset += 8) {
+				uint64_t word;
+				std::memcpy(&word, data + offset, sizeof(word));
+				state = Mix(state ^ word) + HashSeed;
+			}
+
+			if (offset < size) {
+				uint64_t word = 0;
+				std::memcpy(&word, data + offset, size - offset);
+				state = Mix(state ^ word ^ (static_cast<uint64_t>(size - offset) << 56));
+			}
+
+			return state;
+		}
+	}
+
+	bool FeatureManifest::Load(const std::string& path)
+	{
+		Clear();
+
+		std::ifstream inputFileStream(path);
+		if (!inputFileStream.is_open())
+			return false;
+
+		std::string line;
+		if (!std::getline(inputFileStream, line) || line != ManifestHeader) {
+			std::cerr << "Unsupported manifest format: " << path << std::endl;
+			return false;
+		}
+
+		if (!std::getline(inputFileStream, line) || line.compare(0, PipelinePrefix.size(), PipelinePrefix) != 0) {
+			std::cerr << "Manifest is missing its pipeline tag: " << path << std::endl;
+			return false;
+		}
+		m_Pipeline = line.substr(PipelinePrefix.size());
+
+		while (std::getline(inputFileStream, line)) {
+			std::istringstream lineStream(line);
+			ManifestEntry entry;
+			std::string relativePath;
+
+			lineStream >> std::hex >> entry.contentHash >> std::dec >> entry.size >> entry.modifiedTime;
+			lineStream.get();
+			std::getline(lineStream, relativePath);
+
+			if (lineStream.fail() || relativePath.empty()) {
+				std::cerr << "Skipping malformed manifest line: " << line << std::endl;
+				continue;
+			}
+
+			m_Entries[relativePath] = entry;
+		}
+
+		return true;
+	}
+
+	bool FeatureManifest::Save(const std::string& path) const
+	{
+		// Sorted so the manifest diffs cleanly between runs
+		std::vector<const std::pair<const std::string, ManifestEntry>*> entries;
+		entries.reserve(m_Entries.size());
+		for (const auto& entry : m_Entries)
+			entries.push_back(&entry);
+
+		std::sort(entries.begin(), entries.end(), [](const auto* a, const auto* b) {
+			return a->first < b->first;
+			});
+
+		std::string tempPath = path + ".tmp";
+		std::ofstream outputFileStream(tempPath, std::ios::trunc);
+		if (!outputFileStream.is_open()) {
+			std::cerr << "Failed to open output file: " << tempPath << std::endl;
+			return false;
+		}
+
+		outputFileStream << ManifestHeader << "\n";
+		outputFileStream << PipelinePrefix << m_Pipeline << "\n";
+		for (const auto* entry : entries) {
+			outputFileStream << std::hex << entry->second.contentHash << std::dec << " " << entry->second.size << " " << entry->second.modifiedTime << " " << entry->first << "\n";
+		}
+
+		outputFileStream.close();
+		if (outputFileStream.fail()) {
+			std::cerr << "Failed to write manifest: " << tempPath << std::endl;
+			return false;
+		}
+
+		std::remove(path.c_str());
+		return std::rename(tempPath.c_str(), path.c_str()) == 0;
+	}
+
+	const ManifestEntry* FeatureManifest::Find(const std::string& relativePath) const
+	{
+		auto it = m_Entries.find(relativePath);
+		return it != m_Entries.end() ? &it->second : nullptr;
+	}
+
+	bool FeatureManifest::HashFile(const std::string& path, uint64_t& hash)
+	{
+		std::ifstream inputFileStream(path, std::ios::binary);
+		if (!inputFileStream.is_open())
+			return false;
+
+		// Word-at-a-time multiply/xorshift hash, fast enough to be bound by the disk rather than the CPU
+		std::vector<char> buffer(HashBlockSize);
+		uint64_t state = HashSeed;
+		uint64_t length = 0;
+
+		while (inputFileStream) {
+			inputFileStream.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+			size_t bytesRead = static_cast<size_t>(inputFileStream.gcount());
+			if (bytesRead == 0)
+				break;
+
+			state = HashBlock(state, reinterpret_cast<const uint8_t*>(buffer.data()), bytesRead);
+			length += bytesRead;
+		}
+
+		if (inputFileStream.bad())
+			return false;
+
+		hash = Mix(state ^ length);
+		return true;
+	}
+
+	uint64_t FeatureManifest::HashBytes(const uint8_t* data, size_t size)
+	{
+		SS_PROFILE_SCOPE("hash");
+
+		// Same block boundaries as the buffered file read, so both give the same hash for the same content
+		uint64_t state = HashSeed;
+		for (size_t offset = 0; offset < size; offset += HashBlockSize)
+			state = HashBlock(state, data + offset, std::min(HashBlockSize, size - offset));
+
+		return Mix(state ^ static_cast<uint64_t>(size));
+	}
+}
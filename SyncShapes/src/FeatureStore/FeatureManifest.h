@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+namespace SyncShapes
+{
+	struct ManifestEntry
+	{
+		uint64_t size = 0;
+		int64_t modifiedTime = 0;
+		uint64_t contentHash = 0;
+	};
+
+	// Per-file fingerprints of the images a feature store was built from, keyed by path relative to the dataset directory.
+	// Stored as text next to the feature store: a "pipeline <tag>" line naming how the features were computed,
+	// then one "<hash> <size> <mtime> <path>" line per file.
+	class FeatureManifest
+	{
+	public:
+		bool Load(const std::string& path);
+		bool Save(const std::string& path) const;
+
+		const ManifestEntry* Find(const std::string& relativePath) const;
+		inline void Set(const std::string& relativePath, const ManifestEntry& entry) { m_Entries[relativePath] = entry; }
+		inline void Clear() { m_Pipeline.clear(); m_Entries.clear(); }
+		inline size_t GetSize() const { return m_Entries.size(); }
+		inline const std::string& GetPipeline() const { return m_Pipeline; }
+		inline void SetPipeline(const std::string& pipeline) { m_Pipeline = pipeline; }
+
+		// 64-bit hash of the whole file content, returns false if the file cannot be read
+		static bool HashFile(const std::string& path, uint64_t& hash);
+		// The same hash over content that is already in memory
+		static uint64_t HashBytes(const uint8_t* data, size_t size);
+	private:
+		std::string m_Pipeline;
+		std::unordered_map<std::string, ManifestEntry> m_Entries;
+	};
+}
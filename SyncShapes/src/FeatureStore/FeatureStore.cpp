@@ -0,0 +1,392 @@
+#include "FeatureStore.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+
+namespace fs = std::filesystem;
+
+namespace SyncShapes
+{
+	namespace
+	{
+		inline uint64_t AlignUp(uint64_t value, uint64_t alignment)
+		{
+			return (value + alignment - 1) / alignment * alignment;
+		}
+
+		inline bool SectionFits(uint64_t offset, uint64_t size, size_t fileSize)
+		{
+			return offset <= fileSize && size <= fileSize - offset;
+		}
+	}
+
+	FeatureStore::FeatureStore() : m_Header(), m_Features(nullptr), m_ContourOffsets(nullptr), m_Descriptors(nullptr), m_NameOffsets(nullptr), m_SortedNames(nullptr), m_NameChars(nullptr) {}
+
+	FeatureStore::~FeatureStore()
+	{
+		Close();
+	}
+
+	bool FeatureStore::Open(const std::string& path)
+	{
+		Close();
+
+		if (!m_File.Open(path)) {
+			std::cerr << "Failed to map feature store: " << path << std::endl;
+			return false;
+		}
+
+		const size_t fileSize = m_File.GetSize();
+		if (fileSize < sizeof(FeatureStoreHeader)) {
+			std::cerr << "Feature store is truncated: " << path << std::endl;
+			Close();
+			return false;
+		}
+
+		std::memcpy(&m_Header, m_File.GetData(), sizeof(FeatureStoreHeader));
+
+		if (std::memcmp(m_Header.magic, Magic, sizeof(Magic)) != 0 || m_Header.version < FirstVersion || m_Header.version > Version
+			|| m_Header.dimension != Dimension || m_Header.stride != Stride) {
+			std::cerr << "Unsupported feature store format: " << path << std::endl;
+			Close();
+			return false;
+		}
+
+		// Every image takes at least two offsets and a sorted name entry, every contour a stride of doubles.
+		// Bounding the counts by the file size first keeps the section sizes below from overflowing.
+		if (m_Header.imageCount > fileSize / (3 * sizeof(uint64_t)) || m_Header.contourCount > fileSize / (Stride * sizeof(double))) {
+			std::cerr << "Feature store is corrupted: " << path << std::endl;
+			Close();
+			return false;
+		}
+
+		const uint64_t imageCount = m_Header.imageCount;
+		const uint64_t offsetsSize = (imageCount + 1) * sizeof(uint64_t);
+		const uint64_t nameTableFixedSize = offsetsSize + imageCount * sizeof(uint64_t);
+		const bool hasDescriptors = m_Header.version >= 2;
+		const uint64_t descriptorsOffset = AlignUp(m_Header.contourOffsetsOffset + offsetsSize, Alignment);
+
+		if (m_Header.featuresOffset % Alignment != 0 || m_Header.contourOffsetsOffset % sizeof(uint64_t) != 0 || m_Header.nameTableOffset % sizeof(uint64_t) != 0
+			|| !SectionFits(m_Header.featuresOffset, m_Header.contourCount * Stride * sizeof(double), fileSize)
+			|| !SectionFits(m_Header.contourOffsetsOffset, offsetsSize, fileSize)
+			|| (hasDescriptors && !SectionFits(descriptorsOffset, imageCount * sizeof(ShapeDescriptor), fileSize))
+			|| !SectionFits(m_Header.nameTableOffset, m_Header.nameTableSize, fileSize)
+			|| m_Header.nameTableSize < nameTableFixedSize) {
+			std::cerr << "Feature store is corrupted: " << path << std::endl;
+			Close();
+			return false;
+		}
+
+		const unsigned char* base = m_File.GetData();
+		m_Features = reinterpret_cast<const double*>(base + m_Header.featuresOffset);
+		m_ContourOffsets = reinterpret_cast<const uint64_t*>(base + m_Header.contourOffsetsOffset);
+		m_Descriptors = hasDescriptors ? reinterpret_cast<const ShapeDescriptor*>(base + descriptorsOffset) : nullptr;
+		m_NameOffsets = reinterpret_cast<const uint64_t*>(base + m_Header.nameTableOffset);
+		m_SortedNames = m_NameOffsets + imageCount + 1;
+		m_NameChars = reinterpret_cast<const char*>(m_SortedNames + imageCount);
+
+		if (!ValidateTables()) {
+			std::cerr << "Feature store is corrupted: " << path << std::endl;
+			Close();
+			return false;
+		}
+
+		m_Path = path;
+		return true;
+	}
+
+	bool FeatureStore::ValidateTables() const
+	{
+		// The accessors index the mapping with these values unchecked, a truncated or corrupt file must not get past here
+		const uint64_t imageCount = m_Header.imageCount;
+		const uint64_t nameCharsSize = m_Header.nameTableSize - (2 * imageCount + 1) * sizeof(uint64_t);
+
+		if (m_ContourOffsets[0] != 0 || m_ContourOffsets[imageCount] != m_Header.contourCount
+			|| m_NameOffsets[0] != 0 || m_NameOffsets[imageCount] > nameCharsSize)
+			return false;
+
+		for (uint64_t image = 0; image < imageCount; ++image) {
+			if (m_ContourOffsets[image] > m_ContourOffsets[image + 1] || m_NameOffsets[image] > m_NameOffsets[image + 1] || m_SortedNames[image] >= imageCount)
+				return false;
+		}
+
+		return true;
+	}
+
+	void FeatureStore::Close()
+	{
+		m_File.Close();
+		m_Path.clear();
+		m_Header = FeatureStoreHeader();
+		m_Features = nullptr;
+		m_ContourOffsets = nullptr;
+		m_Descriptors = nullptr;
+		m_NameOffsets = nullptr;
+		m_SortedNames = nullptr;
+		m_NameChars = nullptr;
+	}
+
+	std::string_view FeatureStore::GetImageName(size_t image) const
+	{
+		return std::string_view(m_NameChars + m_NameOffsets[image], static_cast<size_t>(m_NameOffsets[image + 1] - m_NameOffsets[image]));
+	}
+
+	size_t FeatureStore::FindImage(std::string_view name) const
+	{
+		// Binary search over the name-ordered index table, no hash map needs to be built at load time
+		const uint64_t* first = m_SortedNames;
+		const uint64_t* last = m_SortedNames + m_Header.imageCount;
+
+		const uint64_t* it = std::lower_bound(first, last, name, [this](uint64_t image, std::string_view value) {
+			return GetImageName(static_cast<size_t>(image)) < value;
+			});
+
+		if (it != last && GetImageName(static_cast<size_t>(*it)) == name)
+			return static_cast<size_t>(*it);
+
+		return NotFound;
+	}
+
+	FeatureData FeatureStore::GetFeatureData(size_t image) const
+	{
+		FeatureData data;
+		data.numShapes = static_cast<int>(GetContourEnd(image) - GetContourBegin(image));
+		data.shapeFeatures.reserve(data.numShapes);
+
+		for (size_t contour = GetContourBegin(image); contour < GetContourEnd(image); ++contour) {
+			const double* vector = GetContour(contour);
+			data.shapeFeatures.emplace_back(vector, vector + Dimension);
+		}
+
+		if (m_Descriptors)
+			data.descriptor = m_Descriptors[image];
+
+		return data;
+	}
+
+	bool FeatureStore::Write(const std::string& path, const std::unordered_map<std::string, FeatureData>& allFeatures)
+	{
+		// Write images in name order so the same features always produce the same file
+		std::vector<const std::pair<const std::string, FeatureData>*> entries;
+		entries.reserve(allFeatures.size());
+		for (const auto& entry : allFeatures)
+			entries.push_back(&entry);
+
+		std::sort(entries.begin(), entries.end(), [](const auto* a, const auto* b) {
+			return a->first < b->first;
+			});
+
+		FeatureStoreWriter writer;
+		if (!writer.Begin(path))
+			return false;
+
+		for (const auto* entry : entries) {
+			if (!writer.AddImage(entry->first, entry->second)) {
+				writer.Abort();
+				return false;
+			}
+		}
+
+		return writer.Finish();
+	}
+
+	bool FeatureStore::ExportText(const std::string& path, const std::unordered_map<std::string, FeatureData>& allFeatures)
+	{
+		std::ofstream outputFileStream(path);
+
+		if (!outputFileStream.is_open()) {
+			std::cerr << "Failed to open output file: " << path << std::endl;
+			return false;
+		}
+
+		for (const auto& entry : allFeatures) {
+			outputFileStream << entry.first << " " << entry.second.numShapes << " ";
+
+			for (const auto& feature_vector : entry.second.shapeFeatures) {
+				for (double moment : feature_vector) {
+					outputFileStream << std::setprecision(10) << moment << " ";
+				}
+			}
+
+			outputFileStream << "\n";
+		}
+
+		return true;
+	}
+
+	bool FeatureStore::ExportText(const std::string& path, const FeatureStore& store)
+	{
+		std::ofstream outputFileStream(path);
+
+		if (!outputFileStream.is_open()) {
+			std::cerr << "Failed to open output file: " << path << std::endl;
+			return false;
+		}
+
+		for (size_t image = 0; image < store.GetImageCount(); ++image) {
+			outputFileStream << store.GetImageName(image) << " " << (store.GetContourEnd(image) - store.GetContourBegin(image)) << " ";
+
+			for (size_t contour = store.GetContourBegin(image); contour < store.GetContourEnd(image); ++contour) {
+				for (size_t i = 0; i < Dimension; ++i) {
+					outputFileStream << std::setprecision(10) << store.GetContour(contour)[i] << " ";
+				}
+			}
+
+			outputFileStream << "\n";
+		}
+
+		return true;
+	}
+
+	FeatureStoreWriter::FeatureStoreWriter() : m_Failed(false) {}
+
+	FeatureStoreWriter::~FeatureStoreWriter()
+	{
+		if (m_Stream.is_open())
+			Abort();
+	}
+
+	bool FeatureStoreWriter::Begin(const std::string& path)
+	{
+		m_Path = path;
+		m_TempPath = path + ".tmp";
+		m_Names.clear();
+		m_ContourOffsets.assign(1, 0);
+		m_Descriptors.clear();
+		m_Failed = false;
+
+		m_Stream.open(m_TempPath, std::ios::binary | std::ios::trunc);
+		if (!m_Stream.is_open()) {
+			std::cerr << "Failed to open output file: " << m_TempPath << std::endl;
+			return false;
+		}
+
+		// Placeholder header, rewritten by Finish() once the counts are known
+		FeatureStoreHeader header = {};
+		m_Stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		Pad();
+
+		return m_Stream.good();
+	}
+
+	bool FeatureStoreWriter::AddImage(const std::string& name, const FeatureData& featureData)
+	{
+		double record[FeatureStore::Stride];
+
+		for (const auto& featureVector : featureData.shapeFeatures) {
+			std::fill(std::begin(record), std::end(record), 0.0);
+			std::copy_n(featureVector.begin(), std::min<size_t>(featureVector.size(), FeatureStore::Dimension), record);
+			m_Stream.write(reinterpret_cast<const char*>(record), sizeof(record));
+		}
+
+		m_Names.push_back(name);
+		m_ContourOffsets.push_back(m_ContourOffsets.back() + featureData.shapeFeatures.size());
+		m_Descriptors.push_back(featureData.descriptor);
+
+		m_Failed |= !m_Stream.good();
+		return !m_Failed;
+	}
+
+	bool FeatureStoreWriter::AddImage(const std::string& name, const double* features, size_t contourCount, const ShapeDescriptor& descriptor)
+	{
+		m_Stream.write(reinterpret_cast<const char*>(features), contourCount * FeatureStore::Stride * sizeof(double));
+
+		m_Names.push_back(name);
+		m_ContourOffsets.push_back(m_ContourOffsets.back() + contourCount);
+		m_Descriptors.push_back(descriptor);
+
+		m_Failed |= !m_Stream.good();
+		return !m_Failed;
+	}
+
+	bool FeatureStoreWriter::Finish()
+	{
+		if (!m_Stream.is_open())
+			return false;
+
+		if (m_Failed) {
+			std::cerr << "Failed to write feature store: " << m_TempPath << std::endl;
+			Abort();
+			return false;
+		}
+
+		const uint64_t imageCount = m_Names.size();
+
+		FeatureStoreHeader header = {};
+		std::memcpy(header.magic, FeatureStore::Magic, sizeof(header.magic));
+		header.version = FeatureStore::Version;
+		header.dimension = FeatureStore::Dimension;
+		header.stride = FeatureStore::Stride;
+		header.imageCount = imageCount;
+		header.contourCount = m_ContourOffsets.back();
+		header.featuresOffset = AlignUp(sizeof(FeatureStoreHeader), FeatureStore::Alignment);
+
+		Pad();
+		header.contourOffsetsOffset = static_cast<uint64_t>(m_Stream.tellp());
+		m_Stream.write(reinterpret_cast<const char*>(m_ContourOffsets.data()), m_ContourOffsets.size() * sizeof(uint64_t));
+
+		Pad();
+		m_Stream.write(reinterpret_cast<const char*>(m_Descriptors.data()), m_Descriptors.size() * sizeof(ShapeDescriptor));
+
+		std::vector<uint64_t> nameOffsets;
+		nameOffsets.reserve(imageCount + 1);
+		nameOffsets.push_back(0);
+		for (const auto& name : m_Names)
+			nameOffsets.push_back(nameOffsets.back() + name.size());
+
+		std::vector<uint64_t> sortedNames(imageCount);
+		std::iota(sortedNames.begin(), sortedNames.end(), 0);
+		std::sort(sortedNames.begin(), sortedNames.end(), [this](uint64_t a, uint64_t b) {
+			return m_Names[a] < m_Names[b];
+			});
+
+		Pad();
+		header.nameTableOffset = static_cast<uint64_t>(m_Stream.tellp());
+		m_Stream.write(reinterpret_cast<const char*>(nameOffsets.data()), nameOffsets.size() * sizeof(uint64_t));
+		m_Stream.write(reinterpret_cast<const char*>(sortedNames.data()), sortedNames.size() * sizeof(uint64_t));
+		for (const auto& name : m_Names)
+			m_Stream.write(name.data(), name.size());
+		header.nameTableSize = static_cast<uint64_t>(m_Stream.tellp()) - header.nameTableOffset;
+
+		m_Stream.seekp(0);
+		m_Stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		m_Stream.close();
+
+		if (m_Stream.fail()) {
+			std::cerr << "Failed to write feature store: " << m_TempPath << std::endl;
+			fs::remove(m_TempPath);
+			return false;
+		}
+
+		std::error_code error;
+		fs::rename(m_TempPath, m_Path, error);
+		if (error) {
+			std::cerr << "Failed to replace feature store " << m_Path << ": " << error.message() << std::endl;
+			fs::remove(m_TempPath, error);
+			return false;
+		}
+
+		return true;
+	}
+
+	void FeatureStoreWriter::Abort()
+	{
+		m_Stream.close();
+
+		std::error_code error;
+		fs::remove(m_TempPath, error);
+	}
+
+	void FeatureStoreWriter::Pad()
+	{
+		static const char zeros[FeatureStore::Alignment] = {};
+
+		uint64_t position = static_cast<uint64_t>(m_Stream.tellp());
+		uint64_t padding = AlignUp(position, FeatureStore::Alignment) - position;
+		m_Stream.write(zeros, static_cast<std::streamsize>(padding));
+	}
+}
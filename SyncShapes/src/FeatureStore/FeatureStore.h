@@ -0,0 +1,140 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "MappedFile.h"
+
+namespace SyncShapes
+{
+	// Whole-image shape summary computed in the same contour pass as the Hu vectors. Cheap enough to compare
+	// before the per-contour Hu distances, NaN marks a value that could not be computed.
+	struct ShapeDescriptor
+	{
+		static constexpr double Unknown = std::numeric_limits<double>::quiet_NaN();
+
+		double contourCount = Unknown;
+		double areaFraction = Unknown;  // summed contour area over image area
+		double aspectRatio = Unknown;   // short over long side of the box around all contours
+		double solidity = Unknown;      // summed contour area over summed convex hull area
+		double compactness = Unknown;   // perimeter^2 / (4 pi area) of the largest contour, 1 for a disc
+		double reserved[3] = { 0.0, 0.0, 0.0 };
+	};
+
+	static_assert(sizeof(ShapeDescriptor) == 64, "ShapeDescriptor must stay 64 bytes");
+
+	struct FeatureData {
+		int numShapes;
+		std::vector<std::vector<double>> shapeFeatures;
+		ShapeDescriptor descriptor;
+	};
+
+	// On-disk layout (little-endian), every section starts on a 64-byte boundary:
+	//   FeatureStoreHeader
+	//   double   features[contourCount * stride]   Hu vectors, zero padded from 'dimension' to 'stride'
+	//   uint64_t contourOffsets[imageCount + 1]    image i owns contours [contourOffsets[i], contourOffsets[i + 1])
+	//   ShapeDescriptor descriptors[imageCount]    version 2 only, at the first boundary after contourOffsets
+	//   uint64_t nameOffsets[imageCount + 1]       image i is named nameChars[nameOffsets[i] .. nameOffsets[i + 1])
+	//   uint64_t sortedNames[imageCount]           image indices in name order, used for lookups
+	//   char     nameChars[]
+	// Features come first so a writer can stream them out before the image count is known.
+	struct FeatureStoreHeader
+	{
+		char magic[4];
+		uint32_t version;
+		uint32_t dimension;
+		uint32_t stride;
+		uint64_t imageCount;
+		uint64_t contourCount;
+		uint64_t featuresOffset;
+		uint64_t contourOffsetsOffset;
+		uint64_t nameTableOffset;
+		uint64_t nameTableSize;
+	};
+
+	static_assert(sizeof(FeatureStoreHeader) == 64, "FeatureStoreHeader must stay 64 bytes");
+
+	class FeatureStore
+	{
+	public:
+		static constexpr char Magic[4] = { 'S', 'S', 'F', 'S' };
+		static constexpr uint32_t Version = 2;
+		static constexpr uint32_t FirstVersion = 1;
+		static constexpr uint32_t Dimension = 7;
+		static constexpr uint32_t Stride = 8;
+		static constexpr size_t Alignment = 64;
+		static constexpr size_t NotFound = static_cast<size_t>(-1);
+
+		FeatureStore();
+		~FeatureStore();
+
+		bool Open(const std::string& path);
+		void Close();
+
+		inline bool IsOpen() const { return m_File.IsOpen(); }
+		inline const std::string& GetPath() const { return m_Path; }
+
+		inline size_t GetImageCount() const { return static_cast<size_t>(m_Header.imageCount); }
+		inline size_t GetContourCount() const { return static_cast<size_t>(m_Header.contourCount); }
+		inline const double* GetFeatures() const { return m_Features; }
+		inline size_t GetContourBegin(size_t image) const { return static_cast<size_t>(m_ContourOffsets[image]); }
+		inline size_t GetContourEnd(size_t image) const { return static_cast<size_t>(m_ContourOffsets[image + 1]); }
+		inline const double* GetContour(size_t contour) const { return m_Features + contour * Stride; }
+		// Stores written before version 2 have no descriptors
+		inline bool HasDescriptors() const { return m_Descriptors != nullptr; }
+		inline const ShapeDescriptor* GetDescriptors() const { return m_Descriptors; }
+
+		std::string_view GetImageName(size_t image) const;
+		size_t FindImage(std::string_view name) const;
+		FeatureData GetFeatureData(size_t image) const;
+
+		static bool Write(const std::string& path, const std::unordered_map<std::string, FeatureData>& allFeatures);
+		static bool ExportText(const std::string& path, const std::unordered_map<std::string, FeatureData>& allFeatures);
+		static bool ExportText(const std::string& path, const FeatureStore& store);
+	private:
+		MappedFile m_File;
+		std::string m_Path;
+		FeatureStoreHeader m_Header;
+		const double* m_Features;
+		const uint64_t* m_ContourOffsets;
+		const ShapeDescriptor* m_Descriptors;
+		const uint64_t* m_NameOffsets;
+		const uint64_t* m_SortedNames;
+		const char* m_NameChars;
+
+		// Offsets ascending and within their sections, sorted name entries valid image indices
+		bool ValidateTables() const;
+	};
+
+	// Streams images into a new store. Output goes to '<path>.tmp' and replaces 'path' only once Finish() succeeds.
+	class FeatureStoreWriter
+	{
+	public:
+		FeatureStoreWriter();
+		~FeatureStoreWriter();
+
+		bool Begin(const std::string& path);
+		bool AddImage(const std::string& name, const FeatureData& featureData);
+		// 'features' holds contourCount stride-padded vectors, as returned by FeatureStore::GetContour
+		bool AddImage(const std::string& name, const double* features, size_t contourCount, const ShapeDescriptor& descriptor);
+		bool Finish();
+		void Abort();
+
+		inline size_t GetImageCount() const { return m_Names.size(); }
+	private:
+		std::string m_Path;
+		std::string m_TempPath;
+		std::ofstream m_Stream;
+		std::vector<std::string> m_Names;
+		std::vector<uint64_t> m_ContourOffsets;
+		std::vector<ShapeDescriptor> m_Descriptors;
+		bool m_Failed;
+
+		void Pad();
+	};
+}
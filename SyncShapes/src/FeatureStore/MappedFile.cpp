@@ -0,0 +1,111 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace SyncShapes
+{
+#ifdef _WIN32
+	MappedFile::MappedFile() : m_Data(nullptr), m_Size(0), m_FileHandle(INVALID_HANDLE_VALUE), m_MappingHandle(nullptr) {}
+#else
+	MappedFile::MappedFile() : m_Data(nullptr), m_Size(0), m_FileDescriptor(-1) {}
+#endif
+
+	MappedFile::~MappedFile()
+	{
+		Close();
+	}
+
+#ifdef _WIN32
+	bool MappedFile::Open(const std::string& path)
+	{
+		Close();
+
+		m_FileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, NULL);
+		if (m_FileHandle == INVALID_HANDLE_VALUE)
+			return false;
+
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(m_FileHandle, &fileSize) || fileSize.QuadPart == 0) {
+			Close();
+			return false;
+		}
+
+		m_MappingHandle = CreateFileMappingA(m_FileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (!m_MappingHandle) {
+			Close();
+			return false;
+		}
+
+		m_Data = static_cast<const unsigned char*>(MapViewOfFile(m_MappingHandle, FILE_MAP_READ, 0, 0, 0));
+		if (!m_Data) {
+			Close();
+			return false;
+		}
+
+		m_Size = static_cast<size_t>(fileSize.QuadPart);
+		return true;
+	}
+
+	void MappedFile::Close()
+	{
+		if (m_Data)
+			UnmapViewOfFile(m_Data);
+		if (m_MappingHandle)
+			CloseHandle(m_MappingHandle);
+		if (m_FileHandle != INVALID_HANDLE_VALUE)
+			CloseHandle(m_FileHandle);
+
+		m_Data = nullptr;
+		m_Size = 0;
+		m_MappingHandle = nullptr;
+		m_FileHandle = INVALID_HANDLE_VALUE;
+	}
+#else
+	bool MappedFile::Open(const std::string& path)
+	{
+		Close();
+
+		m_FileDescriptor = open(path.c_str(), O_RDONLY);
+		if (m_FileDescriptor < 0)
+			return false;
+
+		struct stat fileStat;
+		if (fstat(m_FileDescriptor, &fileStat) != 0 || fileStat.st_size == 0) {
+			Close();
+			return false;
+		}
+
+		void* data = mmap(nullptr, static_cast<size_t>(fileStat.st_size), PROT_READ, MAP_SHARED, m_FileDescriptor, 0);
+		if (data == MAP_FAILED) {
+			Close();
+			return false;
+		}
+
+		m_Data = static_cast<const unsigned char*>(data);
+		m_Size = static_cast<size_t>(fileStat.st_size);
+		return true;
+	}
+
+	void MappedFile::Close()
+	{
+		if (m_Data)
+			munmap(const_cast<unsigned char*>(m_Data), m_Size);
+		if (m_FileDescriptor >= 0)
+			close(m_FileDescriptor);
+
+		m_Data = nullptr;
+		m_Size = 0;
+		m_FileDescriptor = -1;
+	}
+#endif
+}
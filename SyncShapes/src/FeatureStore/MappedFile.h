@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace SyncShapes
+{
+	// Read-only memory mapping of a whole file
+	class MappedFile
+	{
+	public:
+		MappedFile();
+		~MappedFile();
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		bool Open(const std::string& path);
+		void Close();
+
+		inline bool IsOpen() const { return m_Data != nullptr; }
+		inline const unsigned char* GetData() const { return m_Data; }
+		inline size_t GetSize() const { return m_Size; }
+	private:
+		const unsigned char* m_Data;
+		size_t m_Size;
+
+#ifdef _WIN32
+		void* m_FileHandle;
+		void* m_MappingHandle;
+#else
+		int m_FileDescriptor;
+#endif
+	};
+}
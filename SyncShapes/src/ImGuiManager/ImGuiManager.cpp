@@ -1,10 +1,16 @@
 #include <windows.h>  // Windows header for API functions
 #include <commdlg.h>  // Windows file dialog header
 #include "ImGuiManager.h"
+#include "FeatureIndex/HuDistance.h"
+
+#include <cfloat>
+#include <limits>
+#include <numeric>
+#include <unordered_map>
 
 namespace SyncShapes
 {
-	ImGuiManager::ImGuiManager(GLFWwindow* window) : m_Window(window), m_ImagePath(""), m_TextureID(0), m_TextureID2(0)
+	ImGuiManager::ImGuiManager(GLFWwindow* window) : m_Window(window), m_ImagePath(""), m_TextureID(0), m_TextureID2(0), m_ViewContourOverlay(false), m_SelectedCluster(ClusterIndex::NoCluster)
 	{
 		IMGUI_CHECKVERSION();
 		ImGui::CreateContext();
@@ -16,11 +22,17 @@ namespace SyncShapes
 		ImGui_ImplGlfw_InitForOpenGL(window, true);
 		ImGui_ImplOpenGL3_Init("#version 330 core");
 
-		m_LogBuffer.push_back("All subsystems initialized and ready to work!");
+		// Background work wakes the render loop when it sits idle in glfwWaitEventsTimeout, glfwPostEmptyEvent is thread-safe
+		m_Jobs.SetWakeCallback([] { glfwPostEmptyEvent(); });
+		m_Log.SetWakeCallback([] { glfwPostEmptyEvent(); });
+
+		Log("All subsystems initialized and ready to work!");
 		std::cout << "ImGuiManager initialized" << std::endl;
 	}
 
 	ImGuiManager::~ImGuiManager() {
+		m_Textures.Clear();
+
 		ImGui_ImplOpenGL3_Shutdown();
 		ImGui_ImplGlfw_Shutdown();
 		ImGui::DestroyContext();
@@ -37,14 +49,24 @@ namespace SyncShapes
 	}
 
 	void ImGuiManager::Render() {
+		m_Jobs.PublishCompleted();
+
 		ShowImageProcessingEditor();
 		ShowViewport();
+		ShowResults();
+		ShowClusters();
+		ShowPerformance();
 		ShowLogger();
 
 		ImGui::Render();
 		ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 	}
 
+	bool ImGuiManager::IsAnimating() const
+	{
+		return m_Jobs.IsBusy() || m_Gallery.IsLoading() || ImGui::IsAnyItemActive() || ImGui::GetIO().WantTextInput;
+	}
+
 	void ImGuiManager::ShowImageProcessingEditor() {
 		ImGui::Begin("Editor");
 
@@ -53,8 +75,24 @@ namespace SyncShapes
 		ImGui::TextWrapped("A lightweight yet powerful content-based image retrieval system. It focuses on efficient shape synchronization, allowing users to retrieve images based on their shape features.");
 
 		ImGui::Separator(); ImGui::Spacing();
+		ShowJobStatus();
+
+		// Pipeline settings are read by the running job, so they stay locked until it finishes
+		ImGui::BeginDisabled(m_Jobs.IsBusy());
+
 		ImGui::TextWrapped("Query An Image:");
 
+		// Intermediates format, lossless run-length masks by default, JPEG for inspection in external viewers
+		ImGui::Spacing();
+		static bool useMaskIntermediates = true;
+		if (ImGui::Checkbox("Lossless Mask Intermediates (.ssm)", &useMaskIntermediates)) {
+			ImageProcessor::m_IntermediateExtension = useMaskIntermediates ? MaskCodec::Extension : ".jpg";
+		}
+
+		// Without conversion the dataset is read straight from the GIFs by the fused ingest
+		static bool convertOnLoad = true;
+		ImGui::Checkbox("Convert GIFs On Load", &convertOnLoad);
+
 		// File Dialog for Image Loading
 		ImGui::Spacing();
 		if (ImGui::Button("Load Image From Dataset")) {
@@ -82,11 +120,43 @@ namespace SyncShapes
 			std::string WorkingDirectoryPath = fs::path(m_ImagePath).parent_path().string();
 			Log("Dataset Directory Path: ", WorkingDirectoryPath);
 
-			auto imagesConversionStartTime = std::chrono::high_resolution_clock::now();
-			ImageProcessor::ConvertAllGIFsToJPEGs(m_ImagePath);
-			auto imagesConversionEndTime = std::chrono::high_resolution_clock::now();
-			auto imagesConversionDuration = std::chrono::duration_cast<std::chrono::seconds>(imagesConversionEndTime - imagesConversionStartTime);
-			Log("Pre-Processing: converting GIFs to JPEGs completed. Time: " + std::to_string(imagesConversionDuration.count()) + " s.");
+			std::string imagePath = m_ImagePath;
+			bool convert = convertOnLoad;
+			SubmitJob("Converting GIFs", [imagePath, convert](BatchProgress& progress, JobOutcome& outcome) {
+				if (convert) {
+					auto imagesConversionStartTime = std::chrono::high_resolution_clock::now();
+					BatchReport report = ImageProcessor::ConvertAllGIFs(imagePath);
+					auto imagesConversionEndTime = std::chrono::high_resolution_clock::now();
+					auto imagesConversionDuration = std::chrono::duration_cast<std::chrono::milliseconds>(imagesConversionEndTime - imagesConversionStartTime);
+
+					if (progress.IsCancelled()) {
+						outcome.messages.push_back("Warning: Converting GIFs cancelled after " + std::to_string(report.succeeded) + " files.");
+						return;
+					}
+					outcome.messages.push_back("Pre-Processing: converting GIFs to " + ImageProcessor::m_IntermediateExtension + " completed. Time: " + std::to_string(imagesConversionDuration.count()) + " ms.");
+					AddBatchReport(outcome, "Converting GIFs", report);
+				}
+				else {
+					fs::path outputDirectory = ImageProcessor::GetPreprocessingDirectory(fs::path(imagePath).parent_path().string());
+					fs::create_directory(outputDirectory); ImageProcessor::m_PreprocessingDir = outputDirectory.string();
+					outcome.messages.push_back("GIF conversion skipped, use Fused Ingest with Decode GIFs Directly.");
+				}
+
+				// Reuse the feature index of a previous session if the dataset already has one
+				fs::path featureIndexPath = fs::path(ImageProcessor::m_PreprocessingDir) / "feature-extraction" / "output_features.dat";
+				if (!ImageProcessor::m_PreprocessingDir.empty() && fs::exists(featureIndexPath)) {
+					auto featureLoadingStartTime = std::chrono::high_resolution_clock::now();
+					if (ImageProcessor::LoadFeaturesFromFile(featureIndexPath.string())) {
+						outcome.contoursOverlay = true;
+						auto featureLoadingEndTime = std::chrono::high_resolution_clock::now();
+						auto featureLoadingDuration = std::chrono::duration_cast<std::chrono::milliseconds>(featureLoadingEndTime - featureLoadingStartTime);
+						outcome.messages.push_back("Feature index loaded: " + std::to_string(ImageProcessor::m_FeatureStore.GetImageCount()) + " images. Time: " + std::to_string(featureLoadingDuration.count()) + " ms.");
+					}
+					else {
+						outcome.messages.push_back("Warning: Existing feature index could not be loaded, please apply Feature Extraction again.");
+					}
+				}
+				});
 		}
 
 		ImGui::Separator(); ImGui::Spacing();
@@ -108,6 +178,13 @@ namespace SyncShapes
 		static bool applyContourAreaFiltering = false;
 		ImGui::Checkbox("Apply Contour Area Filtering", &applyContourAreaFiltering);
 
+		ImGui::Spacing();
+		static int workerCount = 0;
+		if (ImGui::InputInt("Worker Threads (0 = auto)", &workerCount)) {
+			workerCount = std::max(0, workerCount);
+			ImageProcessor::m_WorkerCount = static_cast<unsigned int>(workerCount);
+		}
+
 		ImGui::Spacing();
 		if (ImGui::Button("Apply Preprocessing")) {
 			if (!ImageProcessor::m_PreprocessingDir.empty()) {
@@ -115,52 +192,44 @@ namespace SyncShapes
 					Log("Warning: No preprocessing option selected. Please choose at least one option.");
 				}
 				else {
-					if (applyNoiseRemoval && applyHoleFilling && applyHistogramEqualization) {
-						auto bothOperationsStartTime = std::chrono::high_resolution_clock::now();
-						ImageProcessor::ApplyAllToDirectory(ImageProcessor::m_PreprocessingDir);
-						auto bothOperationsEndTime = std::chrono::high_resolution_clock::now();
-						auto bothOperationsDuration = std::chrono::duration_cast<std::chrono::seconds>(bothOperationsEndTime - bothOperationsStartTime);
-						Log("Pre-Processing: Noise Removal, Hole Filling, Histogram Equalization, and Contour Area Filtering completed. Time: " + std::to_string(bothOperationsDuration.count()) + " s.");
+					int selectedOptionsCount = (applyNoiseRemoval ? 1 : 0) + (applyHoleFilling ? 1 : 0) + (applyHistogramEqualization ? 1 : 0);
+					bool applyAll = applyNoiseRemoval && applyHoleFilling && applyHistogramEqualization;
+
+					if (!applyAll && selectedOptionsCount == 2) {
+						Log("Warning: Preprocessing allows for individual operation testing or all applied together for the retrieval system main aim or output.");
 					}
 					else {
-						int selectedOptionsCount = (applyNoiseRemoval ? 1 : 0) + (applyHoleFilling ? 1 : 0) + (applyHistogramEqualization ? 1 : 0);
-
-						if (selectedOptionsCount == 2) {
-							Log("Warning: Preprocessing allows for individual operation testing or all applied together for the retrieval system main aim or output.");
-						}
-						else {
-							if (applyNoiseRemoval) {
-								auto noiseRemovalStartTime = std::chrono::high_resolution_clock::now();
-								ImageProcessor::ApplyNoiseRemovalToDirectory(ImageProcessor::m_PreprocessingDir);
-								auto noiseRemovalEndTime = std::chrono::high_resolution_clock::now();
-								auto noiseRemovalDuration = std::chrono::duration_cast<std::chrono::seconds>(noiseRemovalEndTime - noiseRemovalStartTime);
-								Log("Pre-Processing: Noise Removal completed. Time: " + std::to_string(noiseRemovalDuration.count()) + " s.");
+						std::string directory = ImageProcessor::m_PreprocessingDir;
+						bool noiseRemoval = applyNoiseRemoval, holeFilling = applyHoleFilling, histogramEqualization = applyHistogramEqualization, contourAreaFiltering = applyContourAreaFiltering;
+
+						SubmitJob("Pre-Processing", [=](BatchProgress& progress, JobOutcome& outcome) {
+							// Runs one directory pass and logs it, later passes are skipped once the job is cancelled
+							auto runStage = [&](const std::string& stage, const std::function<BatchReport()>& apply) {
+								if (progress.IsCancelled())
+									return;
+
+								auto stageStartTime = std::chrono::high_resolution_clock::now();
+								BatchReport report = apply();
+								auto stageEndTime = std::chrono::high_resolution_clock::now();
+								auto stageDuration = std::chrono::duration_cast<std::chrono::milliseconds>(stageEndTime - stageStartTime);
+								outcome.messages.push_back("Pre-Processing: " + stage + " completed. Time: " + std::to_string(stageDuration.count()) + " ms.");
+								AddBatchReport(outcome, stage, report);
+							};
+
+							if (applyAll) {
+								runStage("Noise Removal, Hole Filling, Histogram Equalization, and Contour Area Filtering", [&] { return ImageProcessor::ApplyAllToDirectory(directory); });
+								return;
 							}
 
-							if (applyHoleFilling) {
-								auto holeFillingStartTime = std::chrono::high_resolution_clock::now();
-								ImageProcessor::ApplyHoleFillingToDirectory(ImageProcessor::m_PreprocessingDir);
-								auto holeFillingEndTime = std::chrono::high_resolution_clock::now();
-								auto holeFillingDuration = std::chrono::duration_cast<std::chrono::seconds>(holeFillingEndTime - holeFillingStartTime);
-								Log("Pre-Processing: Hole Filling completed. Time: " + std::to_string(holeFillingDuration.count()) + " s.");
-							}
-
-							if (applyHistogramEqualization) {
-								auto histogramEqualizationStartTime = std::chrono::high_resolution_clock::now();
-								ImageProcessor::ApplyHistogramEqualizationToDirectory(ImageProcessor::m_PreprocessingDir);
-								auto histogramEqualizationEndTime = std::chrono::high_resolution_clock::now();
-								auto histogramEqualizationDuration = std::chrono::duration_cast<std::chrono::seconds>(histogramEqualizationEndTime - histogramEqualizationStartTime);
-								Log("Pre-Processing: Histogram Equalization completed. Time: " + std::to_string(histogramEqualizationDuration.count()) + " s.");
-							}
-
-							if (applyContourAreaFiltering) {
-								auto contourAreaFilteringStartTime = std::chrono::high_resolution_clock::now();
-								ImageProcessor::ApplyContourAreaFilteringToDirectory(ImageProcessor::m_PreprocessingDir, 300);
-								auto contourAreaFilteringEndTime = std::chrono::high_resolution_clock::now();
-								auto contourAreaFilteringDuration = std::chrono::duration_cast<std::chrono::seconds>(contourAreaFilteringEndTime - contourAreaFilteringStartTime);
-								Log("Pre-Processing: Contour Area Filtering completed. Time: " + std::to_string(contourAreaFilteringDuration.count()) + " s.");
-							}
-						}
+							if (noiseRemoval)
+								runStage("Noise Removal", [&] { return ImageProcessor::ApplyNoiseRemovalToDirectory(directory); });
+							if (holeFilling)
+								runStage("Hole Filling", [&] { return ImageProcessor::ApplyHoleFillingToDirectory(directory); });
+							if (histogramEqualization)
+								runStage("Histogram Equalization", [&] { return ImageProcessor::ApplyHistogramEqualizationToDirectory(directory); });
+							if (contourAreaFiltering)
+								runStage("Contour Area Filtering", [&] { return ImageProcessor::ApplyContourAreaFilteringToDirectory(directory, 300); });
+							});
 					}
 				}
 			}
@@ -190,52 +259,271 @@ namespace SyncShapes
 		ImGui::Spacing(); ImGui::Spacing();
 		ImGui::TextWrapped("Feature Extraction with Hu Moments. Hu Moments are seven numerical values that describe the shape characteristics of an image. They are invariant to translation, scale, and rotation, making them suitable for shape recognition.");
 
+		ImGui::Spacing();
+		ImGui::Checkbox("Export Features As Text", &ImageProcessor::m_ExportFeaturesAsText);
+
 		ImGui::Spacing();
 		if (ImGui::Button("Apply Feature Extraction"))
 		{
 			if (!ImageProcessor::m_PreprocessingDir.empty())
 			{
-				auto FeatureExtractionStartTime = std::chrono::high_resolution_clock::now();
-				ImageProcessor::ExtractShapeFeaturesAndSave(ImageProcessor::m_PreprocessingDir); ImageProcessor::m_ContoursOverlay = true;
-				auto FeatureExtractionEndTime = std::chrono::high_resolution_clock::now();
-				auto FeatureExtractionDuration = std::chrono::duration_cast<std::chrono::seconds>(FeatureExtractionEndTime - FeatureExtractionStartTime);
-				Log("Feature Extraction with Hu Moments completed. Time: " + std::to_string(FeatureExtractionDuration.count()) + " s.");
+				std::string directory = ImageProcessor::m_PreprocessingDir;
+				SubmitJob("Feature Extraction", [directory](BatchProgress&, JobOutcome& outcome) {
+					auto FeatureExtractionStartTime = std::chrono::high_resolution_clock::now();
+					FeatureUpdateReport report = ImageProcessor::ExtractShapeFeaturesAndSave(directory); outcome.contoursOverlay = true;
+					auto FeatureExtractionEndTime = std::chrono::high_resolution_clock::now();
+					auto FeatureExtractionDuration = std::chrono::duration_cast<std::chrono::milliseconds>(FeatureExtractionEndTime - FeatureExtractionStartTime);
+					outcome.messages.push_back("Feature Extraction with Hu Moments completed. Time: " + std::to_string(FeatureExtractionDuration.count()) + " ms.");
+					AddFeatureUpdateReport(outcome, "Feature Extraction", report);
+					});
 			}
 			else
 				Log("Error: Cannot apply Feature Extraction. Please apply Pre-processing first.");
 		}
 
+		ImGui::Spacing();
+		static bool writePreprocessedImages = false;
+		ImGui::Checkbox("Write Preprocessed Images", &writePreprocessedImages);
+
+		static bool decodeGIFsDirectly = false;
+		ImGui::Checkbox("Decode GIFs Directly", &decodeGIFsDirectly);
+
+		static bool writeConvertedImages = true;
+		ImGui::BeginDisabled(!decodeGIFsDirectly);
+		ImGui::SameLine();
+		ImGui::Checkbox("Write Converted Images", &writeConvertedImages);
+		ImGui::EndDisabled();
+
+		if (ImGui::Button("Fused Ingest (Preprocess + Extract)"))
+		{
+			if (!ImageProcessor::m_PreprocessingDir.empty())
+			{
+				IngestOptions options;
+				options.noiseRemoval = applyNoiseRemoval;
+				options.holeFilling = applyHoleFilling;
+				options.histogramEqualization = applyHistogramEqualization;
+				options.contourAreaFiltering = applyContourAreaFiltering;
+				options.writeIntermediates = writePreprocessedImages;
+
+				std::string directory = ImageProcessor::m_PreprocessingDir;
+				bool fromGIFs = decodeGIFsDirectly, writeConverted = writeConvertedImages;
+				SubmitJob("Fused Ingest", [directory, options, fromGIFs, writeConverted](BatchProgress&, JobOutcome& outcome) {
+					auto ingestStartTime = std::chrono::high_resolution_clock::now();
+					FeatureUpdateReport report = fromGIFs
+						? ImageProcessor::IngestGIFDirectory(fs::path(directory).parent_path().string(), options, writeConverted)
+						: ImageProcessor::IngestDirectory(directory, options);
+					outcome.contoursOverlay = true;
+					auto ingestEndTime = std::chrono::high_resolution_clock::now();
+					auto ingestDuration = std::chrono::duration_cast<std::chrono::milliseconds>(ingestEndTime - ingestStartTime);
+					outcome.messages.push_back("Fused Ingest: pre-processing and feature extraction completed. Time: " + std::to_string(ingestDuration.count()) + " ms.");
+					AddFeatureUpdateReport(outcome, "Fused Ingest", report);
+					});
+			}
+			else
+				Log("Error: Cannot apply Fused Ingest. Please load an image from the dataset first.");
+		}
+
 		ImGui::Separator(); ImGui::Spacing();
 		ImGui::TextWrapped("Image Retrieval:");
 
 		static int topK = 5;
 		ImGui::InputInt("Similar Images Count", &topK);
 
-		ImGui::Spacing();
-		if (ImGui::Button("Apply Retrieval"))
+		if (ImGui::Checkbox("Use Approximate Index (HNSW)", &ImageProcessor::m_UseApproximateIndex) && ImageProcessor::m_UseApproximateIndex)
 		{
 			if (!ImageProcessor::m_FeatureExtractionDir.empty())
 			{
-				auto ImageRetrievalStartTime = std::chrono::high_resolution_clock::now();
+				SubmitJob("Approximate Index", [](BatchProgress&, JobOutcome& outcome) {
+					auto approximateIndexStartTime = std::chrono::high_resolution_clock::now();
+					bool indexReady = ImageProcessor::UpdateApproximateIndex();
+					auto approximateIndexEndTime = std::chrono::high_resolution_clock::now();
+					auto approximateIndexDuration = std::chrono::duration_cast<std::chrono::milliseconds>(approximateIndexEndTime - approximateIndexStartTime);
+
+					if (indexReady)
+						outcome.messages.push_back("Approximate index ready: " + std::to_string(ImageProcessor::m_ApproximateIndex.GetSize()) + " contours. Time: " + std::to_string(approximateIndexDuration.count()) + " ms.");
+					else
+						outcome.messages.push_back("Warning: Approximate index could not be built or saved.");
+					});
+			}
+		}
 
-				std::string imageNameWithoutExtension = fs::path(m_ImagePath).stem().string();
-				std::vector<std::pair<std::string, double>> retrievalResults = ImageProcessor::RetrieveImages(imageNameWithoutExtension, topK);
+		if (ImageProcessor::m_UseApproximateIndex)
+		{
+			// Larger candidate lists trade latency for recall
+			static int searchEf = static_cast<int>(ImageProcessor::m_ApproximateIndex.GetParameters().efSearch);
+			if (ImGui::SliderInt("Search Candidates (ef)", &searchEf, 8, 512)) {
+				ImageProcessor::m_ApproximateIndex.SetSearchEf(static_cast<uint32_t>(searchEf));
+				ImageProcessor::m_Datasets.SetSearchEf(static_cast<uint32_t>(searchEf));
+			}
+		}
+
+		if (ImGui::Checkbox("Use Cluster Index (IVF)", &ImageProcessor::m_UseClusterIndex) && ImageProcessor::m_UseClusterIndex)
+		{
+			if (!ImageProcessor::m_FeatureExtractionDir.empty())
+			{
+				SubmitJob("Cluster Index", [](BatchProgress&, JobOutcome& outcome) {
+					auto clusterIndexStartTime = std::chrono::high_resolution_clock::now();
+					bool indexReady = ImageProcessor::UpdateClusterIndex();
+					auto clusterIndexEndTime = std::chrono::high_resolution_clock::now();
+					auto clusterIndexDuration = std::chrono::duration_cast<std::chrono::milliseconds>(clusterIndexEndTime - clusterIndexStartTime);
+
+					if (indexReady)
+						outcome.messages.push_back("Cluster index ready: " + std::to_string(ImageProcessor::m_ClusterIndex.GetClusterCount()) + " clusters over " + std::to_string(ImageProcessor::m_ClusterIndex.GetSize()) + " contours. Time: " + std::to_string(clusterIndexDuration.count()) + " ms.");
+					else
+						outcome.messages.push_back("Warning: Cluster index could not be built or saved.");
+					});
+			}
+		}
+
+		if (ImageProcessor::m_UseClusterIndex && !ImageProcessor::m_UseApproximateIndex)
+		{
+			// More probed clusters trade latency for recall
+			static int probeCount = static_cast<int>(ImageProcessor::m_ClusterIndex.GetParameters().probeCount);
+			if (ImGui::SliderInt("Probed Clusters per Contour", &probeCount, 1, 64))
+				ImageProcessor::m_ClusterIndex.SetProbeCount(static_cast<uint32_t>(probeCount));
+		}
+
+		// Compact features for the exact scan, the best candidates are re-ranked at full precision
+		static int compression = 0;
+		const char* const compressionNames[] = { "None", "Float32", "Int8" };
+		if (ImGui::Combo("Feature Compression", &compression, compressionNames, 3)) {
+			ImageProcessor::m_FeatureCompression = static_cast<FeatureCompression>(compression);
+			SubmitJob("Compressing Features", [](BatchProgress&, JobOutcome& outcome) {
+				ImageProcessor::UpdateCompressedFeatures();
+				if (!ImageProcessor::m_CompressedFeatures.IsEmpty())
+					outcome.messages.push_back(std::string("Features compressed to ") + QuantizedMatrix::GetName(ImageProcessor::m_FeatureCompression) + ": " + std::to_string(ImageProcessor::m_CompressedFeatures.GetByteSize() / 1024) + " KB.");
+				});
+		}
 
-				Log("Image Retrieval Results:");
-				for (const auto& result : retrievalResults)
-				{
-					Log("Image: " + result.first + ", Distance: " + std::to_string(result.second));
+		if (ImageProcessor::m_FeatureCompression != FeatureCompression::None) {
+			static int rerankFactor = static_cast<int>(ImageProcessor::m_RerankFactor);
+			if (ImGui::SliderInt("Re-rank Candidates per Match", &rerankFactor, 1, 32))
+				ImageProcessor::m_RerankFactor = static_cast<size_t>(rerankFactor);
+		}
+
+		// Cascade: images whose area, aspect ratio, solidity or compactness differ too much are not compared at all
+		static bool shapePrefilter = ImageProcessor::m_CascadeTolerance < 1.0;
+		static float prefilterTolerance = 0.5f;
+		bool prefilterChanged = ImGui::Checkbox("Shape Descriptor Prefilter", &shapePrefilter);
+		if (shapePrefilter)
+			prefilterChanged |= ImGui::SliderFloat("Prefilter Tolerance", &prefilterTolerance, 0.05f, 1.0f, "%.2f");
+		if (prefilterChanged)
+			ImageProcessor::m_CascadeTolerance = shapePrefilter ? static_cast<double>(prefilterTolerance) : 1.0;
+
+		ImGui::Spacing();
+		ImGui::TextWrapped("Datasets searched together by Cross-Dataset Retrieval:");
+		// The list is only read between jobs, a running job may be replacing it
+		if (!m_Jobs.IsBusy()) {
+			for (size_t shard = 0; shard < ImageProcessor::m_Datasets.GetShardCount(); ++shard) {
+				ImGui::PushID(static_cast<int>(shard));
+				ImGui::BulletText("%s (%zu images)", ImageProcessor::m_Datasets.GetShardName(shard).c_str(), ImageProcessor::m_Datasets.GetImageCount(shard));
+				ImGui::SameLine();
+				bool remove = ImGui::SmallButton("Remove");
+				ImGui::PopID();
+
+				if (remove) {
+					ImageProcessor::m_Datasets.RemoveShard(ImageProcessor::m_Datasets.GetShardName(shard));
+					break;
 				}
+			}
+		}
+
+		if (ImGui::Button("Add Current Dataset")) {
+			if (!ImageProcessor::m_FeatureExtractionDir.empty())
+				AddDataset((fs::path(ImageProcessor::m_FeatureExtractionDir) / "output_features.dat").string());
+			else
+				Log("Error: Cannot add the current dataset. Please apply Feature Extraction first.");
+		}
+		ImGui::SameLine();
+		if (ImGui::Button("Add Dataset Index")) {
+			OPENFILENAMEW ofn;
+			wchar_t szFile[260];
+			ZeroMemory(&ofn, sizeof(ofn));
+			ofn.lStructSize = sizeof(ofn);
+			ofn.lpstrFile = szFile;
+			ofn.lpstrFile[0] = L'\0';
+			ofn.nMaxFile = sizeof(szFile) / sizeof(wchar_t);
+			ofn.lpstrFilter = L"Feature Index (output_features.dat)\0*.dat\0";
+			ofn.nFilterIndex = 1;
+			ofn.Flags = OFN_PATHMUSTEXIST | OFN_FILEMUSTEXIST | OFN_NOCHANGEDIR;
+
+			if (GetOpenFileNameW(&ofn) == TRUE) {
+				std::wstring wideStorePath = ofn.lpstrFile;
+				AddDataset(std::string(wideStorePath.begin(), wideStorePath.end()));
+			}
+		}
 
-				auto ImageRetrievalEndTime = std::chrono::high_resolution_clock::now();
-				auto ImageRetrievalDuration = std::chrono::duration_cast<std::chrono::seconds>(ImageRetrievalEndTime - ImageRetrievalStartTime);
+		static bool searchAllDatasets = false;
+		ImGui::Checkbox("Search All Datasets", &searchAllDatasets);
 
-				Log("Image Retrieval completed. Time: " + std::to_string(ImageRetrievalDuration.count()) + " s.");
+		ImGui::Spacing();
+		if (ImGui::Button("Apply Retrieval"))
+		{
+			if (searchAllDatasets && ImageProcessor::m_Datasets.GetShardCount() > 0)
+			{
+				std::string imageNameWithoutExtension = fs::path(m_ImagePath).stem().string();
+				int matchCount = topK;
+				SubmitJob("Cross-Dataset Retrieval", [imageNameWithoutExtension, matchCount](BatchProgress&, JobOutcome& outcome) {
+					auto ImageRetrievalStartTime = std::chrono::high_resolution_clock::now();
+
+					std::vector<ShardMatch> retrievalResults = ImageProcessor::RetrieveAcrossDatasets(imageNameWithoutExtension, matchCount);
+					outcome.hasMatches = true;
+
+					// Every dataset may have been converted to a different intermediate format
+					std::unordered_map<size_t, std::string> shardExtensions;
+
+					outcome.messages.push_back("Cross-Dataset Retrieval Results:");
+					for (const auto& result : retrievalResults)
+					{
+						std::string dataset = ImageProcessor::m_Datasets.GetShardName(result.shard);
+						std::string imageDirectory = ImageProcessor::m_Datasets.GetImageDirectory(result.shard);
+						auto extension = shardExtensions.find(result.shard);
+						if (extension == shardExtensions.end())
+							extension = shardExtensions.emplace(result.shard, ImageProcessor::FindIntermediateExtension(imageDirectory)).first;
+
+						outcome.matches.push_back({ dataset + ": " + result.image, result.distance });
+						outcome.matchPaths.push_back((fs::path(imageDirectory) / (result.image + extension->second)).string());
+						outcome.messages.push_back("Dataset: " + dataset + ", Image: " + result.image + ", Distance: " + std::to_string(result.distance));
+					}
+
+					auto ImageRetrievalEndTime = std::chrono::high_resolution_clock::now();
+					auto ImageRetrievalDuration = std::chrono::duration_cast<std::chrono::milliseconds>(ImageRetrievalEndTime - ImageRetrievalStartTime);
+
+					outcome.messages.push_back("Cross-Dataset Retrieval completed. Time: " + std::to_string(ImageRetrievalDuration.count()) + " ms.");
+					});
+			}
+			else if (!ImageProcessor::m_FeatureExtractionDir.empty())
+			{
+				std::string imageNameWithoutExtension = fs::path(m_ImagePath).stem().string();
+				int matchCount = topK;
+				std::string matchDirectory = ImageProcessor::m_PreprocessingDir;
+				std::string matchExtension = ImageProcessor::FindIntermediateExtension(matchDirectory);
+				SubmitJob("Image Retrieval", [imageNameWithoutExtension, matchCount, matchDirectory, matchExtension](BatchProgress&, JobOutcome& outcome) {
+					auto ImageRetrievalStartTime = std::chrono::high_resolution_clock::now();
+
+					std::vector<std::pair<std::string, double>> retrievalResults = ImageProcessor::RetrieveImages(imageNameWithoutExtension, matchCount);
+					outcome.hasMatches = true;
+					outcome.matches = retrievalResults;
+
+					outcome.messages.push_back("Image Retrieval Results:");
+					for (const auto& result : retrievalResults)
+					{
+						outcome.matchPaths.push_back((fs::path(matchDirectory) / (result.first + matchExtension)).string());
+						outcome.messages.push_back("Image: " + result.first + ", Distance: " + std::to_string(result.second));
+					}
+
+					auto ImageRetrievalEndTime = std::chrono::high_resolution_clock::now();
+					auto ImageRetrievalDuration = std::chrono::duration_cast<std::chrono::milliseconds>(ImageRetrievalEndTime - ImageRetrievalStartTime);
+
+					outcome.messages.push_back("Image Retrieval completed. Time: " + std::to_string(ImageRetrievalDuration.count()) + " ms.");
+					});
 			}
 			else
 				Log("Error: Cannot apply Image Retrieval. Please apply Feature Extraction first.");
 		}
 
+		ImGui::EndDisabled();
+
 		ImGui::Separator(); ImGui::Spacing();
 		if (ImGui::Button("How To Use?", ImVec2(100, 40))) {
 			ImGui::OpenPopup("Instructions");
@@ -253,6 +541,10 @@ namespace SyncShapes
 			ImGui::Text("2. Use the 'Show Image' button to view your results.");
 			ImGui::Text("3. Clear the viewport with the 'Clear Viewport' button.");
 
+			ImGui::Text("\nResults:");
+			ImGui::Text("1. The results panel shows the matches of the last retrieval as thumbnails.");
+			ImGui::Text("2. Click a thumbnail to show it in the viewport and use it as the next query.");
+
 			ImGui::Text("\nLog Area:");
 			ImGui::Text("1. The log area logs important messages and actions.");
 			ImGui::Text("2. Clear the log with the 'Clear Log' button.");
@@ -285,7 +577,7 @@ namespace SyncShapes
 			ofn.lpstrFile = szFile;
 			ofn.lpstrFile[0] = L'\0';
 			ofn.nMaxFile = sizeof(szFile) / sizeof(wchar_t);
-			ofn.lpstrFilter = L"Image Files (.bmp,.jpg,.jpeg,and .png)\0*.bmp;*.jpg;*.jpeg;*.png;\0All Files\0*.*\0";
+			ofn.lpstrFilter = L"Image Files (.bmp,.jpg,.jpeg,.png, and .ssm)\0*.bmp;*.jpg;*.jpeg;*.png;*.ssm;\0All Files\0*.*\0";
 			ofn.nFilterIndex = 1;
 			ofn.lpstrFileTitle = NULL;
 			ofn.nMaxFileTitle = 0;
@@ -297,7 +589,7 @@ namespace SyncShapes
 				std::wstring wideImagePath = ofn.lpstrFile;
 				std::string imagePath(wideImagePath.begin(), wideImagePath.end()); m_ImagePath = imagePath;
 
-				m_TextureID = ImageProcessor::GetTexture(m_ImagePath);
+				m_TextureID = m_Textures.Get(m_ImagePath, m_ViewContourOverlay, cv::Size(500, 500));
 
 				std::string imageName = fs::path(m_ImagePath).filename().string();
 				ImageDetails details = ImageProcessor::GetImageDetails(m_ImagePath);
@@ -313,56 +605,346 @@ namespace SyncShapes
 			}
 			else
 			{
-				m_TextureID = 0; // 0 is an invalid texture ID, which clears the viewport
+				m_TextureID = 0; // 0 is an invalid texture ID, which clears the viewport, the texture stays cached for the next visit
 				Log("Viewport cleared.");
 			}
 		}
 
 		ImGui::SameLine();
-		static bool viewContourOverlay = false;
-		if (ImGui::Checkbox("View Contour Overlay", &viewContourOverlay))
+		if (ImGui::Checkbox("View Contour Overlay", &m_ViewContourOverlay))
 		{
 			if (!m_ImagePath.empty())
 			{
-				m_TextureID = ImageProcessor::VisualizeImage(m_ImagePath, viewContourOverlay);
+				m_TextureID = m_Textures.Get(m_ImagePath, m_ViewContourOverlay, cv::Size(500, 500));
 			}
 			else
 			{
-				viewContourOverlay = false;
+				m_ViewContourOverlay = false;
 				Log("Error: Show an image first to visualize its contours.");
 			}
 		}
 
+		// GPU memory of the cached Viewport textures, the least recently shown ones are deleted first
+		static int textureBudgetMB = static_cast<int>(TextureCache::DefaultByteBudget / (1024 * 1024));
+		if (ImGui::InputInt("Texture Cache (MB)", &textureBudgetMB)) {
+			textureBudgetMB = std::max(1, textureBudgetMB);
+			m_Textures.SetByteBudget(static_cast<size_t>(textureBudgetMB) * 1024 * 1024);
+		}
+		ImGui::Text("%zu textures, %.1f MB, %zu hits, %zu misses", m_Textures.GetCount(), m_Textures.GetBytesUsed() / (1024.0 * 1024.0), m_Textures.GetHits(), m_Textures.GetMisses());
+
 		ImGui::End();
 	}
 
-	void ImGuiManager::ShowLogger()
+	void ImGuiManager::ShowResults()
 	{
-		ImGui::Begin("Log");
+		ImGui::Begin("Results");
+
+		std::string selectedPath = m_Gallery.Show();
+		if (!selectedPath.empty())
+		{
+			// A match becomes the shown image and the next query
+			m_ImagePath = selectedPath;
+			m_TextureID = m_Textures.Get(m_ImagePath, m_ViewContourOverlay, cv::Size(500, 500));
+			Log("Selected Image: " + fs::path(m_ImagePath).filename().string());
+		}
+
+		ImGui::End();
+	}
+
+	void ImGuiManager::ShowClusters()
+	{
+		ImGui::Begin("Clusters");
+
+		// The index is rebuilt by jobs, it is only read between them
+		const ClusterIndex& clusters = ImageProcessor::m_ClusterIndex;
+		bool ready = !m_Jobs.IsBusy() && !clusters.IsEmpty() && clusters.GetImageCount() == ImageProcessor::m_FeatureMatrix.GetImageCount()
+			&& clusters.GetSize() == ImageProcessor::m_FeatureMatrix.GetContourCount();
+		if (!ready) {
+			ImGui::TextWrapped("Enable \"Use Cluster Index (IVF)\" in the Editor to group the images by shape.");
+			ImGui::End();
+			return;
+		}
+
+		ImGui::Text("%zu clusters, %zu images", clusters.GetClusterCount(), clusters.GetImageCount());
+
+		// Largest groups first
+		std::vector<uint32_t> order(clusters.GetClusterCount());
+		std::iota(order.begin(), order.end(), 0);
+		std::stable_sort(order.begin(), order.end(), [&clusters](uint32_t a, uint32_t b) {
+			return clusters.GetClusterImages(a).size() > clusters.GetClusterImages(b).size();
+			});
+
+		ImGui::BeginChild("ClusterList");
+		ImGuiListClipper clipper;
+		clipper.Begin(static_cast<int>(order.size()));
+		while (clipper.Step()) {
+			for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; ++row) {
+				uint32_t cluster = order[row];
+				std::string label = "Cluster " + std::to_string(cluster) + " (" + std::to_string(clusters.GetClusterImages(cluster).size()) + " images)";
+				if (!ImGui::Selectable(label.c_str(), cluster == m_SelectedCluster))
+					continue;
+
+				// Members ordered by their closest contour to the centroid, the most typical shapes come first
+				m_SelectedCluster = cluster;
+				std::vector<std::pair<std::string, double>> members;
+				for (uint32_t image : clusters.GetClusterImages(cluster)) {
+					double distance = std::numeric_limits<double>::infinity();
+					for (size_t contour = ImageProcessor::m_FeatureMatrix.GetContourBegin(image); contour < ImageProcessor::m_FeatureMatrix.GetContourEnd(image); ++contour)
+						distance = std::min(distance, HuDistance::Distance(ImageProcessor::m_FeatureMatrix.GetContour(contour), clusters.GetCentroid(cluster)));
+					members.push_back({ std::string(ImageProcessor::m_FeatureMatrix.GetImageName(image)), distance });
+				}
+				std::stable_sort(members.begin(), members.end(), [](const auto& a, const auto& b) { return a.second < b.second; });
+
+				std::string memberExtension = ImageProcessor::FindIntermediateExtension(ImageProcessor::m_PreprocessingDir);
+				std::vector<std::string> memberPaths;
+				for (const auto& member : members)
+					memberPaths.push_back((fs::path(ImageProcessor::m_PreprocessingDir) / (member.first + memberExtension)).string());
+
+				m_Gallery.SetResults(members, memberPaths);
+				Log("Cluster " + std::to_string(cluster) + ": " + std::to_string(members.size()) + " images.");
+			}
+		}
+		clipper.End();
+		ImGui::EndChild();
+
+		ImGui::End();
+	}
 
-		// Counter variable for numbering log messages
-		int logCounter = 1;
+	void ImGuiManager::ShowPerformance()
+	{
+		ImGui::Begin("Performance");
+
+		static bool profiling = Profiler::IsEnabled();
+		if (ImGui::Checkbox("Enable Profiling", &profiling))
+			Profiler::SetEnabled(profiling);
+
+		ImGui::SameLine();
+		if (ImGui::Button("Reset"))
+			Profiler::Reset();
 
-		for (const auto& logMessage : m_LogBuffer) {
-			if (logMessage.find("Error") != std::string::npos) {
-				ImGui::TextColored(ImVec4(1.0f, 0.0f, 0.0f, 1.0f), "[%d] %s", logCounter++, logMessage.c_str());
+		ImGui::SameLine();
+		if (ImGui::Button("Export Trace")) {
+			OPENFILENAMEW ofn;
+			wchar_t szFile[260] = L"syncshapes_trace.json";
+			ZeroMemory(&ofn, sizeof(ofn));
+			ofn.lStructSize = sizeof(ofn);
+			ofn.lpstrFile = szFile;
+			ofn.nMaxFile = sizeof(szFile) / sizeof(wchar_t);
+			ofn.lpstrFilter = L"Chrome Trace (*.json)\0*.json\0";
+			ofn.nFilterIndex = 1;
+			ofn.lpstrDefExt = L"json";
+			ofn.Flags = OFN_PATHMUSTEXIST | OFN_OVERWRITEPROMPT | OFN_NOCHANGEDIR;
+
+			if (GetSaveFileNameW(&ofn) == TRUE) {
+				std::wstring wideTracePath = ofn.lpstrFile;
+				std::string tracePath(wideTracePath.begin(), wideTracePath.end());
+				if (Profiler::WriteTrace(tracePath))
+					Log("Trace written: " + tracePath + " (" + std::to_string(Profiler::GetEventCount()) + " events, open in ui.perfetto.dev or chrome://tracing).");
+				else
+					Log("Error: Failed to write the trace to " + tracePath + ".");
 			}
-			else if (logMessage.find("Warning") != std::string::npos) {
-				ImGui::TextColored(ImVec4(1.0f, 1.0f, 0.0f, 1.0f), "[%d] %s", logCounter++, logMessage.c_str());
+		}
+
+		std::vector<StageStats> stages = Profiler::GetStats();
+		if (stages.empty()) {
+			ImGui::TextWrapped("Enable profiling and run a pipeline stage to see where the time goes.");
+			ImGui::End();
+			return;
+		}
+
+		size_t droppedEvents = Profiler::GetDroppedEventCount();
+		if (droppedEvents > 0)
+			ImGui::TextColored(ImVec4(1.0f, 1.0f, 0.0f, 1.0f), "Warning: %zu events exceeded the trace capacity, they are only counted below.", droppedEvents);
+
+		// Heaviest stages first, a selected row shows its latency histogram
+		if (ImGui::BeginTable("Stages", 7, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY, ImVec2(0, 240))) {
+			ImGui::TableSetupScrollFreeze(0, 1);
+			ImGui::TableSetupColumn("Stage");
+			ImGui::TableSetupColumn("Count");
+			ImGui::TableSetupColumn("Total (ms)");
+			ImGui::TableSetupColumn("Mean (us)");
+			ImGui::TableSetupColumn("p50 (us)");
+			ImGui::TableSetupColumn("p99 (us)");
+			ImGui::TableSetupColumn("Max (us)");
+			ImGui::TableHeadersRow();
+
+			for (const StageStats& stage : stages) {
+				ImGui::TableNextRow();
+				ImGui::TableNextColumn();
+				if (ImGui::Selectable(stage.name.c_str(), stage.name == m_SelectedStage, ImGuiSelectableFlags_SpanAllColumns))
+					m_SelectedStage = stage.name;
+				ImGui::TableNextColumn(); ImGui::Text("%llu", static_cast<unsigned long long>(stage.count));
+				ImGui::TableNextColumn(); ImGui::Text("%.2f", stage.totalMicroseconds / 1000.0);
+				ImGui::TableNextColumn(); ImGui::Text("%.1f", stage.GetMeanMicroseconds());
+				ImGui::TableNextColumn(); ImGui::Text("%llu", static_cast<unsigned long long>(stage.GetPercentileMicroseconds(50)));
+				ImGui::TableNextColumn(); ImGui::Text("%llu", static_cast<unsigned long long>(stage.GetPercentileMicroseconds(99)));
+				ImGui::TableNextColumn(); ImGui::Text("%llu", static_cast<unsigned long long>(stage.maxMicroseconds));
 			}
-			else {
-				ImGui::TextColored(ImVec4(0.0f, 1.0f, 0.0f, 1.0f), "[%d] %s", logCounter++, logMessage.c_str());
+
+			ImGui::EndTable();
+		}
+
+		for (const StageStats& stage : stages) {
+			if (stage.name != m_SelectedStage)
+				continue;
+
+			// Only the buckets up to the slowest call, bucket i spans [2^i, 2^(i+1)) us
+			int bucketCount = 1;
+			float histogram[StageStats::HistogramBuckets];
+			for (size_t bucket = 0; bucket < StageStats::HistogramBuckets; ++bucket) {
+				histogram[bucket] = static_cast<float>(stage.histogram[bucket]);
+				if (stage.histogram[bucket] > 0)
+					bucketCount = static_cast<int>(bucket) + 1;
 			}
+
+			ImGui::Text("%s latency, log2 microsecond buckets:", stage.name.c_str());
+			ImGui::PlotHistogram("##StageHistogram", histogram, bucketCount, 0, nullptr, 0.0f, FLT_MAX, ImVec2(0, 80));
 		}
 
-		if (!m_LogBuffer.empty())
-		{
-			ImGui::NewLine();
-			if (ImGui::Button("Clear Log", ImVec2(100, 25))) {
-				m_LogBuffer.clear();
+		ImGui::End();
+	}
+
+	void ImGuiManager::ShowLogger()
+	{
+		m_Log.Drain();
+
+		ImGui::Begin("Log");
+
+		static bool spillToFile = false;
+		if (ImGui::Checkbox("Spill Old Entries to File", &spillToFile)) {
+			if (!m_Log.SetSpillPath(spillToFile ? "SyncShapes.log" : ""))
+				spillToFile = false;
+		}
+
+		if (m_Log.GetSize() > 0) {
+			ImGui::SameLine();
+			if (ImGui::Button("Clear Log"))
+				m_Log.Clear();
+		}
+
+		if (m_Log.GetEvictedCount() > 0) {
+			if (spillToFile)
+				ImGui::TextDisabled("%llu older lines moved to %s", static_cast<unsigned long long>(m_Log.GetEvictedCount()), m_Log.GetSpillPath().c_str());
+			else
+				ImGui::TextDisabled("%llu older lines dropped, only the last %zu are kept", static_cast<unsigned long long>(m_Log.GetEvictedCount()), m_Log.GetCapacity());
+		}
+
+		ImGui::Separator();
+		ImGui::BeginChild("LogLines", ImVec2(0, 0), 0, ImGuiWindowFlags_HorizontalScrollbar);
+
+		// Only the visible lines are drawn
+		ImGuiListClipper clipper;
+		clipper.Begin(static_cast<int>(m_Log.GetSize()));
+		while (clipper.Step()) {
+			for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; ++i) {
+				const LogEntry& entry = m_Log.GetEntry(static_cast<size_t>(i));
+
+				ImVec4 color(0.0f, 1.0f, 0.0f, 1.0f);
+				if (entry.severity == LogSeverity::Error)
+					color = ImVec4(1.0f, 0.0f, 0.0f, 1.0f);
+				else if (entry.severity == LogSeverity::Warning)
+					color = ImVec4(1.0f, 1.0f, 0.0f, 1.0f);
+
+				ImGui::TextColored(color, "[%llu] %s", static_cast<unsigned long long>(entry.number), entry.message.c_str());
 			}
 		}
 
+		// Follow new lines while scrolled to the bottom
+		if (ImGui::GetScrollY() >= ImGui::GetScrollMaxY())
+			ImGui::SetScrollHereY(1.0f);
+
+		ImGui::EndChild();
 		ImGui::End();
 	}
+
+	void ImGuiManager::AddBatchReport(JobOutcome& outcome, const std::string& stage, const BatchReport& report)
+	{
+		outcome.messages.push_back(stage + ": " + std::to_string(report.succeeded) + "/" + std::to_string(report.total) + " files processed.");
+
+		if (report.cancelled > 0)
+			outcome.messages.push_back("Warning: " + stage + " cancelled, " + std::to_string(report.cancelled) + " files skipped.");
+
+		for (const auto& failure : report.failures)
+		{
+			outcome.messages.push_back("Error: " + stage + " failed for " + failure.path + ": " + failure.reason);
+		}
+	}
+
+	void ImGuiManager::AddFeatureUpdateReport(JobOutcome& outcome, const std::string& stage, const FeatureUpdateReport& report)
+	{
+		outcome.messages.push_back(stage + ": " + std::to_string(report.extracted) + " extracted, " + std::to_string(report.reused) + " unchanged, " + std::to_string(report.removed) + " removed.");
+		AddBatchReport(outcome, stage, report.batch);
+	}
+
+	void ImGuiManager::SubmitJob(const std::string& name, std::function<void(BatchProgress&, JobOutcome&)> work)
+	{
+		m_Jobs.Submit(name, [this, name, work](BatchProgress& progress) -> JobSystem::Completion {
+			JobOutcome outcome;
+
+			// The directory passes of ImageProcessor report through this, only one job runs at a time
+			ImageProcessor::m_Progress = &progress;
+			try {
+				work(progress, outcome);
+			}
+			catch (const std::exception& exception) {
+				outcome.messages.push_back("Error: " + name + " failed: " + exception.what());
+			}
+			ImageProcessor::m_Progress = nullptr;
+
+			return [this, outcome] {
+				for (const auto& message : outcome.messages)
+					Log(message);
+
+				if (outcome.contoursOverlay)
+					ImageProcessor::m_ContoursOverlay = true;
+
+				if (outcome.hasMatches)
+					m_Gallery.SetResults(outcome.matches, outcome.matchPaths);
+			};
+			});
+	}
+
+	void ImGuiManager::AddDataset(const std::string& storePath)
+	{
+		SubmitJob("Loading Dataset", [storePath](BatchProgress&, JobOutcome& outcome) {
+			std::string name = ShardedIndex::GetDatasetName(storePath);
+
+			auto datasetLoadingStartTime = std::chrono::high_resolution_clock::now();
+			if (ImageProcessor::m_Datasets.AddShard(name, storePath, ImageProcessor::m_UseApproximateIndex)) {
+				auto datasetLoadingEndTime = std::chrono::high_resolution_clock::now();
+				auto datasetLoadingDuration = std::chrono::duration_cast<std::chrono::milliseconds>(datasetLoadingEndTime - datasetLoadingStartTime);
+				size_t shard = ImageProcessor::m_Datasets.GetShardCount() - 1;
+				outcome.messages.push_back("Dataset " + name + " loaded: " + std::to_string(ImageProcessor::m_Datasets.GetImageCount(shard)) + " images. Time: " + std::to_string(datasetLoadingDuration.count()) + " ms.");
+			}
+			else {
+				outcome.messages.push_back("Error: Dataset " + name + " could not be loaded from " + storePath + ".");
+			}
+			});
+	}
+
+	void ImGuiManager::ShowJobStatus()
+	{
+		JobStatus status = m_Jobs.GetStatus();
+		if (!status.running)
+			return;
+
+		ImGui::TextWrapped("Running: %s", status.name.c_str());
+
+		float fraction = status.total > 0 ? static_cast<float>(status.completed) / static_cast<float>(status.total) : 0.0f;
+		double filesPerSecond = status.elapsedSeconds > 0.0 ? static_cast<double>(status.completed) / status.elapsedSeconds : 0.0;
+
+		char overlay[64];
+		snprintf(overlay, sizeof(overlay), "%zu/%zu (%.1f files/s)", status.completed, status.total, filesPerSecond);
+		ImGui::ProgressBar(fraction, ImVec2(-1.0f, 0.0f), overlay);
+
+		if (status.queued > 0)
+			ImGui::Text("%zu more queued", status.queued);
+
+		if (status.cancelRequested)
+			ImGui::TextWrapped("Cancelling...");
+		else if (ImGui::Button("Cancel"))
+			m_Jobs.CancelAll();
+
+		ImGui::Separator(); ImGui::Spacing();
+	}
 }
\ No newline at end of file
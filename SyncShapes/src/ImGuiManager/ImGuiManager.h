@@ -8,8 +8,14 @@
 
 #include <iostream>
 #include <chrono>
+#include <functional>
 
 #include "OpenCVImageProcessor/ImageProcessor.h"
+#include "JobSystem/JobSystem.h"
+#include "Profiler/Profiler.h"
+#include "LogBuffer.h"
+#include "TextureCache.h"
+#include "ThumbnailGallery.h"
 
 namespace SyncShapes
 {
@@ -21,8 +27,11 @@ namespace SyncShapes
 
 		void Update();
 		void Render();
+		// Something on screen changes without input: a running job, loading thumbnails, an active widget or a text cursor
+		bool IsAnimating() const;
 
-		inline void Log(const char* message) { m_LogBuffer.push_back(message); }
+		// Safe to call from any thread, the lines show up in the Log window on the next frame
+		inline void Log(const char* message) { m_Log.Post(message); }
 
 		template <typename... Args>
 		inline void Log(Args... args) {
@@ -31,17 +40,48 @@ namespace SyncShapes
 			// + operator to concatenate arguments into the logMessage string
 			((logMessage += args), ...);
 
-			m_LogBuffer.push_back(logMessage.c_str());
+			m_Log.Post(std::move(logMessage));
 		}
 	private:
 		GLFWwindow* m_Window;
 		GLuint m_TextureID; GLuint m_TextureID2;
+		TextureCache m_Textures;
+		ThumbnailGallery m_Gallery;
+		bool m_ViewContourOverlay;
+		uint32_t m_SelectedCluster;
+		std::string m_SelectedStage;
 		std::string m_ImagePath;
-		std::vector<std::string> m_LogBuffer;
+		LogBuffer m_Log;
+
+		// Log lines and view state a job hands back to the UI thread
+		struct JobOutcome
+		{
+			std::vector<std::string> messages;
+			bool contoursOverlay = false;
+
+			// Retrieval matches for the gallery and the image file of each
+			bool hasMatches = false;
+			std::vector<std::pair<std::string, double>> matches;
+			std::vector<std::string> matchPaths;
+		};
+
+		JobSystem m_Jobs;
 
 		void ShowImageProcessingEditor();
 		void ShowViewport();
 		void ShowLogger();
+		void ShowResults();
+		// Browsable overview of the cluster index, a selected cluster fills the results gallery
+		void ShowClusters();
+		// Live per-stage stats of the profiler and the trace export
+		void ShowPerformance();
+		void ShowJobStatus();
+
+		void SubmitJob(const std::string& name, std::function<void(BatchProgress&, JobOutcome&)> work);
+		// Loads a feature store as a Cross-Dataset Retrieval shard on the job system
+		void AddDataset(const std::string& storePath);
+		static void AddBatchReport(JobOutcome& outcome, const std::string& stage, const BatchReport& report);
+		static void AddFeatureUpdateReport(JobOutcome& outcome, const std::string& stage, const FeatureUpdateReport& report);
 	};
 }
 
@@ -0,0 +1,90 @@
+#include <GL/glew.h>
+#include "ImageTexture.h"
+
+namespace SyncShapes
+{
+	cv::Mat ImageTexture::Render(const std::string& imagePath, bool drawContours, const cv::Size& size)
+	{
+		SharedImage source = ImageProcessor::LoadImage(imagePath);
+
+		if (!source)
+		{
+			std::cerr << "Failed to load the image at path: " << imagePath << std::endl;
+			return cv::Mat();
+		}
+
+		// Mask intermediates are single channel, the Viewport and the green overlay expect BGR.
+		// Either way the overlay is drawn on a copy, never on the shared image.
+		cv::Mat image;
+		if (source->channels() == 1)
+			cv::cvtColor(*source, image, cv::COLOR_GRAY2BGR);
+		else
+			image = source->clone();
+
+		if (drawContours) {
+			cv::Mat gray;
+			cv::cvtColor(image, gray, image.channels() == 4 ? cv::COLOR_BGRA2GRAY : cv::COLOR_BGR2GRAY);
+
+			// Apply threshold to create a binary image
+			cv::Mat thresh;
+			cv::threshold(gray, thresh, 128, 255, cv::THRESH_BINARY);
+
+			// Find contours in the binary image
+			std::vector<std::vector<cv::Point>> contours;
+			cv::findContours(thresh, contours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE);
+
+			// Draw contours on the original image
+			cv::drawContours(image, contours, -1, cv::Scalar(0, 255, 0), 2);
+		}
+
+		// Resize the image to fit the dimensions of the viewport
+		cv::resize(image, image, size);
+
+		if (image.channels() == 4)
+			cv::cvtColor(image, image, cv::COLOR_BGRA2RGBA);
+		else
+			cv::cvtColor(image, image, cv::COLOR_BGR2RGB);
+
+		return image;
+	}
+
+	GLuint ImageTexture::Upload(const cv::Mat& image)
+	{
+		if (image.empty())
+			return 0;
+
+		// Convert the processed image to an OpenGL texture
+		GLuint textureID;
+		glGenTextures(1, &textureID);
+		glBindTexture(GL_TEXTURE_2D, textureID);
+
+		// Rows are tightly packed, an RGB width that is not a multiple of four would otherwise be read skewed
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+		if (image.channels() == 4)
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, image.cols, image.rows, 0, GL_RGBA, GL_UNSIGNED_BYTE, image.data);
+		else
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, image.cols, image.rows, 0, GL_RGB, GL_UNSIGNED_BYTE, image.data);
+
+		// Texture parameters
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+		glBindTexture(GL_TEXTURE_2D, 0); // Unbind the texture
+
+		return textureID;
+	}
+
+	void ImageTexture::Release(GLuint textureID)
+	{
+		if (textureID != 0)
+			glDeleteTextures(1, &textureID);
+	}
+
+	size_t ImageTexture::GetTextureBytes(const cv::Mat& image)
+	{
+		return image.total() * image.elemSize();
+	}
+}
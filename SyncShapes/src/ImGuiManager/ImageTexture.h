@@ -0,0 +1,26 @@
+#pragma once
+
+#include <GLFW/glfw3.h>
+#include <opencv2/opencv.hpp>
+
+#include "OpenCVImageProcessor/ImageProcessor.h"
+
+#include <string>
+
+namespace SyncShapes
+{
+	// Uploads images to OpenGL textures for the Viewport, kept out of ImageProcessor so the processing core has no GL dependency
+	class ImageTexture
+	{
+	public:
+		// Decodes the image, optionally draws its contours in green and resizes it to 'size', RGB or RGBA ready for upload
+		static cv::Mat Render(const std::string& imagePath, bool drawContours, const cv::Size& size);
+
+		// The caller owns the returned texture and frees it with Release
+		static GLuint Upload(const cv::Mat& image);
+		static void Release(GLuint textureID);
+
+		// Bytes the texture of 'image' takes on the GPU, without mipmaps
+		static size_t GetTextureBytes(const cv::Mat& image);
+	};
+}
@@ -0,0 +1,118 @@
+#include "LogBuffer.h"
+
+#include <iostream>
+
+namespace SyncShapes
+{
+	LogBuffer::LogBuffer(size_t capacity) : m_Pending(nullptr), m_Entries(capacity > 0 ? capacity : 1), m_First(0), m_Count(0), m_NextNumber(1), m_EvictedCount(0)
+	{
+	}
+
+	LogBuffer::~LogBuffer()
+	{
+		PendingEntry* pending = m_Pending.exchange(nullptr, std::memory_order_acquire);
+		while (pending) {
+			PendingEntry* next = pending->next;
+			delete pending;
+			pending = next;
+		}
+	}
+
+	void LogBuffer::Post(std::string message)
+	{
+		// The severity is decided once here instead of on every frame the line is drawn
+		PendingEntry* entry = new PendingEntry{ Classify(message), std::move(message), m_Pending.load(std::memory_order_relaxed) };
+		while (!m_Pending.compare_exchange_weak(entry->next, entry, std::memory_order_release, std::memory_order_relaxed)) {
+		}
+
+		if (m_Wake)
+			m_Wake();
+	}
+
+	void LogBuffer::Drain()
+	{
+		// The single consumer takes the whole stack at once, so there is no ABA between producers and consumer
+		PendingEntry* pending = m_Pending.exchange(nullptr, std::memory_order_acquire);
+		if (!pending)
+			return;
+
+		// Newest first on the stack, reversed into posting order
+		PendingEntry* ordered = nullptr;
+		while (pending) {
+			PendingEntry* next = pending->next;
+			pending->next = ordered;
+			ordered = pending;
+			pending = next;
+		}
+
+		while (ordered) {
+			PendingEntry* next = ordered->next;
+			Append(ordered->severity, std::move(ordered->message));
+			delete ordered;
+			ordered = next;
+		}
+
+		if (m_SpillStream.is_open())
+			m_SpillStream.flush();
+	}
+
+	void LogBuffer::Clear()
+	{
+		Drain();
+
+		for (size_t i = 0; i < m_Count; ++i)
+			m_Entries[(m_First + i) % m_Entries.size()].message.clear();
+
+		m_First = 0;
+		m_Count = 0;
+		m_NextNumber = 1;
+		m_EvictedCount = 0;
+	}
+
+	bool LogBuffer::SetSpillPath(const std::string& path)
+	{
+		if (m_SpillStream.is_open())
+			m_SpillStream.close();
+		m_SpillPath.clear();
+
+		if (path.empty())
+			return true;
+
+		m_SpillStream.open(path, std::ios::app);
+		if (!m_SpillStream.is_open()) {
+			std::cerr << "Failed to open log spill file: " << path << std::endl;
+			return false;
+		}
+
+		m_SpillPath = path;
+		return true;
+	}
+
+	LogSeverity LogBuffer::Classify(const std::string& message)
+	{
+		if (message.find("Error") != std::string::npos)
+			return LogSeverity::Error;
+		if (message.find("Warning") != std::string::npos)
+			return LogSeverity::Warning;
+		return LogSeverity::Info;
+	}
+
+	void LogBuffer::Append(LogSeverity severity, std::string&& message)
+	{
+		if (m_Count == m_Entries.size()) {
+			LogEntry& oldest = m_Entries[m_First];
+			if (m_SpillStream.is_open())
+				m_SpillStream << "[" << oldest.number << "] " << oldest.message << "\n";
+
+			m_First = (m_First + 1) % m_Entries.size();
+			--m_Count;
+			++m_EvictedCount;
+		}
+
+		LogEntry& entry = m_Entries[(m_First + m_Count) % m_Entries.size()];
+		entry.number = m_NextNumber++;
+		entry.severity = severity;
+		entry.message = std::move(message);
+		++m_Count;
+	}
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace SyncShapes
+{
+	enum class LogSeverity : uint8_t
+	{
+		Info,
+		Warning,
+		Error
+	};
+
+	struct LogEntry
+	{
+		uint64_t number = 0; // 1-based, counts every line since the last Clear
+		LogSeverity severity = LogSeverity::Info;
+		std::string message;
+	};
+
+	// Fixed-capacity log for the Log window. Post may be called from any thread: lines go onto a lock-free
+	// multi-producer stack that the UI thread drains into the ring each frame. When the ring is full the oldest
+	// line is dropped, or appended to the spill file if one is set.
+	class LogBuffer
+	{
+	public:
+		explicit LogBuffer(size_t capacity = DefaultCapacity);
+		~LogBuffer();
+
+		LogBuffer(const LogBuffer&) = delete;
+		LogBuffer& operator=(const LogBuffer&) = delete;
+
+		void Post(std::string message);
+		// Called after every Post, from the posting thread. Set it before anything is posted.
+		inline void SetWakeCallback(std::function<void()> wake) { m_Wake = std::move(wake); }
+
+		// UI thread only from here on
+		void Drain();
+		void Clear();
+
+		// Empty path stops spilling. Returns false if the file cannot be opened.
+		bool SetSpillPath(const std::string& path);
+		inline const std::string& GetSpillPath() const { return m_SpillPath; }
+
+		inline size_t GetSize() const { return m_Count; }
+		inline size_t GetCapacity() const { return m_Entries.size(); }
+		// Oldest line first
+		inline const LogEntry& GetEntry(size_t index) const { return m_Entries[(m_First + index) % m_Entries.size()]; }
+		// Lines pushed out of the ring, spilled or not
+		inline uint64_t GetEvictedCount() const { return m_EvictedCount; }
+
+		static constexpr size_t DefaultCapacity = 4096;
+	private:
+		struct PendingEntry
+		{
+			LogSeverity severity;
+			std::string message;
+			PendingEntry* next;
+		};
+
+		std::atomic<PendingEntry*> m_Pending;
+		std::function<void()> m_Wake;
+		std::vector<LogEntry> m_Entries;
+		size_t m_First;
+		size_t m_Count;
+		uint64_t m_NextNumber;
+		uint64_t m_EvictedCount;
+		std::string m_SpillPath;
+		std::ofstream m_SpillStream;
+
+		static LogSeverity Classify(const std::string& message);
+		void Append(LogSeverity severity, std::string&& message);
+	};
+}
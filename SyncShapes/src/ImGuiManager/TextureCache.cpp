@@ -0,0 +1,94 @@
+#include <GL/glew.h>
+#include "TextureCache.h"
+#include "ImageTexture.h"
+
+namespace SyncShapes
+{
+	TextureCache::TextureCache(size_t byteBudget) : m_ByteBudget(byteBudget), m_BytesUsed(0), m_Hits(0), m_Misses(0) {}
+
+	TextureCache::~TextureCache()
+	{
+		Clear();
+	}
+
+	GLuint TextureCache::Get(const std::string& imagePath, bool drawContours, const cv::Size& size)
+	{
+		// A stat is far cheaper than a decode, and pre-processing rewrites the files the Viewport shows
+		std::error_code ec;
+		fs::file_time_type writeTime = fs::last_write_time(imagePath, ec);
+		uintmax_t fileSize = ec ? 0 : fs::file_size(imagePath, ec);
+		if (ec)
+			return 0;
+
+		std::string key = MakeKey(imagePath, drawContours, size);
+		auto found = m_Lookup.find(key);
+		if (found != m_Lookup.end()) {
+			auto entry = found->second;
+			if (entry->writeTime == writeTime && entry->fileSize == fileSize) {
+				m_Entries.splice(m_Entries.begin(), m_Entries, entry);
+				++m_Hits;
+				return entry->textureID;
+			}
+
+			Erase(entry);
+		}
+
+		++m_Misses;
+
+		cv::Mat image = ImageTexture::Render(imagePath, drawContours, size);
+		GLuint textureID = ImageTexture::Upload(image);
+		if (textureID == 0)
+			return 0;
+
+		Entry entry;
+		entry.key = key;
+		entry.textureID = textureID;
+		entry.bytes = ImageTexture::GetTextureBytes(image);
+		entry.writeTime = writeTime;
+		entry.fileSize = fileSize;
+
+		m_Entries.push_front(std::move(entry));
+		m_Lookup[key] = m_Entries.begin();
+		m_BytesUsed += m_Entries.front().bytes;
+
+		EvictToBudget();
+
+		return textureID;
+	}
+
+	void TextureCache::SetByteBudget(size_t byteBudget)
+	{
+		m_ByteBudget = byteBudget;
+		EvictToBudget();
+	}
+
+	void TextureCache::Clear()
+	{
+		for (const auto& entry : m_Entries)
+			ImageTexture::Release(entry.textureID);
+
+		m_Entries.clear();
+		m_Lookup.clear();
+		m_BytesUsed = 0;
+	}
+
+	std::string TextureCache::MakeKey(const std::string& imagePath, bool drawContours, const cv::Size& size)
+	{
+		// The separator cannot appear in a path, so different keys never collide
+		return imagePath + '\n' + (drawContours ? "contours" : "plain") + '\n' + std::to_string(size.width) + "x" + std::to_string(size.height);
+	}
+
+	void TextureCache::Erase(std::list<Entry>::iterator entry)
+	{
+		ImageTexture::Release(entry->textureID);
+		m_BytesUsed -= entry->bytes;
+		m_Lookup.erase(entry->key);
+		m_Entries.erase(entry);
+	}
+
+	void TextureCache::EvictToBudget()
+	{
+		while (m_BytesUsed > m_ByteBudget && m_Entries.size() > 1)
+			Erase(std::prev(m_Entries.end()));
+	}
+}
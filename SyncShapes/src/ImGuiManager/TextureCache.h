@@ -0,0 +1,64 @@
+#pragma once
+
+#include <GLFW/glfw3.h>
+#include <opencv2/opencv.hpp>
+
+#include <filesystem>
+#include <list>
+#include <string>
+#include <unordered_map>
+
+namespace SyncShapes
+{
+	namespace fs = std::filesystem;
+
+	// LRU cache of Viewport textures keyed by (path, overlay, size), bounded by the bytes the textures take on the GPU.
+	// Evicted textures are deleted, so the cache must be used and destroyed while the GL context is current.
+	class TextureCache
+	{
+	public:
+		static constexpr size_t DefaultByteBudget = 64ull * 1024 * 1024;
+
+		explicit TextureCache(size_t byteBudget = DefaultByteBudget);
+		~TextureCache();
+
+		TextureCache(const TextureCache&) = delete;
+		TextureCache& operator=(const TextureCache&) = delete;
+
+		// Returns the texture of the image, decoding and uploading it only on a miss or when the file changed on disk.
+		// The texture stays valid until it is evicted, at the earliest by the next Get.
+		GLuint Get(const std::string& imagePath, bool drawContours, const cv::Size& size);
+
+		// The most recently used texture is kept even when it alone exceeds the budget
+		void SetByteBudget(size_t byteBudget);
+		void Clear();
+
+		inline size_t GetByteBudget() const { return m_ByteBudget; }
+		inline size_t GetBytesUsed() const { return m_BytesUsed; }
+		inline size_t GetCount() const { return m_Entries.size(); }
+		inline size_t GetHits() const { return m_Hits; }
+		inline size_t GetMisses() const { return m_Misses; }
+	private:
+		struct Entry
+		{
+			std::string key;
+			GLuint textureID = 0;
+			size_t bytes = 0;
+			fs::file_time_type writeTime;
+			uintmax_t fileSize = 0;
+		};
+
+		// Most recently used first
+		std::list<Entry> m_Entries;
+		std::unordered_map<std::string, std::list<Entry>::iterator> m_Lookup;
+
+		size_t m_ByteBudget;
+		size_t m_BytesUsed;
+		size_t m_Hits;
+		size_t m_Misses;
+
+		static std::string MakeKey(const std::string& imagePath, bool drawContours, const cv::Size& size);
+		void Erase(std::list<Entry>::iterator entry);
+		void EvictToBudget();
+	};
+}
@@ -0,0 +1,194 @@
+#include <GL/glew.h>
+#include "ThumbnailGallery.h"
+
+#include "OpenCVImageProcessor/ImageProcessor.h"
+
+#include <algorithm>
+
+namespace SyncShapes
+{
+	ThumbnailGallery::ThumbnailGallery() : m_AtlasTexture(0) {}
+
+	ThumbnailGallery::~ThumbnailGallery()
+	{
+		StopLoader();
+
+		if (m_AtlasTexture != 0)
+			glDeleteTextures(1, &m_AtlasTexture);
+	}
+
+	void ThumbnailGallery::SetResults(const std::vector<std::pair<std::string, double>>& results, const std::vector<std::string>& paths)
+	{
+		Clear();
+
+		size_t count = std::min(std::min(results.size(), paths.size()), Capacity);
+		for (size_t i = 0; i < count; ++i) {
+			Item item;
+			item.name = results[i].first;
+			item.path = paths[i];
+			item.distance = results[i].second;
+			m_Items.push_back(item);
+		}
+
+		if (count == 0)
+			return;
+
+		std::vector<std::string> itemPaths(paths.begin(), paths.begin() + count);
+		m_Progress.Reset();
+		m_Loader = std::thread([this, itemPaths] {
+			BatchExecutor executor;
+			executor.Run(itemPaths, [this](size_t index, const std::string& path, std::string& error) {
+				Decoded decoded{ index, ImageProcessor::DecodeThumbnail(path, ThumbnailSize) };
+
+				if (!decoded.thumbnail.empty()) {
+					int code = decoded.thumbnail.channels() == 1 ? cv::COLOR_GRAY2RGBA : decoded.thumbnail.channels() == 4 ? cv::COLOR_BGRA2RGBA : cv::COLOR_BGR2RGBA;
+					cv::cvtColor(decoded.thumbnail, decoded.thumbnail, code);
+				}
+				else {
+					error = "Failed to decode the thumbnail";
+				}
+
+				std::lock_guard<std::mutex> lock(m_DecodedMutex);
+				m_Decoded.push_back(std::move(decoded));
+				return error.empty();
+				}, &m_Progress);
+			});
+	}
+
+	bool ThumbnailGallery::IsLoading() const
+	{
+		return std::any_of(m_Items.begin(), m_Items.end(), [](const Item& item) { return !item.ready && !item.failed; });
+	}
+
+	void ThumbnailGallery::Clear()
+	{
+		StopLoader();
+
+		m_Items.clear();
+		m_Decoded.clear();
+	}
+
+	std::string ThumbnailGallery::Show()
+	{
+		UploadDecoded();
+
+		std::string clicked;
+		if (m_Items.empty()) {
+			ImGui::TextDisabled("Apply Retrieval to see the matches here.");
+			return clicked;
+		}
+
+		// Wrap the cells to the window width
+		const float cellSize = static_cast<float>(ThumbnailSize);
+		int columns = std::max(1, static_cast<int>(ImGui::GetContentRegionAvail().x / (cellSize + 8.0f)));
+
+		// Thumbnails go to their own channel: text and highlights use the font atlas, interleaving them would
+		// split the grid into a draw command per cell. Merged, all thumbnails are one command on the atlas texture.
+		ImDrawList* drawList = ImGui::GetWindowDrawList();
+		drawList->ChannelsSplit(2);
+
+		for (size_t i = 0; i < m_Items.size(); ++i) {
+			const Item& item = m_Items[i];
+
+			if (i % columns != 0)
+				ImGui::SameLine();
+
+			ImGui::PushID(static_cast<int>(i));
+			ImGui::BeginGroup();
+
+			ImVec2 cellMin = ImGui::GetCursorScreenPos();
+			if (ImGui::InvisibleButton("##thumbnail", ImVec2(cellSize, cellSize)) && item.ready)
+				clicked = item.path;
+			bool hovered = ImGui::IsItemHovered();
+
+			drawList->ChannelsSetCurrent(1);
+			if (hovered) {
+				drawList->AddRect(cellMin, ImVec2(cellMin.x + cellSize, cellMin.y + cellSize), IM_COL32(0, 255, 0, 255));
+				ImGui::SetTooltip("%s\nDistance: %f", item.path.c_str(), item.distance);
+			}
+
+			if (item.ready) {
+				// Centered in the cell, the thumbnail keeps the aspect ratio of the image
+				float width = (item.uv1.x - item.uv0.x) * AtlasColumns * cellSize;
+				float height = (item.uv1.y - item.uv0.y) * AtlasRows * cellSize;
+				ImVec2 imageMin(cellMin.x + (cellSize - width) * 0.5f, cellMin.y + (cellSize - height) * 0.5f);
+
+				drawList->ChannelsSetCurrent(0);
+				drawList->AddImage((void*)(intptr_t)m_AtlasTexture, imageMin, ImVec2(imageMin.x + width, imageMin.y + height), item.uv0, item.uv1);
+				drawList->ChannelsSetCurrent(1);
+			}
+
+			ImGui::Text("%s", item.failed ? "(unreadable)" : item.name.c_str());
+			ImGui::Text("%.4f", item.distance);
+
+			ImGui::EndGroup();
+			ImGui::PopID();
+		}
+
+		drawList->ChannelsMerge();
+
+		return clicked;
+	}
+
+	void ThumbnailGallery::StopLoader()
+	{
+		if (m_Loader.joinable()) {
+			m_Progress.cancelRequested = true;
+			m_Loader.join();
+		}
+	}
+
+	void ThumbnailGallery::UploadDecoded()
+	{
+		std::vector<Decoded> decoded;
+		{
+			std::lock_guard<std::mutex> lock(m_DecodedMutex);
+			decoded.swap(m_Decoded);
+		}
+
+		if (decoded.empty())
+			return;
+
+		const int atlasWidth = AtlasColumns * ThumbnailSize;
+		const int atlasHeight = AtlasRows * ThumbnailSize;
+
+		if (m_AtlasTexture == 0) {
+			glGenTextures(1, &m_AtlasTexture);
+			glBindTexture(GL_TEXTURE_2D, m_AtlasTexture);
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, atlasWidth, atlasHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		}
+		else {
+			glBindTexture(GL_TEXTURE_2D, m_AtlasTexture);
+		}
+
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+		for (auto& entry : decoded) {
+			if (entry.item >= m_Items.size())
+				continue;
+
+			Item& item = m_Items[entry.item];
+			if (entry.thumbnail.empty()) {
+				item.failed = true;
+				continue;
+			}
+
+			// Result i owns cell i, so a cell is never shared between two results
+			int x = static_cast<int>(entry.item % AtlasColumns) * ThumbnailSize;
+			int y = static_cast<int>(entry.item / AtlasColumns) * ThumbnailSize;
+			if (!entry.thumbnail.isContinuous())
+				entry.thumbnail = entry.thumbnail.clone();
+			glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, entry.thumbnail.cols, entry.thumbnail.rows, GL_RGBA, GL_UNSIGNED_BYTE, entry.thumbnail.data);
+
+			item.uv0 = ImVec2(static_cast<float>(x) / atlasWidth, static_cast<float>(y) / atlasHeight);
+			item.uv1 = ImVec2(static_cast<float>(x + entry.thumbnail.cols) / atlasWidth, static_cast<float>(y + entry.thumbnail.rows) / atlasHeight);
+			item.ready = true;
+		}
+
+		glBindTexture(GL_TEXTURE_2D, 0);
+	}
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <GLFW/glfw3.h>
+#include <imgui.h>
+#include <opencv2/opencv.hpp>
+
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "BatchExecutor/BatchExecutor.h"
+
+namespace SyncShapes
+{
+	// Retrieval results as a grid of thumbnails. Thumbnails are decoded at reduced resolution on background threads
+	// and packed into one atlas texture, so the whole grid is drawn from a single texture in one batch.
+	class ThumbnailGallery
+	{
+	public:
+		static constexpr int ThumbnailSize = 128;
+		static constexpr int AtlasColumns = 8;
+		static constexpr int AtlasRows = 8;
+		static constexpr size_t Capacity = AtlasColumns * AtlasRows;
+
+		ThumbnailGallery();
+		~ThumbnailGallery();
+
+		ThumbnailGallery(const ThumbnailGallery&) = delete;
+		ThumbnailGallery& operator=(const ThumbnailGallery&) = delete;
+
+		// Replaces the shown results, the first Capacity matches are kept. 'paths' holds the image file of each result.
+		void SetResults(const std::vector<std::pair<std::string, double>>& results, const std::vector<std::string>& paths);
+		void Clear();
+
+		// Draws the grid into the current window and uploads the thumbnails finished since the last frame.
+		// Returns the path of the thumbnail clicked this frame, empty otherwise.
+		std::string Show();
+
+		inline bool IsEmpty() const { return m_Items.empty(); }
+		// Some thumbnails are not decoded or uploaded yet
+		bool IsLoading() const;
+	private:
+		struct Item
+		{
+			std::string name;
+			std::string path;
+			double distance = 0.0;
+			ImVec2 uv0, uv1;
+			bool ready = false;
+			bool failed = false;
+		};
+
+		struct Decoded
+		{
+			size_t item;
+			cv::Mat thumbnail; // RGBA, empty on failure
+		};
+
+		std::vector<Item> m_Items;
+		GLuint m_AtlasTexture;
+
+		// Filled by the loader, drained by the UI thread which owns the GL context
+		std::mutex m_DecodedMutex;
+		std::vector<Decoded> m_Decoded;
+
+		std::thread m_Loader;
+		BatchProgress m_Progress;
+
+		void StopLoader();
+		void UploadDecoded();
+	};
+}
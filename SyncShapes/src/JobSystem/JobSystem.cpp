@@ -0,0 +1,127 @@
+#include "JobSystem.h"
+
+#include <exception>
+#include <iostream>
+
+namespace SyncShapes
+{
+	JobSystem::JobSystem() : m_Running(false), m_Stopping(false)
+	{
+		m_Worker = std::thread(&JobSystem::WorkerLoop, this);
+	}
+
+	JobSystem::~JobSystem()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Stopping = true;
+			m_Queue.clear();
+			m_Progress.cancelRequested = true;
+		}
+
+		m_Condition.notify_all();
+		m_Worker.join();
+	}
+
+	void JobSystem::Submit(const std::string& name, Job job)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Queue.push_back({ name, std::move(job) });
+		}
+
+		m_Condition.notify_one();
+	}
+
+	void JobSystem::CancelAll()
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Queue.clear();
+
+		if (m_Running)
+			m_Progress.cancelRequested = true;
+	}
+
+	void JobSystem::PublishCompleted()
+	{
+		std::vector<Completion> completed;
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			completed.swap(m_Completed);
+		}
+
+		for (auto& completion : completed) {
+			if (completion)
+				completion();
+		}
+	}
+
+	bool JobSystem::IsBusy() const
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		return m_Running || !m_Queue.empty();
+	}
+
+	JobStatus JobSystem::GetStatus() const
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		JobStatus status;
+		status.name = m_RunningName;
+		status.running = m_Running;
+		status.cancelRequested = m_Progress.IsCancelled();
+		status.completed = m_Progress.completed.load(std::memory_order_relaxed);
+		status.total = m_Progress.total.load(std::memory_order_relaxed);
+		status.queued = m_Queue.size();
+		if (m_Running)
+			status.elapsedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_StartTime).count();
+
+		return status;
+	}
+
+	void JobSystem::WorkerLoop()
+	{
+		for (;;) {
+			PendingJob pending;
+			{
+				std::unique_lock<std::mutex> lock(m_Mutex);
+				m_Condition.wait(lock, [this] { return m_Stopping || !m_Queue.empty(); });
+
+				if (m_Stopping)
+					return;
+
+				pending = std::move(m_Queue.front());
+				m_Queue.pop_front();
+
+				m_Progress.Reset();
+				m_RunningName = pending.name;
+				m_StartTime = std::chrono::steady_clock::now();
+				m_Running = true;
+			}
+
+			if (m_Wake)
+				m_Wake();
+
+			Completion completion;
+			try {
+				completion = pending.job(m_Progress);
+			}
+			catch (const std::exception& e) {
+				std::cerr << "Job '" << pending.name << "' failed: " << e.what() << std::endl;
+			}
+			catch (...) {
+				std::cerr << "Job '" << pending.name << "' failed with an unknown exception" << std::endl;
+			}
+
+			{
+				std::lock_guard<std::mutex> lock(m_Mutex);
+				m_Completed.push_back(std::move(completion));
+				m_RunningName.clear();
+				m_Running = false;
+			}
+
+			if (m_Wake)
+				m_Wake();
+		}
+	}
+}
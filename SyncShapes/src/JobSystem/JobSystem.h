@@ -0,0 +1,73 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "BatchExecutor/BatchExecutor.h"
+
+namespace SyncShapes
+{
+	struct JobStatus
+	{
+		std::string name;
+		bool running = false;
+		bool cancelRequested = false;
+		size_t completed = 0;
+		size_t total = 0;
+		size_t queued = 0;
+		double elapsedSeconds = 0.0;
+	};
+
+	// Runs long pipeline stages one after another on a background thread, so the render loop keeps going.
+	// A job returns a completion callback, PublishCompleted runs it on the UI thread: results reach ImGui
+	// state and OpenGL only from the thread that owns them.
+	class JobSystem
+	{
+	public:
+		using Completion = std::function<void()>;
+		using Job = std::function<Completion(BatchProgress& progress)>;
+
+		JobSystem();
+		~JobSystem();
+
+		void Submit(const std::string& name, Job job);
+		// Cancels the running job and drops the queued ones
+		void CancelAll();
+		// Call once per frame from the UI thread
+		void PublishCompleted();
+		// Called on the worker when a job starts and when its completion is ready, so an idle render loop can wake up.
+		// Set it before submitting jobs.
+		inline void SetWakeCallback(std::function<void()> wake) { m_Wake = std::move(wake); }
+
+		bool IsBusy() const;
+		JobStatus GetStatus() const;
+	private:
+		struct PendingJob
+		{
+			std::string name;
+			Job job;
+		};
+
+		mutable std::mutex m_Mutex;
+		std::condition_variable m_Condition;
+		std::deque<PendingJob> m_Queue;
+		std::vector<Completion> m_Completed;
+
+		std::string m_RunningName;
+		bool m_Running;
+		bool m_Stopping;
+		std::chrono::steady_clock::time_point m_StartTime;
+		BatchProgress m_Progress;
+		std::function<void()> m_Wake;
+
+		std::thread m_Worker;
+
+		void WorkerLoop();
+	};
+}
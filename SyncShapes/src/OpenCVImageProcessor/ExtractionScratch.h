@@ -0,0 +1,40 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+
+#include <vector>
+
+#include "FeatureStore/FeatureStore.h"
+
+namespace SyncShapes
+{
+	// Working buffers of decoding, contour extraction and the moment stage, kept from one image to the next.
+	// Every thread has its own, so a batch worker only allocates when an image is larger or has more contours
+	// than any it processed before: cv::Mat::create and std::vector::resize keep storage that is big enough.
+	struct ExtractionScratch
+	{
+		cv::Mat image; // Decoded input of the streaming passes
+		cv::Mat gray;
+		cv::Mat thresh;
+		std::vector<std::vector<cv::Point>> contours;
+		std::vector<cv::Point> hull;
+		FeatureData features;
+
+		// Single channel images are used as they are, never written to; others are converted into 'gray'
+		inline const cv::Mat& ToGray(const cv::Mat& source)
+		{
+			if (source.channels() == 1)
+				return source;
+
+			cv::cvtColor(source, gray, cv::COLOR_BGR2GRAY);
+			return gray;
+		}
+
+		// The calling thread's scratch, released when the thread exits
+		static inline ExtractionScratch& Get()
+		{
+			thread_local ExtractionScratch scratch;
+			return scratch;
+		}
+	};
+}
@@ -0,0 +1,117 @@
+#include "GifDecoder.h"
+#include "Profiler/Profiler.h"
+
+#include <FreeImage.h>
+
+#include <cstring>
+
+namespace SyncShapes
+{
+	namespace
+	{
+		// Initialised on first use and released at exit, instead of around every file
+		struct FreeImageLibrary
+		{
+			FreeImageLibrary() { FreeImage_Initialise(); }
+			~FreeImageLibrary() { FreeImage_DeInitialise(); }
+		};
+
+		// Same weights and rounding as FreeImage's LUMA_REC709 based GREY macro
+		inline uint8_t Luminance(const RGBQUAD& color)
+		{
+			return static_cast<uint8_t>(0.2126F * color.rgbRed + 0.7152F * color.rgbGreen + 0.0722F * color.rgbBlue + 0.5F);
+		}
+
+		// FreeImage stores rows bottom-up
+		void CopyRows(FIBITMAP* bitmap, cv::Mat& image)
+		{
+			for (int row = 0; row < image.rows; ++row)
+				std::memcpy(image.ptr(row), FreeImage_GetScanLine(bitmap, image.rows - 1 - row), image.cols);
+		}
+
+		// Palette or low bit depth frame to an 8-bit gray image
+		bool ToGrayscale(FIBITMAP* gifImage, cv::Mat& image, std::string& error)
+		{
+			int width = static_cast<int>(FreeImage_GetWidth(gifImage));
+			int height = static_cast<int>(FreeImage_GetHeight(gifImage));
+			image.create(height, width, CV_8UC1);
+
+			RGBQUAD* palette = FreeImage_GetPalette(gifImage);
+			if (FreeImage_GetBPP(gifImage) == 8 && palette) {
+				// GIF frames are palette indices: map them through a 256 entry gray table, no intermediate bitmap
+				uint8_t gray[256];
+				unsigned int colors = FreeImage_GetColorsUsed(gifImage);
+				for (unsigned int index = 0; index < 256; ++index)
+					gray[index] = index < colors ? Luminance(palette[index]) : 0;
+
+				for (int row = 0; row < height; ++row) {
+					const uint8_t* indices = FreeImage_GetScanLine(gifImage, height - 1 - row);
+					uint8_t* pixels = image.ptr(row);
+					for (int x = 0; x < width; ++x)
+						pixels[x] = gray[indices[x]];
+				}
+			}
+			else {
+				// 1 and 4 bit frames are rare, leave them to FreeImage
+				FIBITMAP* grayscaleImage = FreeImage_ConvertToGreyscale(gifImage);
+				if (!grayscaleImage) {
+					error = "Failed to convert the GIF image to grayscale";
+					return false;
+				}
+
+				CopyRows(grayscaleImage, image);
+				FreeImage_Unload(grayscaleImage);
+			}
+
+			return true;
+		}
+	}
+
+	void GifDecoder::Initialise()
+	{
+		static FreeImageLibrary library;
+	}
+
+	bool GifDecoder::Decode(const std::string& gifImagePath, cv::Mat& image, std::string& error)
+	{
+		SS_PROFILE_SCOPE("gif_decode");
+
+		Initialise();
+
+		FIBITMAP* gifImage = FreeImage_Load(FIF_GIF, gifImagePath.c_str(), GIF_DEFAULT);
+		if (!gifImage) {
+			error = "Failed to load the GIF image";
+			return false;
+		}
+
+		bool converted = ToGrayscale(gifImage, image, error);
+		FreeImage_Unload(gifImage);
+		return converted;
+	}
+
+	bool GifDecoder::Decode(const uint8_t* data, size_t size, cv::Mat& image, std::string& error)
+	{
+		SS_PROFILE_SCOPE("gif_decode");
+
+		Initialise();
+
+		// FreeImage only reads from the memory stream, the cast drops a const it never writes through
+		FIMEMORY* stream = FreeImage_OpenMemory(const_cast<BYTE*>(data), static_cast<DWORD>(size));
+		if (!stream) {
+			error = "Failed to open the GIF data";
+			return false;
+		}
+
+		FIBITMAP* gifImage = FreeImage_LoadFromMemory(FIF_GIF, stream, GIF_DEFAULT);
+		if (!gifImage) {
+			FreeImage_CloseMemory(stream);
+			error = "Failed to load the GIF image";
+			return false;
+		}
+
+		bool converted = ToGrayscale(gifImage, image, error);
+		FreeImage_Unload(gifImage);
+		FreeImage_CloseMemory(stream);
+		return converted;
+	}
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+
+#include <cstdint>
+#include <string>
+
+namespace SyncShapes
+{
+	// Decodes GIFs straight into 8-bit single channel images with FreeImage. The library is initialised once per
+	// process on first use, decoding is safe from several threads at a time.
+	class GifDecoder
+	{
+	public:
+		static constexpr const char* Extension = ".gif";
+
+		// Gray levels follow FreeImage_ConvertToGreyscale, so decoded images match the former converted files
+		static bool Decode(const std::string& gifImagePath, cv::Mat& image, std::string& error);
+		// Decodes a GIF file that has already been read into memory
+		static bool Decode(const uint8_t* data, size_t size, cv::Mat& image, std::string& error);
+	private:
+		static void Initialise();
+	};
+}
@@ -0,0 +1,183 @@
+#include "ImageCache.h"
+
+namespace SyncShapes
+{
+	ImageCache::ImageCache(size_t byteBudget) : m_ByteBudget(byteBudget), m_BytesUsed(0), m_Hits(0), m_Misses(0) {}
+
+	SharedImage ImageCache::Get(const std::string& imagePath, const ImageDecoder& decode)
+	{
+		std::filesystem::file_time_type writeTime;
+		uintmax_t fileSize = 0;
+		if (!Stat(imagePath, writeTime, fileSize))
+			return nullptr;
+
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+
+			auto found = m_Lookup.find(imagePath);
+			if (found != m_Lookup.end()) {
+				auto entry = found->second;
+				if (entry->writeTime == writeTime && entry->fileSize == fileSize) {
+					m_Entries.splice(m_Entries.begin(), m_Entries, entry);
+					++m_Hits;
+					return entry->image;
+				}
+
+				Erase(entry);
+			}
+
+			++m_Misses;
+		}
+
+		// Decoding outside the lock keeps the workers parallel, two threads missing on the same file both decode it
+		cv::Mat decoded = decode(imagePath);
+		if (decoded.empty())
+			return nullptr;
+
+		Entry entry;
+		entry.path = imagePath;
+		entry.bytes = decoded.total() * decoded.elemSize();
+		entry.image = std::make_shared<const cv::Mat>(std::move(decoded));
+		entry.writeTime = writeTime;
+		entry.fileSize = fileSize;
+
+		SharedImage image = entry.image;
+
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		Insert(std::move(entry));
+
+		return image;
+	}
+
+	SharedImage ImageCache::Find(const std::string& imagePath)
+	{
+		std::filesystem::file_time_type writeTime;
+		uintmax_t fileSize = 0;
+		if (!Stat(imagePath, writeTime, fileSize))
+			return nullptr;
+
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		auto found = m_Lookup.find(imagePath);
+		if (found == m_Lookup.end() || found->second->writeTime != writeTime || found->second->fileSize != fileSize)
+			return nullptr;
+
+		m_Entries.splice(m_Entries.begin(), m_Entries, found->second);
+		++m_Hits;
+		return found->second->image;
+	}
+
+	void ImageCache::Put(const std::string& imagePath, cv::Mat image)
+	{
+		Entry entry;
+		if (image.empty() || !Stat(imagePath, entry.writeTime, entry.fileSize)) {
+			Invalidate(imagePath);
+			return;
+		}
+
+		entry.path = imagePath;
+		entry.bytes = image.total() * image.elemSize();
+		entry.image = std::make_shared<const cv::Mat>(std::move(image));
+
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		Insert(std::move(entry));
+	}
+
+	void ImageCache::Invalidate(const std::string& imagePath)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		auto found = m_Lookup.find(imagePath);
+		if (found != m_Lookup.end())
+			Erase(found->second);
+	}
+
+	void ImageCache::Clear()
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		m_Entries.clear();
+		m_Lookup.clear();
+		m_BytesUsed = 0;
+	}
+
+	void ImageCache::SetByteBudget(size_t byteBudget)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		m_ByteBudget = byteBudget;
+		EvictToBudget();
+	}
+
+	size_t ImageCache::GetByteBudget() const
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		return m_ByteBudget;
+	}
+
+	size_t ImageCache::GetBytesUsed() const
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		return m_BytesUsed;
+	}
+
+	size_t ImageCache::GetCount() const
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		return m_Entries.size();
+	}
+
+	size_t ImageCache::GetHits() const
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		return m_Hits;
+	}
+
+	size_t ImageCache::GetMisses() const
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		return m_Misses;
+	}
+
+	bool ImageCache::Stat(const std::string& imagePath, std::filesystem::file_time_type& writeTime, uintmax_t& fileSize)
+	{
+		std::error_code ec;
+		writeTime = std::filesystem::last_write_time(imagePath, ec);
+		if (ec)
+			return false;
+
+		fileSize = std::filesystem::file_size(imagePath, ec);
+		return !ec;
+	}
+
+	void ImageCache::Insert(Entry entry)
+	{
+		// Another thread may have cached the same file meanwhile, the newer decode replaces it
+		auto found = m_Lookup.find(entry.path);
+		if (found != m_Lookup.end())
+			Erase(found->second);
+
+		// Larger than the whole budget: returned to the caller but never cached
+		if (entry.bytes > m_ByteBudget)
+			return;
+
+		m_BytesUsed += entry.bytes;
+		m_Entries.push_front(std::move(entry));
+		m_Lookup[m_Entries.front().path] = m_Entries.begin();
+
+		EvictToBudget();
+	}
+
+	void ImageCache::Erase(std::list<Entry>::iterator entry)
+	{
+		m_BytesUsed -= entry->bytes;
+		m_Lookup.erase(entry->path);
+		m_Entries.erase(entry);
+	}
+
+	void ImageCache::EvictToBudget()
+	{
+		while (m_BytesUsed > m_ByteBudget && !m_Entries.empty())
+			Erase(std::prev(m_Entries.end()));
+	}
+}
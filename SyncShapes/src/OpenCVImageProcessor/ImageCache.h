@@ -0,0 +1,75 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+
+#include <filesystem>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace SyncShapes
+{
+	// Decoded images are shared read-only, a caller that modifies one works on a clone
+	using SharedImage = std::shared_ptr<const cv::Mat>;
+	using ImageDecoder = std::function<cv::Mat(const std::string& imagePath)>;
+
+	// Process-wide LRU of decoded images keyed by path, an entry is valid while the file keeps its write time and size.
+	// Bounded by the bytes of the pixel data; an evicted image stays alive for as long as a caller still holds it.
+	// Safe to use from the batch workers.
+	class ImageCache
+	{
+	public:
+		static constexpr size_t DefaultByteBudget = 256ull * 1024 * 1024;
+
+		explicit ImageCache(size_t byteBudget = DefaultByteBudget);
+
+		ImageCache(const ImageCache&) = delete;
+		ImageCache& operator=(const ImageCache&) = delete;
+
+		// Returns the cached image, or decodes, caches and returns it. Null when the file is missing or cannot be decoded.
+		SharedImage Get(const std::string& imagePath, const ImageDecoder& decode);
+		// Returns the cached image if it is still current, never decodes
+		SharedImage Find(const std::string& imagePath);
+		// Caches an image just written to 'imagePath', only valid for lossless formats
+		void Put(const std::string& imagePath, cv::Mat image);
+		void Invalidate(const std::string& imagePath);
+		void Clear();
+
+		void SetByteBudget(size_t byteBudget);
+		size_t GetByteBudget() const;
+		size_t GetBytesUsed() const;
+		size_t GetCount() const;
+		size_t GetHits() const;
+		size_t GetMisses() const;
+	private:
+		struct Entry
+		{
+			std::string path;
+			SharedImage image;
+			size_t bytes = 0;
+			std::filesystem::file_time_type writeTime;
+			uintmax_t fileSize = 0;
+		};
+
+		mutable std::mutex m_Mutex;
+
+		// Most recently used first
+		std::list<Entry> m_Entries;
+		std::unordered_map<std::string, std::list<Entry>::iterator> m_Lookup;
+
+		size_t m_ByteBudget;
+		size_t m_BytesUsed;
+		size_t m_Hits;
+		size_t m_Misses;
+
+		static bool Stat(const std::string& imagePath, std::filesystem::file_time_type& writeTime, uintmax_t& fileSize);
+
+		// Callers hold m_Mutex
+		void Insert(Entry entry);
+		void Erase(std::list<Entry>::iterator entry);
+		void EvictToBudget();
+	};
+}
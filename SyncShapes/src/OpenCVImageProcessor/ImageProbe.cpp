@@ -0,0 +1,241 @@
+#include "ImageProbe.h"
+#include "MaskCodec.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace SyncShapes
+{
+	std::mutex ImageProbe::m_DetailsMutex;
+	std::unordered_map<std::string, ImageProbe::CachedDetails> ImageProbe::m_DetailsCache;
+
+	namespace
+	{
+		inline uint32_t ReadBigEndian16(const uint8_t* bytes) { return (uint32_t(bytes[0]) << 8) | bytes[1]; }
+		inline uint32_t ReadBigEndian32(const uint8_t* bytes) { return (ReadBigEndian16(bytes) << 16) | ReadBigEndian16(bytes + 2); }
+		inline uint32_t ReadLittleEndian16(const uint8_t* bytes) { return uint32_t(bytes[0]) | (uint32_t(bytes[1]) << 8); }
+		inline uint32_t ReadLittleEndian32(const uint8_t* bytes) { return ReadLittleEndian16(bytes) | (ReadLittleEndian16(bytes + 2) << 16); }
+
+		// Blocks are ORed without branching so the inner loop vectorizes, the early exit is taken between blocks
+		template <int Channels>
+		bool ScanGrayscale(const cv::Mat& image)
+		{
+			constexpr int BlockPixels = 256;
+
+			for (int row = 0; row < image.rows; ++row) {
+				const uint8_t* pixels = image.ptr<uint8_t>(row);
+
+				for (int start = 0; start < image.cols; start += BlockPixels) {
+					int end = std::min(image.cols, start + BlockPixels);
+					unsigned int difference = 0;
+
+					for (int x = start; x < end; ++x) {
+						const uint8_t* pixel = pixels + x * Channels;
+						difference |= static_cast<unsigned int>(pixel[0] ^ pixel[1]) | static_cast<unsigned int>(pixel[0] ^ pixel[2]);
+					}
+
+					if (difference != 0)
+						return false;
+				}
+			}
+
+			return true;
+		}
+	}
+
+	bool ImageProbe::ReadMetadata(const std::string& imagePath, ImageMetadata& metadata)
+	{
+		metadata = ImageMetadata();
+
+		std::ifstream file(imagePath, std::ios::binary);
+		if (!file)
+			return false;
+
+		// Enough for the fixed headers of every format but JPEG, whose frame header is found by walking its segments
+		uint8_t header[32] = {};
+		file.read(reinterpret_cast<char*>(header), sizeof(header));
+		size_t length = static_cast<size_t>(file.gcount());
+
+		if (length >= 4 && header[0] == 0xFF && header[1] == 0xD8) {
+			file.clear();
+			file.seekg(2);
+			return ReadJpegMetadata(file, metadata);
+		}
+
+		static const uint8_t PngSignature[8] = { 0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A };
+		if (length >= 26 && std::equal(PngSignature, PngSignature + 8, header) && std::equal(header + 12, header + 16, "IHDR")) {
+			metadata.format = ImageFormat::Png;
+			metadata.width = static_cast<int>(ReadBigEndian32(header + 16));
+			metadata.height = static_cast<int>(ReadBigEndian32(header + 20));
+
+			switch (header[25]) {
+			case 0: metadata.channels = 1; break;
+			case 2: metadata.channels = 3; break;
+			case 3: metadata.channels = 3; metadata.palette = true; break;
+			case 4: metadata.channels = 2; break;
+			case 6: metadata.channels = 4; break;
+			default: return false;
+			}
+
+			return true;
+		}
+
+		if (length >= 10 && (std::equal(header, header + 6, "GIF87a") || std::equal(header, header + 6, "GIF89a"))) {
+			metadata.format = ImageFormat::Gif;
+			metadata.width = static_cast<int>(ReadLittleEndian16(header + 6));
+			metadata.height = static_cast<int>(ReadLittleEndian16(header + 8));
+			metadata.channels = 3;
+			metadata.palette = true;
+			return true;
+		}
+
+		if (length >= 30 && header[0] == 'B' && header[1] == 'M') {
+			metadata.format = ImageFormat::Bmp;
+			uint32_t infoSize = ReadLittleEndian32(header + 14);
+			uint32_t bitCount;
+
+			if (infoSize == 12) {
+				// OS/2 core header, 16-bit dimensions
+				metadata.width = static_cast<int>(ReadLittleEndian16(header + 18));
+				metadata.height = static_cast<int>(ReadLittleEndian16(header + 20));
+				bitCount = ReadLittleEndian16(header + 24);
+			}
+			else {
+				// Negative heights mark top-down bitmaps
+				metadata.width = static_cast<int>(static_cast<int32_t>(ReadLittleEndian32(header + 18)));
+				metadata.height = std::abs(static_cast<int>(static_cast<int32_t>(ReadLittleEndian32(header + 22))));
+				bitCount = ReadLittleEndian16(header + 28);
+			}
+
+			metadata.palette = bitCount <= 8;
+			metadata.channels = bitCount == 32 ? 4 : 3;
+			return true;
+		}
+
+		if (length >= sizeof(MaskHeader) && std::equal(header, header + 4, MaskCodec::Magic)) {
+			MaskHeader maskHeader;
+			std::memcpy(&maskHeader, header, sizeof(maskHeader));
+
+			metadata.format = ImageFormat::Mask;
+			metadata.width = static_cast<int>(maskHeader.width);
+			metadata.height = static_cast<int>(maskHeader.height);
+			metadata.channels = maskHeader.channels;
+			return true;
+		}
+
+		return false;
+	}
+
+	bool ImageProbe::ReadJpegMetadata(std::ifstream& file, ImageMetadata& metadata)
+	{
+		uint8_t marker[4];
+
+		while (file.read(reinterpret_cast<char*>(marker), 2)) {
+			if (marker[0] != 0xFF)
+				return false;
+
+			// Fill bytes before a marker
+			if (marker[1] == 0xFF) {
+				file.seekg(-1, std::ios::cur);
+				continue;
+			}
+
+			// Standalone markers carry no length
+			if (marker[1] == 0x01 || (marker[1] >= 0xD0 && marker[1] <= 0xD7))
+				continue;
+
+			if (marker[1] == 0xD9 || marker[1] == 0xDA)
+				return false;
+
+			if (!file.read(reinterpret_cast<char*>(marker + 2), 2))
+				return false;
+
+			uint32_t segmentLength = ReadBigEndian16(marker + 2);
+			if (segmentLength < 2)
+				return false;
+
+			// Start of frame: every SOFn but the DHT, JPG and DAC markers that share the range
+			bool startOfFrame = marker[1] >= 0xC0 && marker[1] <= 0xCF && marker[1] != 0xC4 && marker[1] != 0xC8 && marker[1] != 0xCC;
+			if (startOfFrame) {
+				uint8_t frame[6];
+				if (segmentLength < 8 || !file.read(reinterpret_cast<char*>(frame), sizeof(frame)))
+					return false;
+
+				metadata.format = ImageFormat::Jpeg;
+				metadata.height = static_cast<int>(ReadBigEndian16(frame + 1));
+				metadata.width = static_cast<int>(ReadBigEndian16(frame + 3));
+				metadata.channels = frame[5];
+				return metadata.width > 0 && metadata.height > 0;
+			}
+
+			file.seekg(segmentLength - 2, std::ios::cur);
+		}
+
+		return false;
+	}
+
+	bool ImageProbe::IsGrayscale(const cv::Mat& image)
+	{
+		if (image.channels() == 1)
+			return true;
+
+		if (image.type() == CV_8UC3)
+			return ScanGrayscale<3>(image);
+		if (image.type() == CV_8UC4)
+			return ScanGrayscale<4>(image);
+
+		return false;
+	}
+
+	ImageDetails ImageProbe::GetDetails(const std::string& imagePath, const std::function<std::shared_ptr<const cv::Mat>(const std::string&)>& load)
+	{
+		namespace fs = std::filesystem;
+
+		std::error_code ec;
+		int64_t writeTime = static_cast<int64_t>(fs::last_write_time(imagePath, ec).time_since_epoch().count());
+		uintmax_t fileSize = ec ? 0 : fs::file_size(imagePath, ec);
+		bool stamped = !ec;
+
+		if (stamped) {
+			std::lock_guard<std::mutex> lock(m_DetailsMutex);
+			auto found = m_DetailsCache.find(imagePath);
+			if (found != m_DetailsCache.end() && found->second.writeTime == writeTime && found->second.fileSize == fileSize)
+				return found->second.details;
+		}
+
+		ImageDetails details;
+		ImageMetadata metadata;
+		bool probed = ReadMetadata(imagePath, metadata);
+
+		if (probed && (metadata.channels == 1 || metadata.channels == 2)) {
+			details.type = "Grayscale";
+			details.width = metadata.width;
+			details.height = metadata.height;
+		}
+		else {
+			// Color layouts, palettes and unknown formats: only the pixels tell
+			std::shared_ptr<const cv::Mat> image = load(imagePath);
+			if (!image)
+				return details;
+
+			if (image->channels() == 1)
+				details.type = "Grayscale";
+			else if (image->type() == CV_8UC3 || image->type() == CV_8UC4)
+				details.type = IsGrayscale(*image) ? "Grayscale" : "RGB";
+			else
+				details.type = "Unknown";
+
+			details.width = image->cols;
+			details.height = image->rows;
+		}
+
+		if (stamped) {
+			std::lock_guard<std::mutex> lock(m_DetailsMutex);
+			m_DetailsCache[imagePath] = { writeTime, fileSize, details };
+		}
+
+		return details;
+	}
+}
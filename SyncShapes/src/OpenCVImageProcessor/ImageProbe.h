@@ -0,0 +1,61 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace SyncShapes
+{
+	struct ImageDetails
+	{
+		std::string type;
+		int width = 0;
+		int height = 0;
+	};
+
+	enum class ImageFormat
+	{
+		Unknown, Jpeg, Png, Gif, Bmp, Mask
+	};
+
+	// What the file header says about the pixels, before anything is decoded
+	struct ImageMetadata
+	{
+		ImageFormat format = ImageFormat::Unknown;
+		int width = 0;
+		int height = 0;
+		int channels = 0; // Stored channels, palette images count the channels of their palette entries
+		bool palette = false;
+	};
+
+	// Header-only metadata of JPEG, PNG, GIF, BMP and .ssm files, plus the grayscale check that still needs the pixels
+	class ImageProbe
+	{
+	public:
+		static bool ReadMetadata(const std::string& imagePath, ImageMetadata& metadata);
+
+		// One pass over 8-bit 3 or 4 channel pixels that stops at the first colored block, allocates nothing
+		static bool IsGrayscale(const cv::Mat& image);
+
+		// Details for the UI, cached per file while its write time and size hold. Single channel headers answer
+		// "Grayscale" without decoding, color ones decode through 'load' and scan the pixels.
+		static ImageDetails GetDetails(const std::string& imagePath, const std::function<std::shared_ptr<const cv::Mat>(const std::string&)>& load);
+	private:
+		struct CachedDetails
+		{
+			int64_t writeTime = 0;
+			uintmax_t fileSize = 0;
+			ImageDetails details;
+		};
+
+		static std::mutex m_DetailsMutex;
+		static std::unordered_map<std::string, CachedDetails> m_DetailsCache;
+
+		static bool ReadJpegMetadata(std::ifstream& file, ImageMetadata& metadata);
+	};
+}
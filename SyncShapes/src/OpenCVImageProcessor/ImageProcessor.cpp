@@ -1,255 +1,158 @@
-#include <GL/glew.h>
 #include "ImageProcessor.h"
+#include "GifDecoder.h"
+#include "ExtractionScratch.h"
+#include "FeatureIndex/HuDistance.h"
+#include "FeatureIndex/ShapeCascade.h"
+#include "Profiler/Profiler.h"
+#include "FeatureIndex/TopKSelector.h"
+#include "BatchExecutor/BoundedQueue.h"
+#include "BatchExecutor/FilePrefetcher.h"
+
+#include <condition_variable>
+#include <cstring>
+#include <map>
+#include <numeric>
+#include <thread>
 
 namespace SyncShapes
 {
 	std::string ImageProcessor::m_PreprocessingDir("");
 	std::string ImageProcessor::m_FeatureExtractionDir("");
 	std::unordered_map<std::string, FeatureData> ImageProcessor::m_AllFeatures = std::unordered_map<std::string, FeatureData>();
+	FeatureStore ImageProcessor::m_FeatureStore;
+	FeatureMatrix ImageProcessor::m_FeatureMatrix;
+	HnswIndex ImageProcessor::m_ApproximateIndex;
+	ClusterIndex ImageProcessor::m_ClusterIndex;
+	FeatureCompression ImageProcessor::m_FeatureCompression = FeatureCompression::None;
+	QuantizedMatrix ImageProcessor::m_CompressedFeatures;
+	size_t ImageProcessor::m_RerankFactor = 4;
+	double ImageProcessor::m_CascadeTolerance = 1.0;
+	ShardedIndex ImageProcessor::m_Datasets;
+	bool ImageProcessor::m_UseApproximateIndex = false;
+	bool ImageProcessor::m_UseClusterIndex = false;
+	bool ImageProcessor::m_ExportFeaturesAsText = false;
 	bool ImageProcessor::m_ContoursOverlay = false;
+	unsigned int ImageProcessor::m_WorkerCount = 0;
+	size_t ImageProcessor::m_PrefetchDepth = 16;
+	std::string ImageProcessor::m_IntermediateExtension(MaskCodec::Extension);
+	BatchProgress* ImageProcessor::m_Progress = nullptr;
+	ImageCache ImageProcessor::m_ImageCache;
 
 	ImageProcessor::ImageProcessor() {}
 	ImageProcessor::~ImageProcessor() {}
 
 	void ImageProcessor::DisplayImage(const std::string& imagePath, const std::string& windowName)
 	{
-		cv::Mat image = cv::imread(imagePath);
+		SharedImage image = LoadImage(imagePath);
 
-		if (!image.empty()) {
+		if (image) {
 			cv::namedWindow(windowName, cv::WINDOW_NORMAL);
-			cv::imshow(windowName, image);
+			cv::imshow(windowName, *image);
 			cv::waitKey(0);
 		}
 		else {
-			std::cout << "Failed to load the image. Cannot display." << std::endl;
+			std::cerr << "Failed to load the image. Cannot display." << std::endl;
 		}
 	}
 
-	GLuint ImageProcessor::GetTexture(const std::string& imagePath)
-	{
-		cv::Mat inputImage = cv::imread(imagePath);
-
-		if (inputImage.empty()) {
-			std::cout << "Failed to load the image at path: " << imagePath << std::endl;
-			return 0;
-		}
-
-		// Resize the image to fit the dimensions of the viewport
-		cv::resize(inputImage, inputImage, cv::Size(500, 500));
-
-		// Convert the processed image to an OpenGL texture
-		GLuint textureID;
-		glGenTextures(1, &textureID);
-		glBindTexture(GL_TEXTURE_2D, textureID);
-
-		if (inputImage.channels() == 1) {
-			// Grayscale image
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, inputImage.cols, inputImage.rows, 0, GL_RED, GL_UNSIGNED_BYTE, inputImage.data);
-		}
-		else if (inputImage.channels() == 3) {
-			// Color image (BGR)
-			cv::cvtColor(inputImage, inputImage, cv::COLOR_BGR2RGB);
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, inputImage.cols, inputImage.rows, 0, GL_RGB, GL_UNSIGNED_BYTE, inputImage.data);
-		}
-		else if (inputImage.channels() == 4) {
-			// Color image with alpha (BGRA)
-			cv::cvtColor(inputImage, inputImage, cv::COLOR_BGRA2RGBA);
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, inputImage.cols, inputImage.rows, 0, GL_RGBA, GL_UNSIGNED_BYTE, inputImage.data);
-		}
-
-		// Texture parameters
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-		glBindTexture(GL_TEXTURE_2D, 0); // Unbind the texture
-
-		return textureID;
-	}
-
 	ImageDetails ImageProcessor::GetImageDetails(const std::string& imagePath) {
-		ImageDetails details;
-		cv::Mat inputImage = cv::imread(imagePath);
-
-		if (inputImage.empty()) {
-			std::cout << "Failed to load the image at path: " << imagePath << std::endl;
-			return details;
-		}
-
-		if (inputImage.channels() == 1) {
-			details.type = "Grayscale";
-		}
-		else if (inputImage.channels() == 3 && inputImage.type() == CV_8UC3) {
-			cv::Mat channels[3];
-			cv::split(inputImage, channels);
-
-			// Check if all three channels are identical
-			if (cv::countNonZero(channels[0] != channels[1]) == 0 &&
-				cv::countNonZero(channels[0] != channels[2]) == 0) {
-				details.type = "Grayscale";
-			}
-			else {
-				details.type = "RGB";
-			}
-		}
-		else {
-			details.type = "Unknown";
-		}
+		// Dimensions come from the file header, the pixels are only decoded to tell a color layout from gray content
+		ImageDetails details = ImageProbe::GetDetails(imagePath, LoadImage);
 
-		// Image size
-		details.width = inputImage.cols;
-		details.height = inputImage.rows;
+		if (details.type.empty())
+			std::cerr << "Failed to load the image at path: " << imagePath << std::endl;
 
 		return details;
 	}
 
 	cv::Mat ImageProcessor::ResizeImage(const std::string& imagePath, int width, int height) {
 
-		cv::Mat inputImage = cv::imread(imagePath);
+		SharedImage inputImage = LoadImage(imagePath);
 
-		if (!inputImage.empty()) {
+		if (inputImage) {
 			cv::Mat resizedImage;
-			cv::resize(inputImage, resizedImage, cv::Size(width, height));
+			cv::resize(*inputImage, resizedImage, cv::Size(width, height));
 			return resizedImage;
 		}
 		else {
-			std::cout << "Failed to load the image!" << std::endl;
+			std::cerr << "Failed to load the image!" << std::endl;
 			return cv::Mat();
 		}
 	}
 
-	void ImageProcessor::ConvertGIFToJPEG(const std::string& gifImagePath)
+	bool ImageProcessor::ConvertGIFToIntermediate(const std::string& gifImagePath, std::string& error)
 	{
-		FreeImage_Initialise();
-
-		// Loading the GIF image using FreeImage
-		FIBITMAP* gifImage = FreeImage_Load(FIF_GIF, gifImagePath.c_str(), GIF_DEFAULT);
-
-		if (gifImage) {
-
-			// Convert the GIF image to grayscale if it has multiple channels
-			FIBITMAP* grayscaleImage = FreeImage_ConvertToGreyscale(gifImage);
-
-			if (grayscaleImage) {
-				fs::path gifDirectory = fs::path(gifImagePath).parent_path();
-
-				std::string filenameWithoutExtension = fs::path(gifImagePath).stem().string();
-
-				// Create a "pre-processing" directory
-				fs::path outputDirectory = gifDirectory / "pre-processing"; m_PreprocessingDir = outputDirectory.string();
-				if (fs::create_directory(outputDirectory) || fs::exists(outputDirectory)) {
-
-					// Save as JPEG in the "pre-processing" directory with the original filename
-					fs::path jpegPath = outputDirectory / (filenameWithoutExtension + ".jpg");
-					FreeImage_Save(FIF_JPEG, grayscaleImage, jpegPath.string().c_str(), JPEG_DEFAULT);
-				}
-				else {
-					std::cerr << "Failed to create the 'pre-processing' directory." << std::endl;
-				}
-
-				FreeImage_Unload(gifImage);
-				FreeImage_Unload(grayscaleImage);
-			}
-			else {
-				std::cerr << "Failed to convert the GIF image to grayscale." << std::endl;
-			}
+		cv::Mat image;
+		if (!GifDecoder::Decode(gifImagePath, image, error))
+			return false;
+
+		// Save in the intermediate format in the "pre-processing" directory with the original filename
+		fs::path outputDirectory = GetPreprocessingDirectory(fs::path(gifImagePath).parent_path().string());
+		// Single conversions have no batch to create it first. Parallel calls may race here, an existing directory is fine.
+		std::error_code directoryError;
+		fs::create_directory(outputDirectory, directoryError);
+		if (directoryError) {
+			error = "Failed to create " + outputDirectory.string() + ": " + directoryError.message();
+			return false;
 		}
-		else {
-			std::cerr << "Failed to load the GIF image at path: " << gifImagePath << std::endl;
+
+		fs::path outputPath = outputDirectory / (fs::path(gifImagePath).stem().string() + m_IntermediateExtension);
+		if (!WriteImage(outputPath.string(), image)) {
+			error = "Failed to write " + outputPath.string();
+			return false;
 		}
 
-		FreeImage_DeInitialise();
+		return true;
 	}
 
-	void ImageProcessor::ConvertAllGIFsToJPEGs(const std::string& directoryPath)
+	void ImageProcessor::ConvertGIFToIntermediate(const std::string& gifImagePath)
 	{
-		std::string DirectoryPath = fs::path(directoryPath).parent_path().string();
-
-		if (fs::exists(DirectoryPath) && fs::is_directory(DirectoryPath)) {
-			std::cout << "Directory found: " << DirectoryPath << std::endl;
-
-			for (const auto& entry : fs::directory_iterator(DirectoryPath)) {
-				if (entry.is_regular_file()) {
-					std::string currentFilePath = entry.path().string();
-
-					if (fs::path(currentFilePath).extension() == ".gif") {
-						ConvertGIFToJPEG(currentFilePath);
-					}
-				}
-			}
-		}
-		else {
-			std::cerr << "The specified directory does not exist or is not a directory." << std::endl;
-		}
+		std::string error;
+		if (!ConvertGIFToIntermediate(gifImagePath, error))
+			std::cerr << error << ": " << gifImagePath << std::endl;
 	}
 
-	GLuint ImageProcessor::VisualizeImage(const std::string& imagePath, bool drawContours)
+	BatchReport ImageProcessor::ConvertAllGIFs(const std::string& directoryPath)
 	{
-		cv::Mat image = cv::imread(imagePath);
-
-		if (image.empty())
-		{
-			std::cerr << "Failed to load the image at path: " << imagePath << std::endl;
-			return 0;
-		}
-
-		if (drawContours) {
-			cv::Mat gray;
-			cv::cvtColor(image, gray, cv::COLOR_BGR2GRAY);
-
-			// Apply threshold to create a binary image
-			cv::Mat thresh;
-			cv::threshold(gray, thresh, 128, 255, cv::THRESH_BINARY);
-
-			// Find contours in the binary image
-			std::vector<std::vector<cv::Point>> contours;
-			cv::findContours(thresh, contours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE);
+		std::string DirectoryPath = fs::path(directoryPath).parent_path().string();
 
-			// Draw contours on the original image
-			cv::drawContours(image, contours, -1, cv::Scalar(0, 255, 0), 2);
+		if (!fs::exists(DirectoryPath) || !fs::is_directory(DirectoryPath)) {
+			std::cerr << "The specified directory does not exist or is not a directory." << std::endl;
+			return BatchReport();
 		}
 
-		cv::resize(image, image, cv::Size(500, 500));
-
-		// Convert the processed image to an OpenGL texture
-		GLuint textureID;
-		glGenTextures(1, &textureID);
-		glBindTexture(GL_TEXTURE_2D, textureID);
+		std::cerr << "Directory found: " << DirectoryPath << std::endl;
 
-		if (image.channels() == 1) {
-			// Grayscale image
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, image.cols, image.rows, 0, GL_RED, GL_UNSIGNED_BYTE, image.data);
-		}
-		else if (image.channels() == 3) {
-			// Color image (BGR)
-			cv::cvtColor(image, image, cv::COLOR_BGR2RGB);
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, image.cols, image.rows, 0, GL_RGB, GL_UNSIGNED_BYTE, image.data);
-		}
-		else if (image.channels() == 4) {
-			// Color image with alpha (BGRA)
-			cv::cvtColor(image, image, cv::COLOR_BGRA2RGBA);
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, image.cols, image.rows, 0, GL_RGBA, GL_UNSIGNED_BYTE, image.data);
+		// Create a "pre-processing" directory, once for the whole dataset
+		fs::path outputDirectory = GetPreprocessingDirectory(DirectoryPath);
+		if (!fs::create_directory(outputDirectory) && !fs::exists(outputDirectory)) {
+			std::cerr << "Failed to create the 'pre-processing' directory." << std::endl;
+			return BatchReport();
 		}
+		m_PreprocessingDir = outputDirectory.string();
 
-		// Texture parameters
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		std::vector<std::string> gifFiles = CollectFiles(DirectoryPath, GifDecoder::Extension);
 
-		glBindTexture(GL_TEXTURE_2D, 0);
+		BatchExecutor executor(m_WorkerCount);
+		return executor.Run(gifFiles, [](size_t, const std::string& path, std::string& error) {
+			return ConvertGIFToIntermediate(path, error);
+			}, m_Progress);
+	}
 
-		return textureID;
+	std::string ImageProcessor::GetPreprocessingDirectory(const std::string& gifDirectoryPath)
+	{
+		return (fs::path(gifDirectoryPath) / "pre-processing").string();
 	}
 
 	void ImageProcessor::ApplyNoiseRemoval(cv::Mat& image)
 	{
+		SS_PROFILE_SCOPE("noise_removal");
+
 		// GaussianBlur for noise removal
 		cv::GaussianBlur(image, image, cv::Size(5, 5), 0);
 	}
 
-	void ImageProcessor::ApplyNoiseRemovalToDirectory(const std::string& directoryPath)
+	BatchReport ImageProcessor::ApplyNoiseRemovalToDirectory(const std::string& directoryPath)
 	{
 		// Create a "noiseremoval" directory inside the original directory
 		fs::path outputDirectory = fs::path(directoryPath) / "noiseremoval";
@@ -258,45 +161,26 @@ namespace SyncShapes
 		{
 			// Log an error if the directory creation fails
 			std::cerr << "Failed to create 'noiseremoval' directory in: " << directoryPath << std::endl;
-			return;
+			return BatchReport();
 		}
 
-		for (const auto& entry : fs::directory_iterator(directoryPath))
-		{
-			// Check if the file is a JPEG image
-			if (entry.is_regular_file() && entry.path().extension() == ".jpg")
-			{
-				// Load the image
-				cv::Mat image = cv::imread(entry.path().string());
-
-				if (!image.empty())
-				{
-					// Apply noise removal
-					ApplyNoiseRemoval(image);
-
-					// Save the modified image to the "noiseremoval" folder
-					fs::path outputPath = outputDirectory / entry.path().filename();
-					cv::imwrite(outputPath.string(), image);
-				}
-			}
-		}
+		return ApplyToDirectory(directoryPath, outputDirectory, ApplyNoiseRemoval);
 	}
 
 	void ImageProcessor::ApplyHoleFilling(cv::Mat& image)
 	{
-		cv::Mat grayscaleImage;
-		cv::cvtColor(image, grayscaleImage, cv::COLOR_BGR2GRAY);
+		SS_PROFILE_SCOPE("hole_filling");
 
-		cv::Mat binaryMask;
-		cv::threshold(grayscaleImage, binaryMask, 1, 255, cv::THRESH_BINARY);
+		ExtractionScratch& scratch = ExtractionScratch::Get();
 
-		std::vector<std::vector<cv::Point>> contours;
-		cv::findContours(binaryMask, contours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE);
+		// Mask intermediates decode to a single channel, JPEGs to BGR
+		cv::threshold(scratch.ToGray(image), scratch.thresh, 1, 255, cv::THRESH_BINARY);
+		cv::findContours(scratch.thresh, scratch.contours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE);
 
-		cv::drawContours(image, contours, -1, cv::Scalar(255, 255, 255), cv::FILLED);
+		cv::drawContours(image, scratch.contours, -1, cv::Scalar(255, 255, 255), cv::FILLED);
 	}
 
-	void ImageProcessor::ApplyHoleFillingToDirectory(const std::string& directoryPath) {
+	BatchReport ImageProcessor::ApplyHoleFillingToDirectory(const std::string& directoryPath) {
 		fs::path outputDirectory = fs::path(directoryPath) / "holefilling";
 
 		if (!(fs::exists(outputDirectory) && fs::is_directory(outputDirectory))) {
@@ -304,27 +188,18 @@ namespace SyncShapes
 			fs::create_directory(outputDirectory);
 		}
 
-		for (const auto& entry : fs::directory_iterator(directoryPath)) {
-			if (entry.is_regular_file() && entry.path().extension() == ".jpg") {
-				cv::Mat image = cv::imread(entry.path().string());
-
-				if (!image.empty()) {
-					ApplyHoleFilling(image);
-
-					// Save the modified image in the "holefilling" directory
-					fs::path outputPath = outputDirectory / entry.path().filename();
-					cv::imwrite(outputPath.string(), image);
-				}
-			}
-		}
+		return ApplyToDirectory(directoryPath, outputDirectory, ApplyHoleFilling);
 	}
 
 	void ImageProcessor::ApplyHistogramEqualization(cv::Mat& image) {
-		cv::cvtColor(image, image, cv::COLOR_BGR2GRAY);
+		SS_PROFILE_SCOPE("histogram_equalization");
+
+		if (image.channels() != 1)
+			cv::cvtColor(image, image, cv::COLOR_BGR2GRAY);
 		cv::equalizeHist(image, image);
 	}
 
-	void ImageProcessor::ApplyHistogramEqualizationToDirectory(const std::string& directoryPath) {
+	BatchReport ImageProcessor::ApplyHistogramEqualizationToDirectory(const std::string& directoryPath) {
 		fs::path outputDirectory = fs::path(directoryPath) / "histogramequalization";
 
 		if (!(fs::exists(outputDirectory) && fs::is_directory(outputDirectory))) {
@@ -332,27 +207,17 @@ namespace SyncShapes
 			fs::create_directory(outputDirectory);
 		}
 
-		for (const auto& entry : fs::directory_iterator(directoryPath)) {
-			if (entry.is_regular_file() && entry.path().extension() == ".jpg") {
-				cv::Mat image = cv::imread(entry.path().string());
-
-				if (!image.empty()) {
-					ApplyHistogramEqualization(image);
-
-					// Save the modified image in the "histogramequalization" directory
-					fs::path outputPath = outputDirectory / entry.path().filename();
-					cv::imwrite(outputPath.string(), image);
-				}
-			}
-		}
+		return ApplyToDirectory(directoryPath, outputDirectory, ApplyHistogramEqualization);
 	}
 
 	void ImageProcessor::ApplyContourAreaFiltering(cv::Mat& inputImage, double minContourArea) {
-		cv::Mat thresh;
-		cv::threshold(inputImage, thresh, 128, 255, cv::THRESH_BINARY);
+		SS_PROFILE_SCOPE("contour_area_filtering");
 
-		std::vector<std::vector<cv::Point>> contours;
-		cv::findContours(thresh, contours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE);
+		ExtractionScratch& scratch = ExtractionScratch::Get();
+		cv::threshold(scratch.ToGray(inputImage), scratch.thresh, 128, 255, cv::THRESH_BINARY);
+		cv::findContours(scratch.thresh, scratch.contours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE);
+
+		const std::vector<std::vector<cv::Point>>& contours = scratch.contours;
 
 		for (size_t i = 0; i < contours.size(); ++i) {
 			double contourArea = cv::contourArea(contours[i]);
@@ -365,7 +230,7 @@ namespace SyncShapes
 		}
 	}
 
-	void ImageProcessor::ApplyContourAreaFilteringToDirectory(const std::string& directoryPath, double minContourArea) {
+	BatchReport ImageProcessor::ApplyContourAreaFilteringToDirectory(const std::string& directoryPath, double minContourArea) {
 		fs::path outputDirectory = fs::path(directoryPath) / "contour_area_filtering";
 
 		if (!(fs::exists(outputDirectory) && fs::is_directory(outputDirectory))) {
@@ -373,218 +238,1069 @@ namespace SyncShapes
 			fs::create_directory(outputDirectory);
 		}
 
-		for (const auto& entry : fs::directory_iterator(directoryPath)) {
-			if (entry.is_regular_file() && entry.path().extension() == ".jpg") {
-				cv::Mat image = cv::imread(entry.path().string());
+		return ApplyToDirectory(directoryPath, outputDirectory, [minContourArea](cv::Mat& image) {
+			// Apply contour area filtering directly to the image
+			ApplyContourAreaFiltering(image, minContourArea);
+			});
+	}
 
-				if (!image.empty()) {
-					// Apply contour area filtering directly to the image
-					ApplyContourAreaFiltering(image, minContourArea);
+	BatchReport ImageProcessor::ApplyAllToDirectory(const std::string& directoryPath)
+	{
+		// The images are overwritten in place
+		return ApplyToDirectory(directoryPath, fs::path(directoryPath), [](cv::Mat& image) {
+			// Apply preprocessing steps
+			ApplyNoiseRemoval(image);
+			ApplyHoleFilling(image);
+			ApplyHistogramEqualization(image);
+			ApplyContourAreaFiltering(image, 300);
+			});
+	}
 
-					// Save the modified image in the "contour_area_filtering" directory
-					fs::path outputPath = outputDirectory / entry.path().filename();
-					cv::imwrite(outputPath.string(), image);
-				}
-			}
+	void ImageProcessor::ExtractShapeFeatures(const std::string& imagePath)
+	{
+		SharedImage image = LoadImage(imagePath);
+
+		if (!image) {
+			std::cerr << "Failed to load the image at path: " << imagePath << std::endl;
+			return;
 		}
+
+		ExtractShapeFeatures(*image, m_AllFeatures[imagePath]);
 	}
 
-	void ImageProcessor::ApplyAllToDirectory(const std::string& directoryPath)
+	void ImageProcessor::ExtractShapeFeatures(const cv::Mat& image, FeatureData& featureData)
 	{
-		for (const auto& entry : fs::directory_iterator(directoryPath))
+		ExtractionScratch& scratch = ExtractionScratch::Get();
+		{
+			SS_PROFILE_SCOPE("threshold");
+			cv::threshold(scratch.ToGray(image), scratch.thresh, 128, 255, cv::THRESH_BINARY);
+		}
+
+		{
+			SS_PROFILE_SCOPE("find_contours");
+			cv::findContours(scratch.thresh, scratch.contours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE);
+		}
+
+		ComputeHuFeatures(scratch.contours, featureData.shapeFeatures);
+		ComputeShapeDescriptor(scratch.contours, image.size(), featureData.descriptor);
+		featureData.numShapes = static_cast<int>(featureData.shapeFeatures.size());
+	}
+
+	void ImageProcessor::ComputeHuFeatures(const std::vector<std::vector<cv::Point>>& contours, std::vector<std::vector<double>>& shapeFeatures)
+	{
+		SS_PROFILE_SCOPE("hu_moments");
+
+		shapeFeatures.resize(contours.size());
+		for (size_t i = 0; i < contours.size(); ++i)
 		{
-			if (entry.is_regular_file() && entry.path().extension() == ".jpg")
+			cv::Moments moments = cv::moments(contours[i], false);  // Use binary image
+			double huMoments[7];
+			cv::HuMoments(moments, huMoments);
+
+			std::vector<double>& featureVector = shapeFeatures[i];
+			featureVector.assign(std::begin(huMoments), std::end(huMoments));
+
+			// Normalize the Hu moments
+			for (double& moment : featureVector)
 			{
-				// Load the original image
-				cv::Mat originalImage = cv::imread(entry.path().string());
+				moment = -std::copysign(1.0, moment) * std::log10(std::abs(moment));
+			}
+		}
+	}
 
-				if (!originalImage.empty())
-				{
-					// Apply preprocessing steps
-					ApplyNoiseRemoval(originalImage);
-					ApplyHoleFilling(originalImage);
-					ApplyHistogramEqualization(originalImage);
-					ApplyContourAreaFiltering(originalImage, 300);
+	void ImageProcessor::ComputeShapeDescriptor(const std::vector<std::vector<cv::Point>>& contours, const cv::Size& imageSize, ShapeDescriptor& descriptor)
+	{
+		SS_PROFILE_SCOPE("shape_descriptor");
 
-					cv::imwrite(entry.path().string(), originalImage);
-				}
+		descriptor = ShapeDescriptor();
+		descriptor.contourCount = static_cast<double>(contours.size());
+		if (contours.empty() || imageSize.area() <= 0)
+			return;
+
+		double area = 0.0;
+		double hullArea = 0.0;
+		double largestArea = 0.0;
+		double largestPerimeter = 0.0;
+		cv::Rect bounds;
+		std::vector<cv::Point>& hull = ExtractionScratch::Get().hull;
+
+		for (const auto& contour : contours) {
+			double contourArea = cv::contourArea(contour);
+			area += contourArea;
+
+			cv::convexHull(contour, hull);
+			hullArea += cv::contourArea(hull);
+
+			cv::Rect contourBounds = cv::boundingRect(contour);
+			bounds = bounds.empty() ? contourBounds : (bounds | contourBounds);
+
+			if (contourArea > largestArea) {
+				largestArea = contourArea;
+				largestPerimeter = cv::arcLength(contour, true);
 			}
 		}
+
+		descriptor.areaFraction = area / static_cast<double>(imageSize.area());
+		if (!bounds.empty())
+			descriptor.aspectRatio = static_cast<double>(std::min(bounds.width, bounds.height)) / std::max(bounds.width, bounds.height);
+		if (hullArea > 0.0)
+			descriptor.solidity = area / hullArea;
+		if (largestArea > 0.0)
+			descriptor.compactness = largestPerimeter * largestPerimeter / (4.0 * CV_PI * largestArea);
 	}
 
-	void ImageProcessor::ExtractShapeFeatures(const std::string& imagePath)
+	FeatureUpdateReport ImageProcessor::ExtractShapeFeaturesAndSave(const std::string& directoryPath)
 	{
-		cv::Mat image = cv::imread(imagePath);
-		cv::Mat gray;
-		cv::cvtColor(image, gray, cv::COLOR_BGR2GRAY);
+		return UpdateFeatureStore(directoryPath, CollectFiles(directoryPath, FindIntermediateExtension(directoryPath)), "extract", [](const std::string& imagePath, const std::vector<uint8_t>& bytes, FeatureData& featureData, std::string& error) {
+			// A pre-processing pass may have left the image decoded, otherwise decode the bytes without filling the cache
+			SharedImage cached = m_ImageCache.Find(imagePath);
+			cv::Mat& decoded = ExtractionScratch::Get().image;
+			if (!cached && !DecodeImage(imagePath, bytes, decoded)) {
+				error = "Failed to load the image";
+				return false;
+			}
 
-		cv::Mat thresh;
-		cv::threshold(gray, thresh, 128, 255, cv::THRESH_BINARY);
+			ExtractShapeFeatures(cached ? *cached : decoded, featureData);
+			return true;
+			});
+	}
 
-		std::vector<std::vector<cv::Point>> contours;
-		cv::findContours(thresh, contours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE);
+	FeatureUpdateReport ImageProcessor::IngestDirectory(const std::string& directoryPath, const IngestOptions& options)
+	{
+		fs::path intermediateDirectory = fs::path(directoryPath) / "preprocessed";
+		if (options.writeIntermediates) {
+			fs::create_directory(intermediateDirectory);
+		}
 
-		for (const auto& contour : contours)
-		{
-			cv::Moments moments = cv::moments(contour, false);  // Use binary image
-			cv::Mat huMomentsMat;
-			cv::HuMoments(moments, huMomentsMat);
+		std::string pipeline = "ingest " + GetPipelineSteps(options);
 
-			std::vector<double> huMoments;
-			huMomentsMat.col(0).rowRange(0, 7).copyTo(huMoments);
+		return UpdateFeatureStore(directoryPath, CollectFiles(directoryPath, FindIntermediateExtension(directoryPath)), pipeline, [&options, &intermediateDirectory](const std::string& imagePath, const std::vector<uint8_t>& bytes, FeatureData& featureData, std::string& error) {
+			cv::Mat& image = ExtractionScratch::Get().image;
+			if (!DecodeImage(imagePath, bytes, image)) {
+				error = "Failed to load the image";
+				return false;
+			}
 
-			// Normalize the Hu moments
-			for (double& moment : huMoments)
-			{
-				moment = -std::copysign(1.0, moment) * std::log10(std::abs(moment));
+			PreprocessAndExtract(image, options, featureData);
+
+			if (options.writeIntermediates) {
+				fs::path outputPath = intermediateDirectory / (fs::path(imagePath).stem().string() + m_IntermediateExtension);
+				if (!WriteImage(outputPath.string(), image)) {
+					error = "Failed to write " + outputPath.string();
+					return false;
+				}
 			}
 
-			m_AllFeatures[imagePath].numShapes = contours.size();
-			m_AllFeatures[imagePath].shapeFeatures.push_back(std::move(huMoments));
+			return true;
+			});
+	}
+
+	FeatureUpdateReport ImageProcessor::IngestGIFDirectory(const std::string& gifDirectoryPath, const IngestOptions& options, bool writeConverted)
+	{
+		// Same layout as converting first: the index and any written images live in the pre-processing directory
+		fs::path outputDirectory = GetPreprocessingDirectory(gifDirectoryPath);
+		fs::path intermediateDirectory = outputDirectory / "preprocessed";
+		if (!fs::create_directory(outputDirectory) && !fs::exists(outputDirectory)) {
+			std::cerr << "Failed to create the 'pre-processing' directory." << std::endl;
+			return FeatureUpdateReport();
+		}
+		if (options.writeIntermediates) {
+			fs::create_directory(intermediateDirectory);
 		}
+		m_PreprocessingDir = outputDirectory.string();
+
+		// The manifest fingerprints the GIFs themselves, unchanged ones are not even decoded
+		std::string pipeline = "gif " + GetPipelineSteps(options);
+
+		return UpdateFeatureStore(m_PreprocessingDir, CollectFiles(gifDirectoryPath, GifDecoder::Extension), pipeline,
+			[&options, &outputDirectory, &intermediateDirectory, writeConverted](const std::string& gifImagePath, const std::vector<uint8_t>& bytes, FeatureData& featureData, std::string& error) {
+			cv::Mat& image = ExtractionScratch::Get().image;
+			if (!GifDecoder::Decode(bytes.data(), bytes.size(), image, error))
+				return false;
+
+			std::string fileName = fs::path(gifImagePath).stem().string() + m_IntermediateExtension;
+
+			// The converted image, before pre-processing changes it in place
+			if (writeConverted && !WriteImage((outputDirectory / fileName).string(), image)) {
+				error = "Failed to write " + (outputDirectory / fileName).string();
+				return false;
+			}
+
+			PreprocessAndExtract(image, options, featureData);
+
+			if (options.writeIntermediates && !WriteImage((intermediateDirectory / fileName).string(), image)) {
+				error = "Failed to write " + (intermediateDirectory / fileName).string();
+				return false;
+			}
+
+			return true;
+			});
 	}
 
-	void ImageProcessor::ExtractShapeFeaturesAndSave(const std::string& directoryPath)
+	std::string ImageProcessor::GetPipelineSteps(const IngestOptions& options)
 	{
-		// Clear existing features
-		m_AllFeatures.clear();
+		// Features depend on the selected steps, a different selection must not reuse them
+		return std::string(options.noiseRemoval ? "n" : "-") + (options.holeFilling ? "h" : "-")
+			+ (options.histogramEqualization ? "e" : "-") + (options.contourAreaFiltering ? "a" + std::to_string(options.minContourArea) : "-");
+	}
 
-		for (const auto& entry : fs::directory_iterator(directoryPath)) {
-			if (entry.is_regular_file() && entry.path().extension() == ".jpg") {
-				std::string imageName = entry.path().filename().stem().string();
-				std::string imagePath = entry.path().string();
+	void ImageProcessor::PreprocessAndExtract(cv::Mat& image, const IngestOptions& options, FeatureData& featureData)
+	{
+		if (options.noiseRemoval)
+			ApplyNoiseRemoval(image);
+		if (options.holeFilling)
+			ApplyHoleFilling(image);
+		if (options.histogramEqualization)
+			ApplyHistogramEqualization(image);
+
+		// One threshold and contour pass serves both the area filter and the Hu moments,
+		// the filtered image would yield exactly the contours that pass the filter
+		ExtractionScratch& scratch = ExtractionScratch::Get();
+		{
+			SS_PROFILE_SCOPE("threshold");
+			cv::threshold(scratch.ToGray(image), scratch.thresh, 128, 255, cv::THRESH_BINARY);
+		}
 
-				ExtractShapeFeatures(imagePath);
+		std::vector<std::vector<cv::Point>>& contours = scratch.contours;
+		{
+			SS_PROFILE_SCOPE("find_contours");
+			cv::findContours(scratch.thresh, contours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE);
+		}
 
-				// Save features in m_AllFeatures with the image name
-				m_AllFeatures[imageName] = std::move(m_AllFeatures[imagePath]);
-				m_AllFeatures.erase(imagePath);
+		if (options.contourAreaFiltering) {
+			// Kept contours are swapped to the front in their order, no copies
+			size_t keptCount = 0;
+			for (size_t i = 0; i < contours.size(); ++i) {
+				if (cv::contourArea(contours[i]) >= options.minContourArea) {
+					std::swap(contours[keptCount++], contours[i]);
+				}
+				else if (options.writeIntermediates) {
+					// Only needed when the filtered image itself is written out
+					cv::drawContours(image, contours, static_cast<int>(i), cv::Scalar(0, 0, 0), cv::FILLED);
+				}
 			}
+
+			contours.resize(keptCount);
 		}
 
+		ComputeHuFeatures(contours, featureData.shapeFeatures);
+		ComputeShapeDescriptor(contours, image.size(), featureData.descriptor);
+		featureData.numShapes = static_cast<int>(featureData.shapeFeatures.size());
+	}
+
+	FeatureUpdateReport ImageProcessor::UpdateFeatureStore(const std::string& directoryPath, const std::vector<std::string>& files, const std::string& pipeline, const FeatureExtractor& extractor)
+	{
+		// Per-file state of the walk, small enough to keep for the whole directory
+		struct FileState
+		{
+			std::string name;
+			ManifestEntry fingerprint;
+			size_t previousImage = FeatureStore::NotFound;
+		};
+
+		// An image on its way from the reader to the writer, its bytes and features are released once it is written
+		struct StreamItem
+		{
+			size_t index = 0;
+			size_t position = 0; // In 'candidates', the order the writer stores them in
+			std::vector<uint8_t> bytes;
+			uint64_t contentHash = 0;
+			bool reuse = false;
+			std::string error;
+			std::vector<double> records; // FeatureStore::Stride values per contour, as the writer stores them
+			ShapeDescriptor descriptor;
+		};
+
+		FeatureUpdateReport report;
+
 		// Save features to a file in a subdirectory named "feature-extraction"
 		fs::path directory(directoryPath);
 		fs::path subdirectory = directory / "feature-extraction";
 		fs::create_directory(subdirectory); m_FeatureExtractionDir = subdirectory.string();
 
 		std::string outputFileName = (subdirectory / "output_features.dat").string();
-		SaveFeaturesToFile(outputFileName, m_AllFeatures);
+		std::string manifestFileName = (subdirectory / "manifest.txt").string();
+
+		// An empty file list next to a populated index is a wrong directory or format far more often than an emptied dataset
+		if (files.empty()) {
+			FeatureStore existingStore;
+			if (fs::exists(outputFileName) && existingStore.Open(outputFileName) && existingStore.GetImageCount() > 0) {
+				std::cerr << "No images to index in " << directoryPath << ", keeping the existing index of " << existingStore.GetImageCount() << " images" << std::endl;
+				return report;
+			}
+		}
+
+		// The previous index may still be mapped, release it before it gets replaced. It is loaded again if the update fails.
+		std::string loadedStore = m_FeatureStore.GetPath();
+		m_FeatureMatrix.Clear();
+		m_CompressedFeatures.Clear();
+		m_FeatureStore.Close();
+		m_AllFeatures.clear();
+		bool shardClosed = m_Datasets.CloseStore(outputFileName);
+
+		// Features of unchanged images are copied over from the previous index, only valid together with its manifest.
+		// An index from before shape descriptors has nothing to copy them from and is rebuilt once.
+		FeatureStore previousStore;
+		FeatureManifest manifest;
+		bool hasPrevious = fs::exists(outputFileName) && fs::exists(manifestFileName)
+			&& previousStore.Open(outputFileName) && previousStore.HasDescriptors() && manifest.Load(manifestFileName) && manifest.GetPipeline() == pipeline;
+		if (!hasPrevious) {
+			previousStore.Close();
+			manifest.Clear();
+		}
+
+		report.batch.total = files.size();
+		if (m_Progress)
+			m_Progress->total.fetch_add(files.size());
+
+		auto completeFiles = [](size_t count) {
+			if (m_Progress)
+				m_Progress->completed.fetch_add(count, std::memory_order_relaxed);
+		};
+
+		// Walk: stat every file, only those whose size or mtime changed are read at all
+		std::vector<FileState> states(files.size());
+		std::vector<size_t> unchanged;
+		std::vector<size_t> candidates;
+		for (size_t index = 0; index < files.size(); ++index) {
+			FileState& state = states[index];
+			fs::path filePath(files[index]);
+			state.name = filePath.stem().string();
+
+			std::error_code statError;
+			state.fingerprint.size = static_cast<uint64_t>(fs::file_size(filePath, statError));
+			if (!statError)
+				state.fingerprint.modifiedTime = static_cast<int64_t>(fs::last_write_time(filePath, statError).time_since_epoch().count());
+			if (statError) {
+				report.batch.failures.push_back({ files[index], "Failed to stat the image: " + statError.message() });
+				completeFiles(1);
+				continue;
+			}
+
+			const ManifestEntry* known = manifest.Find(filePath.filename().string());
+			if (known)
+				state.previousImage = previousStore.FindImage(state.name);
+
+			// Size and mtime unchanged: trust the manifest without reading the file
+			if (known && state.previousImage != FeatureStore::NotFound && known->size == state.fingerprint.size && known->modifiedTime == state.fingerprint.modifiedTime) {
+				state.fingerprint.contentHash = known->contentHash;
+				unchanged.push_back(index);
+			}
+			else {
+				candidates.push_back(index);
+			}
+		}
+
+		FeatureManifest updatedManifest;
+		updatedManifest.SetPipeline(pipeline);
+		FeatureStoreWriter writer;
+		bool written = writer.Begin(outputFileName);
+
+		// Images of the previous index that are in the new one, the rest count as removed
+		size_t carriedOver = 0;
+
+		auto copyPrevious = [&](size_t index) {
+			const FileState& state = states[index];
+			size_t contourBegin = previousStore.GetContourBegin(state.previousImage);
+			size_t contourCount = previousStore.GetContourEnd(state.previousImage) - contourBegin;
+			bool copied = writer.AddImage(state.name, previousStore.GetContour(contourBegin), contourCount, previousStore.GetDescriptors()[state.previousImage]);
+			carriedOver += copied ? 1 : 0;
+			return copied;
+		};
+
+		// An image that was not indexed this time keeps its old features and manifest entry, the next update checks it again
+		auto keepPrevious = [&](size_t index) {
+			if (!written || states[index].previousImage == FeatureStore::NotFound)
+				return;
+
+			written = copyPrevious(index);
+			std::string fileName = fs::path(files[index]).filename().string();
+			if (written)
+				updatedManifest.Set(fileName, *manifest.Find(fileName));
+		};
+
+		// Unchanged images are a sequential copy from the previous index, written first and in their previous order,
+		// so an index that only grew keeps its contour ids. The copies are cheap, a cancelled run keeps all of them.
+		std::sort(unchanged.begin(), unchanged.end(), [&states](size_t a, size_t b) { return states[a].previousImage < states[b].previousImage; });
+		for (size_t index : unchanged) {
+			written = written && copyPrevious(index);
+			if (!written)
+				break;
+
+			updatedManifest.Set(fs::path(files[index]).filename().string(), states[index].fingerprint);
+			++report.reused;
+			++report.batch.succeeded;
+			completeFiles(1);
+		}
+
+		// Everything else streams through reader -> workers -> writer. The queue depths bound the images in flight,
+		// so peak memory stays the same whatever the size of the dataset.
+		unsigned int workerCount = BatchExecutor::ResolveWorkerCount(m_WorkerCount);
+		BoundedQueue<StreamItem> readQueue(2 * static_cast<size_t>(workerCount));
+		BoundedQueue<StreamItem> resultQueue(2 * static_cast<size_t>(workerCount));
+		std::atomic<bool> stopReading(!written);
+		std::atomic<unsigned int> runningWorkers(workerCount);
+
+		// Written record buffers go back to the workers, so the stream stops allocating them once every item in flight has one
+		std::mutex recordPoolMutex;
+		std::vector<std::vector<double>> recordPool;
+
+		std::vector<std::string> candidatePaths;
+		candidatePaths.reserve(candidates.size());
+		for (size_t index : candidates)
+			candidatePaths.push_back(files[index]);
+
+		// Results are written in candidate order whatever order the workers finish in, so the same dataset always
+		// gives the same index. The reader stays within a window of the writer, which bounds the reorder buffer.
+		size_t reorderWindow = 4 * static_cast<size_t>(workerCount);
+		std::mutex windowMutex;
+		std::condition_variable windowAdvanced;
+		size_t nextPosition = 0;
+
+		std::thread reader([&] {
+			FilePrefetcher prefetcher(candidatePaths, m_PrefetchDepth);
+			for (size_t position = 0; position < candidates.size(); ++position) {
+				{
+					std::unique_lock<std::mutex> lock(windowMutex);
+					windowAdvanced.wait(lock, [&] { return position < nextPosition + reorderWindow; });
+				}
+				if (stopReading || (m_Progress && m_Progress->IsCancelled()))
+					break;
+
+				StreamItem item;
+				item.index = candidates[position];
+				item.position = position;
+				if (!prefetcher.Read(position, item.bytes))
+					item.error = "Failed to read the image";
+
+				readQueue.Push(std::move(item));
+			}
+
+			readQueue.Close();
+			});
+
+		std::vector<std::thread> workers;
+		workers.reserve(workerCount);
+		for (unsigned int worker = 0; worker < workerCount; ++worker) {
+			workers.emplace_back([&] {
+				ExtractionScratch& scratch = ExtractionScratch::Get();
+				StreamItem item;
+				while (readQueue.Pop(item)) {
+					const FileState& state = states[item.index];
+					const ManifestEntry* known = manifest.Find(fs::path(files[item.index]).filename().string());
+
+					try {
+						if (item.error.empty()) {
+							SS_PROFILE_SCOPE("extract_item");
+
+							item.contentHash = FeatureManifest::HashBytes(item.bytes.data(), item.bytes.size());
+
+							// Touched but identical content
+							if (known && state.previousImage != FeatureStore::NotFound && known->size == state.fingerprint.size && known->contentHash == item.contentHash) {
+								item.reuse = true;
+							}
+							else if (!extractor(files[item.index], item.bytes, scratch.features, item.error)) {
+								if (item.error.empty())
+									item.error = "Unknown error";
+							}
+							else {
+								{
+									std::lock_guard<std::mutex> lock(recordPoolMutex);
+									if (!recordPool.empty()) {
+										item.records = std::move(recordPool.back());
+										recordPool.pop_back();
+									}
+								}
+
+								const auto& shapeFeatures = scratch.features.shapeFeatures;
+								item.records.assign(shapeFeatures.size() * FeatureStore::Stride, 0.0);
+								for (size_t contour = 0; contour < shapeFeatures.size(); ++contour)
+									std::copy_n(shapeFeatures[contour].begin(), std::min<size_t>(shapeFeatures[contour].size(), FeatureStore::Dimension), item.records.begin() + contour * FeatureStore::Stride);
+								item.descriptor = scratch.features.descriptor;
+							}
+						}
+					}
+					catch (const std::exception& e) {
+						item.error = e.what();
+					}
+					catch (...) {
+						item.error = "Unknown exception";
+					}
+
+					std::vector<uint8_t>().swap(item.bytes);
+					resultQueue.Push(std::move(item));
+				}
+
+				// The last worker out ends the writer's loop
+				if (--runningWorkers == 0)
+					resultQueue.Close();
+				});
+		}
+
+		size_t streamed = 0;
+		std::vector<char> streamedFiles(files.size(), 0);
+		auto writeItem = [&](StreamItem& item) {
+			++streamed;
+			streamedFiles[item.index] = 1;
+			completeFiles(1);
+
+			if (!item.error.empty()) {
+				report.batch.failures.push_back({ files[item.index], item.error });
+				keepPrevious(item.index);
+				if (!written)
+					stopReading = true;
+				return;
+			}
+			if (!written)
+				return;
+
+			{
+				SS_PROFILE_SCOPE("store_write");
+				written = item.reuse ? copyPrevious(item.index) : writer.AddImage(states[item.index].name, item.records.data(), item.records.size() / FeatureStore::Stride, item.descriptor);
+			}
+			if (item.records.capacity() > 0) {
+				std::lock_guard<std::mutex> lock(recordPoolMutex);
+				recordPool.push_back(std::move(item.records));
+			}
+			if (!written) {
+				// Keep draining so the workers never block on a full queue
+				stopReading = true;
+				return;
+			}
+
+			FileState& state = states[item.index];
+			if (!item.reuse && previousStore.FindImage(state.name) != FeatureStore::NotFound)
+				++carriedOver;
+			state.fingerprint.contentHash = item.contentHash;
+			updatedManifest.Set(fs::path(files[item.index]).filename().string(), state.fingerprint);
+			if (item.reuse)
+				++report.reused;
+			else
+				++report.extracted;
+			++report.batch.succeeded;
+		};
+
+		// The reader sends every position up to where it stops, so everything buffered here is written in the end
+		std::map<size_t, StreamItem> reorderBuffer;
+		StreamItem item;
+		while (resultQueue.Pop(item)) {
+			size_t position = item.position;
+			reorderBuffer.emplace(position, std::move(item));
+
+			size_t advanced = 0;
+			for (auto next = reorderBuffer.find(nextPosition + advanced); next != reorderBuffer.end(); next = reorderBuffer.find(nextPosition + advanced)) {
+				writeItem(next->second);
+				reorderBuffer.erase(next);
+				++advanced;
+			}
+
+			if (advanced > 0) {
+				{
+					std::lock_guard<std::mutex> lock(windowMutex);
+					nextPosition += advanced;
+				}
+				windowAdvanced.notify_one();
+			}
+		}
+
+		reader.join();
+		for (auto& worker : workers)
+			worker.join();
+
+		// A cancellation stops the reader, whatever it had not read yet is skipped
+		report.batch.cancelled = candidates.size() - streamed;
+		completeFiles(report.batch.cancelled);
+		for (size_t index : candidates) {
+			if (!streamedFiles[index])
+				keepPrevious(index);
+		}
+
+		std::sort(report.batch.failures.begin(), report.batch.failures.end(), [](const BatchFailure& a, const BatchFailure& b) {
+			return a.path < b.path;
+			});
+
+		// Counted from what was written, so a file that could not be stat'ed and is gone from the store is removed too
+		report.removed = previousStore.GetImageCount() - carriedOver;
+
+		// Every reused record is in the output stream now, the old mapping can go before the file is replaced
+		previousStore.Close();
+		written = written && writer.Finish();
+		if (!written)
+			writer.Abort();
+
+		// Back on the new store, or on the old one if it could not be replaced
+		if (shardClosed)
+			m_Datasets.ReopenStore(outputFileName);
+
+		if (!written) {
+			std::cerr << "Failed to save features to: " << outputFileName << std::endl;
+
+			// The writer never touched the existing file, retrieval goes on with what was loaded before
+			if (!loadedStore.empty() && !LoadFeaturesFromFile(loadedStore))
+				std::cerr << "Failed to reload the previous feature index: " << loadedStore << std::endl;
+			return report;
+		}
+
+		updatedManifest.Save(manifestFileName);
+
+		// Query straight from the mapped index
+		if (m_FeatureStore.Open(outputFileName)) {
+			m_FeatureMatrix.Attach(m_FeatureStore);
+			UpdateCompressedFeatures();
+
+			if (m_ExportFeaturesAsText) {
+				FeatureStore::ExportText((subdirectory / "output_features.txt").string(), m_FeatureStore);
+			}
+
+			if (m_UseApproximateIndex) {
+				UpdateApproximateIndex();
+			}
+
+			if (m_UseClusterIndex) {
+				UpdateClusterIndex();
+			}
+		}
+
+		return report;
 	}
 
 	void ImageProcessor::SaveFeaturesToFile(const std::string& outputFile, const std::unordered_map<std::string, FeatureData>& allFeatures)
 	{
-		std::ofstream outputFileStream(outputFile, std::ios::binary);
+		if (!FeatureStore::Write(outputFile, allFeatures)) {
+			std::cerr << "Failed to save features to: " << outputFile << std::endl;
+		}
+	}
+
+	void ImageProcessor::ExportFeaturesToText(const std::string& outputFile, const std::unordered_map<std::string, FeatureData>& allFeatures)
+	{
+		FeatureStore::ExportText(outputFile, allFeatures);
+	}
+
+	bool ImageProcessor::LoadFeaturesFromFile(const std::string& inputFile)
+	{
+		SS_PROFILE_SCOPE("load_features");
+
+		m_FeatureMatrix.Clear();
+		m_CompressedFeatures.Clear();
+
+		if (!m_FeatureStore.Open(inputFile)) {
+			return false;
+		}
+
+		// Retrieval reads the mapped features in place, nothing is copied at load time
+		m_AllFeatures.clear();
+		m_FeatureMatrix.Attach(m_FeatureStore);
+		UpdateCompressedFeatures();
+
+		m_FeatureExtractionDir = fs::path(inputFile).parent_path().string();
+
+		if (m_UseApproximateIndex) {
+			UpdateApproximateIndex();
+		}
+		if (m_UseClusterIndex) {
+			UpdateClusterIndex();
+		}
+		return true;
+	}
+
+	std::vector<std::pair<std::string, double>> ImageProcessor::RetrieveImages(const std::string& queryImageName, int topK)
+	{
+		return RetrieveImagesBatch({ queryImageName }, topK).front();
+	}
+
+	std::vector<std::vector<std::pair<std::string, double>>> ImageProcessor::RetrieveImagesBatch(const std::vector<std::string>& queryImageNames, int topK, bool excludeQueryImage)
+	{
+		SS_PROFILE_SCOPE("retrieve_batch");
+
+		// Queries of a group share one pass over the index, stored contours are streamed in blocks that stay cache resident for the whole group
+		const size_t queriesPerGroup = 64;
+		const size_t contoursPerBlock = 4096;
+		// Smallest image range worth a task of its own when a few queries are split over the index
+		const size_t minImagesPerSlice = 1024;
+
+		std::vector<std::vector<std::pair<std::string, double>>> results(queryImageNames.size());
+		if (topK <= 0 || queryImageNames.empty())
+			return results;
+
+		// Retrieve the query features
+		std::vector<size_t> queryImages(queryImageNames.size());
+		for (size_t query = 0; query < queryImageNames.size(); ++query) {
+			queryImages[query] = m_FeatureMatrix.FindImage(queryImageNames[query]);
+
+			if (queryImages[query] == FeatureMatrix::NotFound) {
+				std::cerr << "No features stored for query image: " << queryImageNames[query] << std::endl;
+			}
+		}
 
-		if (outputFileStream.is_open()) {
-			for (const auto& entry : allFeatures) {
-				outputFileStream << entry.first << " " << entry.second.numShapes << " ";
+		const size_t imageCount = m_FeatureMatrix.GetImageCount();
+		const bool useApproximateIndex = m_UseApproximateIndex && m_ApproximateIndex.GetSize() == m_FeatureMatrix.GetContourCount() && !m_ApproximateIndex.IsEmpty();
+		const bool useClusterIndex = m_UseClusterIndex && !m_ClusterIndex.IsEmpty()
+			&& m_ClusterIndex.GetSize() == m_FeatureMatrix.GetContourCount() && m_ClusterIndex.GetImageCount() == imageCount;
+		const bool useCompressedFeatures = !m_CompressedFeatures.IsEmpty() && m_CompressedFeatures.GetContourCount() == m_FeatureMatrix.GetContourCount();
+
+		// Cascade: candidates too far from the query on the whole-image descriptors are never scored
+		const ShapeDescriptor* descriptors = m_CascadeTolerance < 1.0 ? m_FeatureMatrix.GetDescriptors() : nullptr;
+		auto isSkipped = [&](size_t queryImage, size_t image) {
+			return (excludeQueryImage && image == queryImage)
+				|| (descriptors && !ShapeCascade::Accepts(descriptors[queryImage], descriptors[image], m_CascadeTolerance));
+		};
+
+		// Fewer groups than workers, as for a single query, would leave cores idle: the scanning paths then also split the
+		// images into slices, each task ranks one group against one slice and the slice rankings are merged afterwards
+		BatchExecutor executor(m_WorkerCount);
+		const bool usesCandidates = useApproximateIndex || useClusterIndex;
+		const size_t groupCount = (queryImageNames.size() + queriesPerGroup - 1) / queriesPerGroup;
+		size_t sliceCount = 1;
+		if (!usesCandidates && groupCount < executor.GetWorkerCount()) {
+			size_t wantedSlices = (executor.GetWorkerCount() + groupCount - 1) / groupCount;
+			sliceCount = std::max<size_t>(1, std::min(wantedSlices, imageCount / minImagesPerSlice));
+		}
+
+		// Per task and query of its group, the slice's ranking as (image, distance)
+		std::vector<std::vector<std::vector<std::pair<size_t, double>>>> taskMatches(groupCount * sliceCount);
+
+		BatchReport report = executor.Run(groupCount * sliceCount, [&](size_t task, std::string&) {
+			size_t group = task / sliceCount;
+			size_t slice = task % sliceCount;
+			size_t first = group * queriesPerGroup;
+			size_t last = std::min(queryImageNames.size(), first + queriesPerGroup);
+			size_t sliceBegin = imageCount * slice / sliceCount;
+			size_t sliceEnd = imageCount * (slice + 1) / sliceCount;
+
+			std::vector<TopKSelector> selectors(last - first, TopKSelector(static_cast<size_t>(topK)));
+
+			// Candidate paths: the graph, or else the clusters nearest to each query contour, propose images which are then scored exactly
+			if (usesCandidates) {
+				const size_t ef = m_ApproximateIndex.GetParameters().efSearch;
+				const size_t probeCount = m_ClusterIndex.GetParameters().probeCount;
+
+				for (size_t query = first; query < last; ++query) {
+					size_t queryImage = queryImages[query];
+					if (queryImage == FeatureMatrix::NotFound)
+						continue;
+
+					const double* queryFeatures = m_FeatureMatrix.GetImageContours(queryImage);
+					size_t queryCount = m_FeatureMatrix.GetContourCount(queryImage);
+
+					std::vector<size_t> candidates;
+					if (useApproximateIndex) {
+						for (size_t contour = 0; contour < queryCount; ++contour) {
+							for (const auto& neighbour : m_ApproximateIndex.Search(m_FeatureMatrix.GetFeatures(), queryFeatures + contour * FeatureMatrix::Stride, ef, ef))
+								candidates.push_back(m_FeatureMatrix.FindImageOfContour(neighbour.first));
+						}
+
+						std::sort(candidates.begin(), candidates.end());
+						candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+					}
+					else {
+						candidates = m_ClusterIndex.FindCandidates(queryFeatures, queryCount, probeCount);
+					}
+
+					for (size_t image : candidates) {
+						if (isSkipped(queryImage, image))
+							continue;
+
+						double minDistance = HuDistance::MinSummedDistance(queryFeatures, queryCount, m_FeatureMatrix.GetImageContours(image), m_FeatureMatrix.GetContourCount(image));
+						selectors[query - first].Push(image, minDistance);
+					}
+				}
+			}
+			else if (useCompressedFeatures) {
+				// The first pass scans the compact codes and keeps m_RerankFactor candidates per match,
+				// only those are scored at full precision
+				const size_t candidateCount = static_cast<size_t>(topK) * std::max<size_t>(1, m_RerankFactor);
+				std::vector<float> encodedQuery;
+
+				for (size_t query = first; query < last; ++query) {
+					size_t queryImage = queryImages[query];
+					if (queryImage == FeatureMatrix::NotFound)
+						continue;
+
+					const double* queryFeatures = m_FeatureMatrix.GetImageContours(queryImage);
+					size_t queryCount = m_FeatureMatrix.GetContourCount(queryImage);
+					m_CompressedFeatures.EncodeQuery(queryFeatures, queryCount, encodedQuery);
+
+					TopKSelector candidates(candidateCount);
+					for (size_t image = sliceBegin; image < sliceEnd; ++image) {
+						if (isSkipped(queryImage, image))
+							continue;
+
+						candidates.Push(image, m_CompressedFeatures.MinSummedDistance(encodedQuery.data(), queryCount, m_FeatureMatrix.GetContourBegin(image), m_FeatureMatrix.GetContourEnd(image)));
+					}
 
-				for (const auto& feature_vector : entry.second.shapeFeatures) {
-					for (double moment : feature_vector) {
-						outputFileStream << std::setprecision(10) << moment << " ";
+					for (const auto& candidate : candidates.Take()) {
+						double minDistance = HuDistance::MinSummedDistance(queryFeatures, queryCount, m_FeatureMatrix.GetImageContours(candidate.first), m_FeatureMatrix.GetContourCount(candidate.first));
+						selectors[query - first].Push(candidate.first, minDistance);
 					}
 				}
+			}
+			else {
+				for (size_t blockBegin = sliceBegin; blockBegin < sliceEnd; ) {
+					size_t blockEnd = blockBegin + 1;
+					size_t blockContours = m_FeatureMatrix.GetContourCount(blockBegin);
+					while (blockEnd < sliceEnd && blockContours + m_FeatureMatrix.GetContourCount(blockEnd) <= contoursPerBlock) {
+						blockContours += m_FeatureMatrix.GetContourCount(blockEnd);
+						++blockEnd;
+					}
+
+					for (size_t query = first; query < last; ++query) {
+						size_t queryImage = queryImages[query];
+						if (queryImage == FeatureMatrix::NotFound)
+							continue;
+
+						const double* queryFeatures = m_FeatureMatrix.GetImageContours(queryImage);
+						size_t queryCount = m_FeatureMatrix.GetContourCount(queryImage);
+						TopKSelector& selector = selectors[query - first];
+
+						for (size_t image = blockBegin; image < blockEnd; ++image) {
+							if (isSkipped(queryImage, image))
+								continue;
+
+							// Minimum over the stored contours of the summed distance to every query contour
+							double minDistance = HuDistance::MinSummedDistance(queryFeatures, queryCount, m_FeatureMatrix.GetImageContours(image), m_FeatureMatrix.GetContourCount(image));
+							selector.Push(image, minDistance);
+						}
+					}
+
+					blockBegin = blockEnd;
+				}
+			}
+
+			taskMatches[task].resize(last - first);
+			for (size_t query = first; query < last; ++query)
+				taskMatches[task][query - first] = selectors[query - first].Take();
+
+			return true;
+			});
+
+		// A failed task leaves its queries without matches, that must not pass for "nothing similar found"
+		for (const auto& failure : report.failures)
+			std::cerr << "Retrieval failed (" << failure.path << " of " << groupCount * sliceCount << "): " << failure.reason << std::endl;
+
+		for (size_t group = 0; group < groupCount; ++group) {
+			size_t first = group * queriesPerGroup;
+			size_t last = std::min(queryImageNames.size(), first + queriesPerGroup);
+
+			for (size_t query = first; query < last; ++query) {
+				if (queryImages[query] == FeatureMatrix::NotFound)
+					continue;
+
+				// Any match of the overall top K is in the top K of its own slice
+				TopKSelector merged(static_cast<size_t>(topK));
+				for (size_t slice = 0; slice < sliceCount; ++slice) {
+					const auto& sliceMatches = taskMatches[group * sliceCount + slice];
+					if (sliceMatches.empty())
+						continue;
+
+					for (const auto& match : sliceMatches[query - first])
+						merged.Push(match.first, match.second);
+				}
 
-				outputFileStream << "\n";
+				for (const auto& match : merged.Take())
+					results[query].push_back({ std::string(m_FeatureMatrix.GetImageName(match.first)), match.second });
 			}
+		}
+
+		return results;
+	}
 
-			outputFileStream.close();
+	std::vector<ShardMatch> ImageProcessor::RetrieveAcrossDatasets(const std::string& queryImageName, int topK)
+	{
+		std::vector<double> queryFeatures;
+		size_t queryCount = 0;
+
+		size_t queryImage = m_FeatureMatrix.FindImage(queryImageName);
+		if (queryImage != FeatureMatrix::NotFound) {
+			queryCount = m_FeatureMatrix.GetContourCount(queryImage);
+			const double* contours = m_FeatureMatrix.GetImageContours(queryImage);
+			queryFeatures.assign(contours, contours + queryCount * FeatureMatrix::Stride);
 		}
-		else {
-			std::cerr << "Failed to open output file: " << outputFile << std::endl;
+		else if (!m_Datasets.FindQuery(queryImageName, queryFeatures, queryCount)) {
+			std::cerr << "No features stored for query image: " << queryImageName << std::endl;
+			return std::vector<ShardMatch>();
 		}
+
+		return m_Datasets.Search(queryFeatures.data(), queryCount, topK);
 	}
 
-	GLuint ImageProcessor::VisualizeContours(const std::string& imagePath)
+	void ImageProcessor::UpdateCompressedFeatures()
 	{
-		cv::Mat image = cv::imread(imagePath);
+		SS_PROFILE_SCOPE("compress_features");
 
-		if (image.empty())
-		{
-			std::cerr << "Failed to load the image at path: " << imagePath << std::endl;
-			return 0;
+		m_CompressedFeatures.Build(m_FeatureMatrix, m_FeatureCompression);
+	}
+
+	bool ImageProcessor::UpdateApproximateIndex()
+	{
+		SS_PROFILE_SCOPE("approximate_index_update");
+
+		if (m_FeatureExtractionDir.empty() || m_FeatureMatrix.IsEmpty()) {
+			return false;
 		}
 
-		cv::Mat gray;
-		cv::cvtColor(image, gray, cv::COLOR_BGR2GRAY);
+		// Reuses the persisted graph if it was built over a prefix of the current features, inserting only the new contours
+		std::string indexFileName = (fs::path(m_FeatureExtractionDir) / "output_features.hnsw").string();
+		return m_ApproximateIndex.Update(indexFileName, m_FeatureMatrix.GetFeatures(), m_FeatureMatrix.GetContourCount());
+	}
 
-		// Apply threshold to create a binary image
-		cv::Mat thresh;
-		cv::threshold(gray, thresh, 128, 255, cv::THRESH_BINARY);
+	bool ImageProcessor::UpdateClusterIndex()
+	{
+		SS_PROFILE_SCOPE("cluster_index_update");
 
-		// Find contours in the binary image
-		std::vector<std::vector<cv::Point>> contours;
-		cv::findContours(thresh, contours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE);
+		if (m_FeatureExtractionDir.empty() || m_FeatureMatrix.IsEmpty()) {
+			return false;
+		}
 
-		// Draw contours on the original image
-		cv::drawContours(image, contours, -1, cv::Scalar(0, 255, 0), 2);
+		std::string indexFileName = (fs::path(m_FeatureExtractionDir) / "output_features.ivf").string();
+		return m_ClusterIndex.Update(indexFileName, m_FeatureMatrix, m_WorkerCount);
+	}
+
+	SharedImage ImageProcessor::LoadImage(const std::string& imagePath)
+	{
+		return m_ImageCache.Get(imagePath, [](const std::string& path) { return DecodeImage(path); });
+	}
+
+	cv::Mat ImageProcessor::ReadImage(const std::string& imagePath)
+	{
+		SharedImage image = LoadImage(imagePath);
+		return image ? image->clone() : cv::Mat();
+	}
+
+	cv::Mat ImageProcessor::DecodeImage(const std::string& imagePath)
+	{
+		SS_PROFILE_SCOPE("decode");
 
-		// Resize the image to fit the dimensions of the viewport
-		cv::resize(image, image, cv::Size(500, 500));
+		if (fs::path(imagePath).extension() == MaskCodec::Extension)
+			return MaskCodec::Read(imagePath);
 
-		// Convert the processed image to an OpenGL texture
-		GLuint textureID;
-		glGenTextures(1, &textureID);
-		glBindTexture(GL_TEXTURE_2D, textureID);
+		return cv::imread(imagePath);
+	}
+
+	bool ImageProcessor::DecodeImage(const std::string& imagePath, const std::vector<uint8_t>& bytes, cv::Mat& image)
+	{
+		SS_PROFILE_SCOPE("decode");
 
-		if (image.channels() == 1) {
-			// Grayscale image
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, image.cols, image.rows, 0, GL_RED, GL_UNSIGNED_BYTE, image.data);
+		if (fs::path(imagePath).extension() == MaskCodec::Extension)
+			return MaskCodec::Decode(bytes.data(), bytes.size(), image);
+
+		return !bytes.empty() && !cv::imdecode(bytes, cv::IMREAD_COLOR, &image).empty();
+	}
+
+	bool ImageProcessor::WriteImage(const std::string& imagePath, const cv::Mat& image)
+	{
+		SS_PROFILE_SCOPE("encode_write");
+
+		if (fs::path(imagePath).extension() == MaskCodec::Extension) {
+			if (!MaskCodec::Write(imagePath, image)) {
+				m_ImageCache.Invalidate(imagePath);
+				return false;
+			}
+
+			// Lossless, the next read of this file would decode exactly these pixels
+			m_ImageCache.Put(imagePath, image.clone());
+			return true;
 		}
-		else if (image.channels() == 3) {
-			// Color image (BGR)
-			cv::cvtColor(image, image, cv::COLOR_BGR2RGB);
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, image.cols, image.rows, 0, GL_RGB, GL_UNSIGNED_BYTE, image.data);
+
+		m_ImageCache.Invalidate(imagePath);
+		return cv::imwrite(imagePath, image);
+	}
+
+	cv::Mat ImageProcessor::DecodeThumbnail(const std::string& imagePath, int maxSide)
+	{
+		cv::Mat image;
+
+		// Already decoded for the Viewport or the pipeline, only the resize is left
+		SharedImage cached = m_ImageCache.Find(imagePath);
+		if (cached) {
+			image = *cached;
+		}
+		else if (fs::path(imagePath).extension() == MaskCodec::Extension) {
+			// Run-length masks have no reduced mode, their full decode is already a fill per run
+			image = MaskCodec::Read(imagePath);
 		}
-		else if (image.channels() == 4) {
-			// Color image with alpha (BGRA)
-			cv::cvtColor(image, image, cv::COLOR_BGRA2RGBA);
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, image.cols, image.rows, 0, GL_RGBA, GL_UNSIGNED_BYTE, image.data);
+		else {
+			// JPEG scales in the DCT domain, so pick the smallest reduction from the header size. Other formats
+			// decode in full under any reduced mode, the INTER_AREA resize below does the rest.
+			ImageMetadata metadata;
+			int mode = cv::IMREAD_COLOR;
+			if (ImageProbe::ReadMetadata(imagePath, metadata) && metadata.format == ImageFormat::Jpeg) {
+				int fullSide = std::max(metadata.width, metadata.height);
+				mode = fullSide / 8 >= maxSide ? cv::IMREAD_REDUCED_COLOR_8 : fullSide / 4 >= maxSide ? cv::IMREAD_REDUCED_COLOR_4
+					: fullSide / 2 >= maxSide ? cv::IMREAD_REDUCED_COLOR_2 : cv::IMREAD_COLOR;
+			}
+
+			image = cv::imread(imagePath, mode);
 		}
 
-		// Texture parameters
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		if (image.empty())
+			return image;
 
-		glBindTexture(GL_TEXTURE_2D, 0);
+		cv::Mat thumbnail;
+		double scale = static_cast<double>(maxSide) / std::max(image.cols, image.rows);
+		if (scale < 1.0)
+			cv::resize(image, thumbnail, cv::Size(std::max(1, cvRound(image.cols * scale)), std::max(1, cvRound(image.rows * scale))), 0, 0, cv::INTER_AREA);
+		else
+			thumbnail = image.clone();
 
-		return textureID;
+		return thumbnail;
 	}
 
-	std::vector<std::pair<std::string, double>> ImageProcessor::RetrieveImages(const std::string& queryImageName, int topK)
+	std::vector<std::string> ImageProcessor::CollectFiles(const std::string& directoryPath, const std::string& extension)
 	{
-		// Retrieve the query features
-		const std::vector<std::vector<double>>& queryFeatures = m_AllFeatures[queryImageName].shapeFeatures;
+		std::vector<std::string> files;
+
+		for (const auto& entry : fs::directory_iterator(directoryPath)) {
+			if (entry.is_regular_file() && entry.path().extension() == extension) {
+				files.push_back(entry.path().string());
+			}
+		}
 
-		std::vector<std::pair<std::string, double>> distances;
+		// directory_iterator order is unspecified, sort so every run schedules the same work
+		std::sort(files.begin(), files.end());
+		return files;
+	}
 
-		for (const auto& entry : m_AllFeatures) {
+	std::string ImageProcessor::FindIntermediateExtension(const std::string& directoryPath)
+	{
+		// Datasets converted before .ssm became the default hold JPEG intermediates, keep reading them as such
+		bool hasLegacyFiles = false;
+		std::error_code directoryError;
+		for (const auto& entry : fs::directory_iterator(directoryPath, directoryError)) {
+			if (!entry.is_regular_file())
+				continue;
+
+			std::string extension = entry.path().extension().string();
+			if (extension == m_IntermediateExtension)
+				return m_IntermediateExtension;
+			hasLegacyFiles = hasLegacyFiles || extension == ".jpg";
+		}
 
-			double minDistance = std::numeric_limits<double>::infinity();
+		return hasLegacyFiles ? std::string(".jpg") : m_IntermediateExtension;
+	}
 
-			for (const auto& storedFeature : entry.second.shapeFeatures) {
-				// Calculate distance between query and stored features
-				double distance = 0.0;
+	BatchReport ImageProcessor::ApplyToDirectory(const std::string& directoryPath, const fs::path& outputDirectory, const std::function<void(cv::Mat&)>& filter)
+	{
+		// Snapshot the file list first, ApplyAllToDirectory writes into the directory it reads from
+		std::vector<std::string> files = CollectFiles(directoryPath, FindIntermediateExtension(directoryPath));
 
-				for (size_t i = 0; i < queryFeatures.size(); ++i) {
-					distance += cv::norm(cv::Mat(queryFeatures[i]), cv::Mat(storedFeature));
-				}
+		BatchExecutor executor(m_WorkerCount);
+		return executor.Run(files, [&](size_t, const std::string& path, std::string& error) {
+			cv::Mat image = ReadImage(path);
 
-				if (distance < minDistance) {
-					minDistance = distance;
-				}
+			if (image.empty()) {
+				error = "Failed to load the image";
+				return false;
 			}
 
-			distances.push_back({ entry.first, minDistance });
-		}
+			filter(image);
 
-		// Sort the distances vector based on the second element of the pairs (distances)
-		std::sort(distances.begin(), distances.end(), [](const auto& a, const auto& b) {
-			return a.second < b.second;
-			});
+			fs::path outputPath = outputDirectory / fs::path(path).filename();
+			if (!WriteImage(outputPath.string(), image)) {
+				error = "Failed to write " + outputPath.string();
+				return false;
+			}
 
-		return distances.size() > topK ? std::vector<std::pair<std::string, double>>(distances.begin(), distances.begin() + topK) : distances;
+			return true;
+			}, m_Progress);
 	}
 }
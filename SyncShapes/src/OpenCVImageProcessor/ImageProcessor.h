@@ -1,28 +1,49 @@
 #pragma once
 
-#include <GLFW/glfw3.h>
 #include <opencv2/opencv.hpp>
 #include <opencv2/features2d/features2d.hpp>
-#include <FreeImage.h>
 #include <filesystem>
 #include <fstream>
 
+#include "BatchExecutor/BatchExecutor.h"
+#include "FeatureStore/FeatureStore.h"
+#include "FeatureStore/FeatureManifest.h"
+#include "FeatureIndex/ClusterIndex.h"
+#include "FeatureIndex/FeatureMatrix.h"
+#include "FeatureIndex/HnswIndex.h"
+#include "FeatureIndex/QuantizedMatrix.h"
+#include "FeatureIndex/ShardedIndex.h"
+#include "MaskCodec.h"
+#include "ImageCache.h"
+#include "ImageProbe.h"
+
 namespace fs = std::filesystem;
 
 namespace SyncShapes
 {
-	struct ImageDetails
+	struct FeatureUpdateReport
 	{
-		std::string type;
-		int width;
-		int height;
+		size_t extracted = 0;
+		size_t reused = 0;
+		size_t removed = 0;
+		BatchReport batch;
 	};
 
-	struct FeatureData {
-		int numShapes;
-		std::vector<std::vector<double>> shapeFeatures;
+	// Steps of the fused ingest, mirroring the individual pre-processing passes
+	struct IngestOptions
+	{
+		bool noiseRemoval = true;
+		bool holeFilling = true;
+		bool histogramEqualization = true;
+		bool contourAreaFiltering = true;
+		double minContourArea = 300;
+		bool writeIntermediates = false; // Save the pre-processed images to a "preprocessed" subdirectory
 	};
 
+	// Computes the Hu vectors and shape descriptor of one image file from its content, already read by the prefetch stage.
+	// Returns false with a reason on failure.
+	using FeatureExtractor = std::function<bool(const std::string& imagePath, const std::vector<uint8_t>& bytes, FeatureData& featureData, std::string& error)>;
+
 	class ImageProcessor
 	{
 	public:
@@ -31,37 +52,100 @@ namespace SyncShapes
 
 		static void DisplayImage(const std::string& imagePath, const std::string& windowName);
 
-		static GLuint GetTexture(const std::string& imagePath);
 		static ImageDetails GetImageDetails(const std::string& imagePath);
 		static cv::Mat ResizeImage(const std::string& imagePath, int width, int height);
-		static void ConvertGIFToJPEG(const std::string& gifImagePath);
-		static void ConvertAllGIFsToJPEGs(const std::string& directoryPath);
-		static GLuint VisualizeImage(const std::string& imagePath, bool drawContours);
+		// Writes the GIF in the m_IntermediateExtension format to the "pre-processing" directory next to it, created if missing
+		static bool ConvertGIFToIntermediate(const std::string& gifImagePath, std::string& error);
+		static void ConvertGIFToIntermediate(const std::string& gifImagePath);
+		// Converts the GIFs in the parent directory of 'directoryPath' in parallel and sets m_PreprocessingDir
+		static BatchReport ConvertAllGIFs(const std::string& directoryPath);
+		static std::string GetPreprocessingDirectory(const std::string& gifDirectoryPath);
 
 		// Pre-processing Stage
 		static void ApplyNoiseRemoval(cv::Mat& image);
-		static void ApplyNoiseRemovalToDirectory(const std::string& directoryPath);
+		static BatchReport ApplyNoiseRemovalToDirectory(const std::string& directoryPath);
 		static void ApplyHoleFilling(cv::Mat& image);
-		static void ApplyHoleFillingToDirectory(const std::string& directoryPath);
+		static BatchReport ApplyHoleFillingToDirectory(const std::string& directoryPath);
 		static void ApplyHistogramEqualization(cv::Mat& image);
-		static void ApplyHistogramEqualizationToDirectory(const std::string& directoryPath);
+		static BatchReport ApplyHistogramEqualizationToDirectory(const std::string& directoryPath);
 		static void ApplyContourAreaFiltering(cv::Mat& inputImage, double minContourArea);
-		static void ApplyContourAreaFilteringToDirectory(const std::string& directoryPath, double minContourArea);
-		static void ApplyAllToDirectory(const std::string& directoryPath);
+		static BatchReport ApplyContourAreaFilteringToDirectory(const std::string& directoryPath, double minContourArea);
+		static BatchReport ApplyAllToDirectory(const std::string& directoryPath);
 
 		// Feature Extraction Stage
 		static void ExtractShapeFeatures(const std::string& imagePath);
-		static void ExtractShapeFeaturesAndSave(const std::string& directoryPath);
+		static void ExtractShapeFeatures(const cv::Mat& image, FeatureData& featureData);
+		// Incremental: only new or changed images (by size, mtime and content hash) are re-extracted
+		static FeatureUpdateReport ExtractShapeFeaturesAndSave(const std::string& directoryPath);
+		// Overwrites 'shapeFeatures', reusing the vectors it already holds
+		static void ComputeHuFeatures(const std::vector<std::vector<cv::Point>>& contours, std::vector<std::vector<double>>& shapeFeatures);
+		static void ComputeShapeDescriptor(const std::vector<std::vector<cv::Point>>& contours, const cv::Size& imageSize, ShapeDescriptor& descriptor);
+
+		// Fused Ingest Stage: decode once, pre-process and extract in memory, no intermediate encode/decode round trip
+		static FeatureUpdateReport IngestDirectory(const std::string& directoryPath, const IngestOptions& options);
+		// Decodes the GIFs in memory and feeds them to the fused pass, the conversion to intermediates is optional.
+		// The index goes to the pre-processing directory, as if the GIFs had been converted first.
+		static FeatureUpdateReport IngestGIFDirectory(const std::string& gifDirectoryPath, const IngestOptions& options, bool writeConverted);
+		static void PreprocessAndExtract(cv::Mat& image, const IngestOptions& options, FeatureData& featureData);
+		static std::string GetPipelineSteps(const IngestOptions& options);
 		static void SaveFeaturesToFile(const std::string& outputFile, const std::unordered_map<std::string, FeatureData>& allFeatures);
-		static GLuint VisualizeContours(const std::string& imagePath);
+		static void ExportFeaturesToText(const std::string& outputFile, const std::unordered_map<std::string, FeatureData>& allFeatures);
+		static bool LoadFeaturesFromFile(const std::string& inputFile);
 
 		// Retrieval Stage
 		static std::vector<std::pair<std::string, double>> RetrieveImages(const std::string& queryImageName, int topK);
+		static std::vector<std::vector<std::pair<std::string, double>>> RetrieveImagesBatch(const std::vector<std::string>& queryImageNames, int topK, bool excludeQueryImage = false);
+		static bool UpdateApproximateIndex();
+		// k-means clusters of the current contours, persisted next to the index. Retrieval probes only the nearest clusters
+		// while m_UseClusterIndex is set and the approximate index is not in use.
+		static bool UpdateClusterIndex();
+		// Rebuilds m_CompressedFeatures from m_FeatureMatrix in the m_FeatureCompression format
+		static void UpdateCompressedFeatures();
+		// Cross-Dataset Retrieval over every dataset in m_Datasets, the query is looked up in the current index first
+		static std::vector<ShardMatch> RetrieveAcrossDatasets(const std::string& queryImageName, int topK);
+
+		// Image I/O, dispatched on the extension: MaskCodec for .ssm, OpenCV for everything else.
+		// LoadImage shares the decoded image through m_ImageCache, ReadImage returns a private copy that may be modified,
+		// DecodeImage bypasses the cache, the in-memory overload decodes into the buffer of 'image' when it is large enough.
+		// WriteImage keeps the cache in step with the file it replaces.
+		static SharedImage LoadImage(const std::string& imagePath);
+		static cv::Mat ReadImage(const std::string& imagePath);
+		static cv::Mat DecodeImage(const std::string& imagePath);
+		static bool DecodeImage(const std::string& imagePath, const std::vector<uint8_t>& bytes, cv::Mat& image);
+		static bool WriteImage(const std::string& imagePath, const cv::Mat& image);
+		// Decodes at the smallest JPEG reduction that still covers 'maxSide', then scales the longer side down to it
+		static cv::Mat DecodeThumbnail(const std::string& imagePath, int maxSide);
+
+		// Batch helpers
+		static std::vector<std::string> CollectFiles(const std::string& directoryPath, const std::string& extension);
+		// Extension of the intermediates in 'directoryPath': m_IntermediateExtension, or ".jpg" for a directory of JPEGs only
+		static std::string FindIntermediateExtension(const std::string& directoryPath);
+		static BatchReport ApplyToDirectory(const std::string& directoryPath, const fs::path& outputDirectory, const std::function<void(cv::Mat&)>& filter);
+		// Incremental index over 'files', written to 'directoryPath'/feature-extraction. Streams the files through
+		// read-ahead, extraction workers and the store writer over bounded queues, so memory does not grow with the dataset.
+		static FeatureUpdateReport UpdateFeatureStore(const std::string& directoryPath, const std::vector<std::string>& files, const std::string& pipeline, const FeatureExtractor& extractor);
 	public:
 		static std::string m_PreprocessingDir;
 		static std::string m_FeatureExtractionDir;
 		static std::unordered_map<std::string, FeatureData> m_AllFeatures;
+		static FeatureStore m_FeatureStore;
+		static FeatureMatrix m_FeatureMatrix;
+		static HnswIndex m_ApproximateIndex;
+		static ClusterIndex m_ClusterIndex;
+		static FeatureCompression m_FeatureCompression; // Exact scans go through m_CompressedFeatures first unless None
+		static QuantizedMatrix m_CompressedFeatures;
+		static size_t m_RerankFactor; // Candidates per match re-ranked at full precision after a compressed scan
+		static double m_CascadeTolerance; // Largest relative descriptor difference a candidate may have, 1 = no prefilter
+		static ShardedIndex m_Datasets;
+		static bool m_UseApproximateIndex;
+		static bool m_UseClusterIndex;
+		static bool m_ExportFeaturesAsText;
 		static bool m_ContoursOverlay;
+		static unsigned int m_WorkerCount; // 0 = one worker per hardware thread
+		static size_t m_PrefetchDepth; // Files advised to the OS ahead of the reader in streaming passes
+		static std::string m_IntermediateExtension; // Format of the pre-processing outputs, MaskCodec::Extension or ".jpg"
+		static BatchProgress* m_Progress; // Progress and cancellation of the running job, null when called directly
+		static ImageCache m_ImageCache;
 	};
 }
 
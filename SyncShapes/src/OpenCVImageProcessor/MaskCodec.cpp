@@ -0,0 +1,180 @@
+#include "MaskCodec.h"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+
+namespace SyncShapes
+{
+	static void AppendRun(std::vector<uint8_t>& encoded, const uint8_t* pixel, int channels, uint64_t length)
+	{
+		encoded.insert(encoded.end(), pixel, pixel + channels);
+
+		while (length >= 0x80) {
+			encoded.push_back(static_cast<uint8_t>(length | 0x80));
+			length >>= 7;
+		}
+		encoded.push_back(static_cast<uint8_t>(length));
+	}
+
+	bool MaskCodec::Encode(const cv::Mat& image, std::vector<uint8_t>& encoded)
+	{
+		if (image.empty() || image.depth() != CV_8U || (image.channels() != 1 && image.channels() != 3)) {
+			std::cerr << "Mask format supports 8-bit images with 1 or 3 channels only." << std::endl;
+			return false;
+		}
+
+		const int channels = image.channels();
+
+		MaskHeader header = {};
+		std::memcpy(header.magic, Magic, sizeof(header.magic));
+		header.version = Version;
+		header.channels = static_cast<uint8_t>(channels);
+		header.width = static_cast<uint32_t>(image.cols);
+		header.height = static_cast<uint32_t>(image.rows);
+
+		encoded.resize(sizeof(MaskHeader));
+		std::memcpy(encoded.data(), &header, sizeof(MaskHeader));
+
+		const uint8_t* current = image.ptr<uint8_t>(0);
+		uint64_t length = 0;
+
+		for (int row = 0; row < image.rows; ++row) {
+			const uint8_t* pixel = image.ptr<uint8_t>(row);
+			const uint8_t* rowEnd = pixel + static_cast<size_t>(image.cols) * channels;
+
+			if (channels == 1) {
+				while (pixel < rowEnd) {
+					// Scan to the end of the run within this row
+					const uint8_t* runEnd = pixel;
+					while (runEnd < rowEnd && *runEnd == *current)
+						++runEnd;
+
+					length += runEnd - pixel;
+					pixel = runEnd;
+
+					if (pixel < rowEnd) {
+						AppendRun(encoded, current, 1, length);
+						current = pixel;
+						length = 0;
+					}
+				}
+			}
+			else {
+				for (; pixel < rowEnd; pixel += channels) {
+					if (std::memcmp(pixel, current, channels) != 0) {
+						AppendRun(encoded, current, channels, length);
+						current = pixel;
+						length = 0;
+					}
+					++length;
+				}
+			}
+		}
+
+		if (length > 0)
+			AppendRun(encoded, current, channels, length);
+
+		return true;
+	}
+
+	bool MaskCodec::Decode(const uint8_t* data, size_t size, cv::Mat& image)
+	{
+		if (size < sizeof(MaskHeader))
+			return false;
+
+		MaskHeader header;
+		std::memcpy(&header, data, sizeof(MaskHeader));
+
+		if (std::memcmp(header.magic, Magic, sizeof(header.magic)) != 0 || header.version != Version || (header.channels != 1 && header.channels != 3)
+			|| header.width == 0 || header.height == 0 || header.width > 0x7FFFFFFF / header.channels || header.height > 0x7FFFFFFF)
+			return false;
+
+		// The whole image must fit the int range OpenCV indexes a continuous Mat with, so a corrupt header cannot ask for more
+		if (static_cast<uint64_t>(header.width) * header.height * header.channels > static_cast<uint64_t>(std::numeric_limits<int>::max()))
+			return false;
+
+		const int channels = header.channels;
+		image.create(static_cast<int>(header.height), static_cast<int>(header.width), channels == 1 ? CV_8UC1 : CV_8UC3);
+
+		// A freshly created Mat is continuous, the runs fill it as one flat buffer
+		uint8_t* output = image.ptr<uint8_t>(0);
+		uint8_t* outputEnd = output + static_cast<size_t>(header.width) * header.height * channels;
+
+		const uint8_t* input = data + sizeof(MaskHeader);
+		const uint8_t* inputEnd = data + size;
+
+		while (output < outputEnd) {
+			if (inputEnd - input < channels)
+				return false;
+
+			const uint8_t* pixel = input;
+			input += channels;
+
+			uint64_t length = 0;
+			int shift = 0;
+			for (;;) {
+				if (input == inputEnd || shift > 56)
+					return false;
+
+				uint8_t byte = *input++;
+				length |= static_cast<uint64_t>(byte & 0x7F) << shift;
+				shift += 7;
+
+				if (!(byte & 0x80))
+					break;
+			}
+
+			if (length == 0 || length > static_cast<uint64_t>(outputEnd - output) / channels)
+				return false;
+
+			if (channels == 1) {
+				std::memset(output, *pixel, static_cast<size_t>(length));
+				output += length;
+			}
+			else {
+				for (uint64_t i = 0; i < length; ++i, output += channels)
+					std::memcpy(output, pixel, channels);
+			}
+		}
+
+		return input == inputEnd;
+	}
+
+	bool MaskCodec::Write(const std::string& path, const cv::Mat& image)
+	{
+		std::vector<uint8_t> encoded;
+		if (!Encode(image, encoded))
+			return false;
+
+		std::ofstream outputFileStream(path, std::ios::binary | std::ios::trunc);
+		if (!outputFileStream.is_open()) {
+			std::cerr << "Failed to open mask file for writing: " << path << std::endl;
+			return false;
+		}
+
+		outputFileStream.write(reinterpret_cast<const char*>(encoded.data()), static_cast<std::streamsize>(encoded.size()));
+		return outputFileStream.good();
+	}
+
+	cv::Mat MaskCodec::Read(const std::string& path)
+	{
+		std::ifstream inputFileStream(path, std::ios::binary | std::ios::ate);
+		if (!inputFileStream.is_open())
+			return cv::Mat();
+
+		std::vector<uint8_t> encoded(static_cast<size_t>(inputFileStream.tellg()));
+		inputFileStream.seekg(0);
+		if (!inputFileStream.read(reinterpret_cast<char*>(encoded.data()), static_cast<std::streamsize>(encoded.size())))
+			return cv::Mat();
+
+		cv::Mat image;
+		if (!Decode(encoded.data(), encoded.size(), image)) {
+			std::cerr << "Corrupt mask file: " << path << std::endl;
+			return cv::Mat();
+		}
+
+		return image;
+	}
+}
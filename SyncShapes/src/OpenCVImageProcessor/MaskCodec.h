@@ -0,0 +1,45 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace SyncShapes
+{
+	// Lossless run-length format for the pipeline intermediates (.ssm). The shape images are
+	// bilevel or close to it, so a row-major stream of (pixel, run length) pairs is far smaller
+	// than a JPEG and decodes with a fill per run instead of an IDCT per block.
+	//
+	// On-disk layout (little-endian):
+	//   MaskHeader
+	//   runs: pixel value (channels bytes) followed by the run length as a LEB128 varint,
+	//         runs continue across rows and together cover width * height pixels
+	struct MaskHeader
+	{
+		char magic[4];
+		uint8_t version;
+		uint8_t channels;
+		uint16_t reserved;
+		uint32_t width;
+		uint32_t height;
+	};
+
+	static_assert(sizeof(MaskHeader) == 16, "MaskHeader must stay 16 bytes");
+
+	class MaskCodec
+	{
+	public:
+		static constexpr char Magic[4] = { 'S', 'S', 'M', 'K' };
+		static constexpr uint8_t Version = 1;
+		static constexpr const char* Extension = ".ssm";
+
+		// 8-bit images with 1 or 3 channels
+		static bool Encode(const cv::Mat& image, std::vector<uint8_t>& encoded);
+		static bool Decode(const uint8_t* data, size_t size, cv::Mat& image);
+
+		static bool Write(const std::string& path, const cv::Mat& image);
+		static cv::Mat Read(const std::string& path);
+	};
+}
@@ -0,0 +1,295 @@
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+
+namespace SyncShapes
+{
+	namespace
+	{
+		// Trace events kept per thread, later ones still count in the stats
+		const size_t MaxEventsPerThread = 1 << 18;
+
+		struct TraceEvent
+		{
+			const char* stage;
+			uint32_t threadId;
+			uint64_t startMicroseconds;
+			uint64_t durationMicroseconds;
+		};
+
+		struct ThreadBuffer
+		{
+			std::mutex mutex;
+			uint32_t threadId = 0;
+			// A thread only ever sees a handful of stages, a linear search on the literal's address beats hashing
+			std::vector<std::pair<const char*, StageStats>> stats;
+			std::vector<TraceEvent> events;
+			size_t droppedEvents = 0;
+		};
+
+		// Live thread buffers, plus what the threads that already exited left behind
+		struct Registry
+		{
+			std::mutex mutex;
+			std::vector<ThreadBuffer*> buffers;
+			std::map<std::string, StageStats> retiredStats;
+			std::vector<TraceEvent> retiredEvents;
+			size_t retiredDroppedEvents = 0;
+			uint32_t nextThreadId = 1;
+		};
+
+		const Profiler::Clock::time_point Epoch = Profiler::Clock::now();
+
+		Registry& GetRegistry()
+		{
+			static Registry registry;
+			return registry;
+		}
+
+		void MergeStats(std::map<std::string, StageStats>& merged, const ThreadBuffer& buffer)
+		{
+			for (const auto& entry : buffer.stats) {
+				StageStats& stats = merged[entry.first];
+				stats.name = entry.first;
+				stats.Merge(entry.second);
+			}
+		}
+
+		// Owns the buffer of the calling thread and hands its contents to the registry when the thread exits
+		struct ThreadSlot
+		{
+			ThreadBuffer* buffer = nullptr;
+
+			~ThreadSlot()
+			{
+				if (!buffer)
+					return;
+
+				Registry& registry = GetRegistry();
+				std::lock_guard<std::mutex> registryLock(registry.mutex);
+				{
+					std::lock_guard<std::mutex> bufferLock(buffer->mutex);
+					MergeStats(registry.retiredStats, *buffer);
+					registry.retiredEvents.insert(registry.retiredEvents.end(), buffer->events.begin(), buffer->events.end());
+					registry.retiredDroppedEvents += buffer->droppedEvents;
+				}
+
+				registry.buffers.erase(std::remove(registry.buffers.begin(), registry.buffers.end(), buffer), registry.buffers.end());
+				delete buffer;
+			}
+		};
+
+		ThreadBuffer& GetThreadBuffer()
+		{
+			thread_local ThreadSlot slot;
+			if (!slot.buffer) {
+				Registry& registry = GetRegistry();
+				std::lock_guard<std::mutex> lock(registry.mutex);
+				slot.buffer = new ThreadBuffer();
+				slot.buffer->threadId = registry.nextThreadId++;
+				registry.buffers.push_back(slot.buffer);
+			}
+
+			return *slot.buffer;
+		}
+
+		void WriteEscaped(std::ofstream& stream, const char* text)
+		{
+			for (; *text; ++text) {
+				if (*text == '"' || *text == '\\')
+					stream << '\\';
+				stream << *text;
+			}
+		}
+	}
+
+	std::atomic<bool> Profiler::m_Enabled(false);
+
+	void StageStats::Add(uint64_t microseconds)
+	{
+		minMicroseconds = count == 0 ? microseconds : std::min(minMicroseconds, microseconds);
+		maxMicroseconds = std::max(maxMicroseconds, microseconds);
+		totalMicroseconds += microseconds;
+		++count;
+
+		size_t bucket = 0;
+		for (uint64_t value = microseconds; value > 1 && bucket + 1 < HistogramBuckets; value >>= 1)
+			++bucket;
+		++histogram[bucket];
+	}
+
+	void StageStats::Merge(const StageStats& other)
+	{
+		if (other.count == 0)
+			return;
+
+		minMicroseconds = count == 0 ? other.minMicroseconds : std::min(minMicroseconds, other.minMicroseconds);
+		maxMicroseconds = std::max(maxMicroseconds, other.maxMicroseconds);
+		totalMicroseconds += other.totalMicroseconds;
+		count += other.count;
+
+		for (size_t bucket = 0; bucket < HistogramBuckets; ++bucket)
+			histogram[bucket] += other.histogram[bucket];
+	}
+
+	uint64_t StageStats::GetPercentileMicroseconds(double percentile) const
+	{
+		if (count == 0)
+			return 0;
+
+		uint64_t target = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(percentile / 100.0 * count)));
+		uint64_t seen = 0;
+		for (size_t bucket = 0; bucket < HistogramBuckets; ++bucket) {
+			seen += histogram[bucket];
+			if (seen >= target)
+				return std::min(maxMicroseconds, (uint64_t(1) << (bucket + 1)) - 1);
+		}
+
+		return maxMicroseconds;
+	}
+
+	void Profiler::SetEnabled(bool enabled)
+	{
+		m_Enabled.store(enabled, std::memory_order_relaxed);
+	}
+
+	void Profiler::Record(const char* stage, Clock::time_point start, Clock::time_point end)
+	{
+		uint64_t startMicroseconds = start > Epoch ? static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(start - Epoch).count()) : 0;
+		uint64_t durationMicroseconds = end > start ? static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(end - start).count()) : 0;
+
+		ThreadBuffer& buffer = GetThreadBuffer();
+		std::lock_guard<std::mutex> lock(buffer.mutex);
+
+		auto it = std::find_if(buffer.stats.begin(), buffer.stats.end(), [stage](const auto& entry) { return entry.first == stage; });
+		if (it == buffer.stats.end()) {
+			buffer.stats.push_back({ stage, StageStats() });
+			it = buffer.stats.end() - 1;
+		}
+		it->second.Add(durationMicroseconds);
+
+		if (buffer.events.size() < MaxEventsPerThread)
+			buffer.events.push_back({ stage, buffer.threadId, startMicroseconds, durationMicroseconds });
+		else
+			++buffer.droppedEvents;
+	}
+
+	std::vector<StageStats> Profiler::GetStats()
+	{
+		Registry& registry = GetRegistry();
+		std::map<std::string, StageStats> merged;
+		{
+			std::lock_guard<std::mutex> registryLock(registry.mutex);
+			merged = registry.retiredStats;
+
+			for (ThreadBuffer* buffer : registry.buffers) {
+				std::lock_guard<std::mutex> bufferLock(buffer->mutex);
+				MergeStats(merged, *buffer);
+			}
+		}
+
+		std::vector<StageStats> stats;
+		stats.reserve(merged.size());
+		for (auto& entry : merged)
+			stats.push_back(std::move(entry.second));
+
+		std::stable_sort(stats.begin(), stats.end(), [](const StageStats& a, const StageStats& b) {
+			return a.totalMicroseconds > b.totalMicroseconds;
+			});
+
+		return stats;
+	}
+
+	void Profiler::Reset()
+	{
+		Registry& registry = GetRegistry();
+		std::lock_guard<std::mutex> registryLock(registry.mutex);
+		registry.retiredStats.clear();
+		registry.retiredEvents.clear();
+		registry.retiredDroppedEvents = 0;
+
+		for (ThreadBuffer* buffer : registry.buffers) {
+			std::lock_guard<std::mutex> bufferLock(buffer->mutex);
+			buffer->stats.clear();
+			buffer->events.clear();
+			buffer->droppedEvents = 0;
+		}
+	}
+
+	bool Profiler::WriteTrace(const std::string& path)
+	{
+		// Copied out first, so the recording threads are not held up by the file write
+		std::vector<TraceEvent> events;
+		{
+			Registry& registry = GetRegistry();
+			std::lock_guard<std::mutex> registryLock(registry.mutex);
+			events = registry.retiredEvents;
+
+			for (ThreadBuffer* buffer : registry.buffers) {
+				std::lock_guard<std::mutex> bufferLock(buffer->mutex);
+				events.insert(events.end(), buffer->events.begin(), buffer->events.end());
+			}
+		}
+
+		std::sort(events.begin(), events.end(), [](const TraceEvent& a, const TraceEvent& b) {
+			return a.startMicroseconds < b.startMicroseconds;
+			});
+
+		std::ofstream outputFileStream(path, std::ios::trunc);
+		if (!outputFileStream.is_open()) {
+			std::cerr << "Failed to open output file: " << path << std::endl;
+			return false;
+		}
+
+		outputFileStream << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+		for (size_t i = 0; i < events.size(); ++i) {
+			const TraceEvent& event = events[i];
+			outputFileStream << (i == 0 ? "" : ",") << "\n{\"name\":\"";
+			WriteEscaped(outputFileStream, event.stage);
+			outputFileStream << "\",\"cat\":\"SyncShapes\",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.threadId
+				<< ",\"ts\":" << event.startMicroseconds << ",\"dur\":" << event.durationMicroseconds << "}";
+		}
+		outputFileStream << "\n]}\n";
+
+		outputFileStream.close();
+		if (outputFileStream.fail()) {
+			std::cerr << "Failed to write trace: " << path << std::endl;
+			return false;
+		}
+
+		return true;
+	}
+
+	size_t Profiler::GetEventCount()
+	{
+		Registry& registry = GetRegistry();
+		std::lock_guard<std::mutex> registryLock(registry.mutex);
+
+		size_t count = registry.retiredEvents.size();
+		for (ThreadBuffer* buffer : registry.buffers) {
+			std::lock_guard<std::mutex> bufferLock(buffer->mutex);
+			count += buffer->events.size();
+		}
+
+		return count;
+	}
+
+	size_t Profiler::GetDroppedEventCount()
+	{
+		Registry& registry = GetRegistry();
+		std::lock_guard<std::mutex> registryLock(registry.mutex);
+
+		size_t count = registry.retiredDroppedEvents;
+		for (ThreadBuffer* buffer : registry.buffers) {
+			std::lock_guard<std::mutex> bufferLock(buffer->mutex);
+			count += buffer->droppedEvents;
+		}
+
+		return count;
+	}
+}
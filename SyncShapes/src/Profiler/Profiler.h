@@ -0,0 +1,87 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace SyncShapes
+{
+	// Aggregated timings of one named stage. Bucket i of the histogram counts durations in [2^i, 2^(i+1)) microseconds,
+	// bucket 0 also holds everything under a microsecond.
+	struct StageStats
+	{
+		static constexpr size_t HistogramBuckets = 32;
+
+		std::string name;
+		uint64_t count = 0;
+		uint64_t totalMicroseconds = 0;
+		uint64_t minMicroseconds = 0;
+		uint64_t maxMicroseconds = 0;
+		uint64_t histogram[HistogramBuckets] = {};
+
+		void Add(uint64_t microseconds);
+		void Merge(const StageStats& other);
+		inline double GetMeanMicroseconds() const { return count ? static_cast<double>(totalMicroseconds) / count : 0.0; }
+		// Upper bound of the bucket holding the percentile, capped at the largest duration seen
+		uint64_t GetPercentileMicroseconds(double percentile) const;
+	};
+
+	// Process-wide scoped-timer instrumentation. Every thread records into its own buffer, which is merged only when the
+	// stats or the trace are read, so recording never contends between workers. While disabled a scope costs one relaxed load.
+	class Profiler
+	{
+	public:
+		using Clock = std::chrono::steady_clock;
+
+		static inline bool IsEnabled() { return m_Enabled.load(std::memory_order_relaxed); }
+		static void SetEnabled(bool enabled);
+
+		// 'stage' must outlive the profiler, in practice a string literal
+		static void Record(const char* stage, Clock::time_point start, Clock::time_point end);
+
+		// One entry per stage name over all threads, the most expensive in total first
+		static std::vector<StageStats> GetStats();
+		static void Reset();
+
+		// Chrome trace event format, loads in chrome://tracing and ui.perfetto.dev
+		static bool WriteTrace(const std::string& path);
+		static size_t GetEventCount();
+		// Events past the per-thread trace capacity, they still count in the stats
+		static size_t GetDroppedEventCount();
+	private:
+		static std::atomic<bool> m_Enabled;
+	};
+
+	class ProfileScope
+	{
+	public:
+		explicit ProfileScope(const char* stage) : m_Stage(Profiler::IsEnabled() ? stage : nullptr)
+		{
+			if (m_Stage)
+				m_Start = Profiler::Clock::now();
+		}
+
+		~ProfileScope()
+		{
+			if (m_Stage)
+				Profiler::Record(m_Stage, m_Start, Profiler::Clock::now());
+		}
+
+		ProfileScope(const ProfileScope&) = delete;
+		ProfileScope& operator=(const ProfileScope&) = delete;
+	private:
+		const char* m_Stage;
+		Profiler::Clock::time_point m_Start;
+	};
+}
+
+// Times the rest of the enclosing scope as 'stage'. Defining SS_DISABLE_PROFILING compiles the scopes out entirely.
+#ifndef SS_DISABLE_PROFILING
+#define SS_PROFILE_CONCAT_INNER(a, b) a##b
+#define SS_PROFILE_CONCAT(a, b) SS_PROFILE_CONCAT_INNER(a, b)
+#define SS_PROFILE_SCOPE(stage) ::SyncShapes::ProfileScope SS_PROFILE_CONCAT(profileScope, __LINE__)(stage)
+#else
+#define SS_PROFILE_SCOPE(stage) ((void)0)
+#endif
@@ -23,11 +23,11 @@ namespace SyncShapes
 			std::exit(EXIT_FAILURE);
 		}
 
-		// Enable vsync
-		glfwSwapInterval(1);
-
 		glfwMakeContextCurrent(m_Window);
 
+		// Enable vsync, it applies to the current context
+		glfwSwapInterval(1);
+
 		if (glewInit() != GLEW_OK) 
 		{
 			glfwTerminate();
@@ -46,6 +46,9 @@ namespace SyncShapes
 
 	Window::~Window()
 	{
+		// The UI owns GL textures, it has to go while the context still exists
+		m_ImGuiManager.reset();
+
 		glfwDestroyWindow(m_Window);
 		glfwTerminate();
 
@@ -54,10 +57,30 @@ namespace SyncShapes
 
 	void Window::Run()
 	{
+		int settleFrames = SettleFrameCount;
+
 		while (!glfwWindowShouldClose(m_Window))
 		{
-			// Poll for and process events
-			glfwPollEvents();
+			// Full rate while something animates, otherwise sleep until input, a job or a log line wakes the loop
+			if (glfwGetWindowAttrib(m_Window, GLFW_ICONIFIED)) {
+				glfwWaitEvents();
+				continue;
+			}
+
+			if (settleFrames > 0 || m_ImGuiManager->IsAnimating()) {
+				glfwPollEvents();
+			}
+			else {
+				double waitStart = glfwGetTime();
+				glfwWaitEventsTimeout(IdleTimeoutSeconds);
+
+				// A timeout only refreshes the frame once, an event gets the frames to settle
+				if (glfwGetTime() - waitStart < IdleTimeoutSeconds)
+					settleFrames = SettleFrameCount;
+			}
+
+			if (settleFrames > 0)
+				--settleFrames;
 
 			glClear(GL_COLOR_BUFFER_BIT);
 
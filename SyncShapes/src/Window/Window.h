@@ -23,6 +23,11 @@ namespace SyncShapes
 		const char* m_Title;
 		std::unique_ptr<ImGuiManager> m_ImGuiManager;
 
+		// Longest sleep of an idle window, a safety net for wake-ups nobody posted
+		static constexpr double IdleTimeoutSeconds = 1.0;
+		// Frames rendered after an event, ImGui reacts to some input (hover, layout) one frame late
+		static constexpr int SettleFrameCount = 3;
+
 		static void KeyCallback(GLFWwindow* window, int key, int scancode, int action, int mods);
 		static void FramebufferSizeCallback(GLFWwindow* window, int width, int height);
 	};
@@ -0,0 +1,134 @@
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#endif
+
+namespace SyncShapes
+{
+	Benchmark::Benchmark() {}
+	Benchmark::~Benchmark() {}
+
+	const StageResult& Benchmark::MeasureEach(const std::string& name, size_t items, const std::function<void(size_t item)>& run)
+	{
+		StageResult result;
+		result.name = name;
+		result.items = items;
+		result.samples.reserve(items);
+
+		for (size_t item = 0; item < items; ++item) {
+			auto startTime = std::chrono::high_resolution_clock::now();
+			run(item);
+			auto endTime = std::chrono::high_resolution_clock::now();
+
+			double elapsed = std::chrono::duration<double, std::milli>(endTime - startTime).count();
+			result.samples.push_back(elapsed);
+			result.totalMilliseconds += elapsed;
+		}
+
+		result.peakResidentBytes = GetPeakResidentBytes();
+		m_Results.push_back(std::move(result));
+
+		return m_Results.back();
+	}
+
+	const StageResult& Benchmark::MeasureBatch(const std::string& name, size_t items, const std::function<void()>& run)
+	{
+		StageResult result;
+		result.name = name;
+		result.items = items;
+
+		auto startTime = std::chrono::high_resolution_clock::now();
+		run();
+		auto endTime = std::chrono::high_resolution_clock::now();
+
+		result.totalMilliseconds = std::chrono::duration<double, std::milli>(endTime - startTime).count();
+		result.samples.push_back(result.totalMilliseconds);
+		result.peakResidentBytes = GetPeakResidentBytes();
+		m_Results.push_back(std::move(result));
+
+		return m_Results.back();
+	}
+
+	void Benchmark::PrintText(std::ostream& stream) const
+	{
+		char line[160];
+		std::snprintf(line, sizeof(line), "%-28s %8s %12s %10s %10s %10s %10s\n", "stage", "items", "items/s", "p50 ms", "p99 ms", "total ms", "peak MB");
+		stream << line;
+
+		for (const StageResult& result : m_Results) {
+			std::snprintf(line, sizeof(line), "%-28s %8zu %12.1f %10.3f %10.3f %10.1f %10.1f\n", result.name.c_str(), result.items, GetThroughput(result),
+				GetPercentile(result, 50.0), GetPercentile(result, 99.0), result.totalMilliseconds, result.peakResidentBytes / (1024.0 * 1024.0));
+			stream << line;
+		}
+
+		stream.flush();
+	}
+
+	void Benchmark::PrintJson(std::ostream& stream) const
+	{
+		char fields[256];
+
+		stream << "[";
+		for (size_t i = 0; i < m_Results.size(); ++i) {
+			const StageResult& result = m_Results[i];
+
+			// Stage names are fixed identifiers, nothing to escape
+			std::snprintf(fields, sizeof(fields), "\"items\":%zu,\"items_per_second\":%.6g,\"p50_ms\":%.6g,\"p99_ms\":%.6g,\"total_ms\":%.6g,\"peak_rss_bytes\":%zu",
+				result.items, GetThroughput(result), GetPercentile(result, 50.0), GetPercentile(result, 99.0), result.totalMilliseconds, result.peakResidentBytes);
+			stream << (i ? "," : "") << "{\"stage\":\"" << result.name << "\"," << fields << "}";
+		}
+		stream << "]";
+	}
+
+	double Benchmark::GetThroughput(const StageResult& result)
+	{
+		return result.totalMilliseconds > 0.0 ? result.items * 1000.0 / result.totalMilliseconds : 0.0;
+	}
+
+	double Benchmark::GetPercentile(const StageResult& result, double percentile)
+	{
+		if (result.samples.empty())
+			return 0.0;
+
+		// Nearest rank, so p99 of a small stage is its slowest sample rather than an interpolation
+		std::vector<double> samples = result.samples;
+		size_t rank = static_cast<size_t>(std::ceil(percentile / 100.0 * samples.size()));
+		size_t index = std::min(samples.size() - 1, rank == 0 ? 0 : rank - 1);
+
+		std::nth_element(samples.begin(), samples.begin() + index, samples.end());
+		return samples[index];
+	}
+
+	size_t Benchmark::GetPeakResidentBytes()
+	{
+#ifdef _WIN32
+		PROCESS_MEMORY_COUNTERS counters;
+		if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+			return counters.PeakWorkingSetSize;
+		return 0;
+#else
+		struct rusage usage;
+		if (getrusage(RUSAGE_SELF, &usage) != 0)
+			return 0;
+#ifdef __APPLE__
+		return static_cast<size_t>(usage.ru_maxrss);        // Bytes
+#else
+		return static_cast<size_t>(usage.ru_maxrss) * 1024; // Kilobytes
+#endif
+#endif
+	}
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace SyncShapes
+{
+	struct StageResult
+	{
+		std::string name;
+		size_t items = 0;
+		double totalMilliseconds = 0.0;
+		std::vector<double> samples;  // Milliseconds per measured call
+		size_t peakResidentBytes = 0; // Process peak after the stage, it only ever grows
+	};
+
+	// Times the pipeline stages and reports throughput, p50/p99 latency and peak RSS per stage
+	class Benchmark
+	{
+	public:
+		Benchmark();
+		~Benchmark();
+
+		// Calls 'run' once per item and records each call as a latency sample
+		const StageResult& MeasureEach(const std::string& name, size_t items, const std::function<void(size_t item)>& run);
+		// Times one call covering 'items' items, for stages that only exist as a whole (directory passes)
+		const StageResult& MeasureBatch(const std::string& name, size_t items, const std::function<void()>& run);
+
+		inline const std::vector<StageResult>& GetResults() const { return m_Results; }
+
+		void PrintText(std::ostream& stream) const;
+		void PrintJson(std::ostream& stream) const;
+
+		static double GetThroughput(const StageResult& result);
+		static double GetPercentile(const StageResult& result, double percentile);
+		static size_t GetPeakResidentBytes();
+	private:
+		std::vector<StageResult> m_Results;
+	};
+}
@@ -0,0 +1,349 @@
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "OpenCVImageProcessor/ImageProcessor.h"
+#include "OpenCVImageProcessor/GifDecoder.h"
+#include "FeatureIndex/HuDistance.h"
+#include "FeatureIndex/ShapeCascade.h"
+#include "Benchmark/Benchmark.h"
+#include "ShapeGenerator/ShapeGenerator.h"
+
+using namespace SyncShapes;
+
+namespace
+{
+	struct BenchmarkOptions
+	{
+		ShapeDatasetOptions dataset;
+		std::string outputDirectory = "bench-dataset";
+		size_t queryCount = 50;
+		int topK = 10;
+		int saveRepetitions = 5;
+		unsigned int threads = 0;
+		bool approximate = false;
+		std::string intermediateExtension = MaskCodec::Extension;
+		bool json = false;
+	};
+
+	void PrintUsage()
+	{
+		std::cerr <<
+			"Usage: SyncShapesBench [options]\n"
+			"\n"
+			"Generates a synthetic shape dataset and times every ImageProcessor stage on it.\n"
+			"\n"
+			"Options:\n"
+			"  --output <directory>   Dataset and scratch directory (default: bench-dataset, recreated on every run)\n"
+			"  --images <count>       Images in the dataset (default: 200)\n"
+			"  --width <pixels>       Image width (default: 256)\n"
+			"  --height <pixels>      Image height (default: 256)\n"
+			"  --shapes <count>       Shapes, and so contours, per image (default: 3)\n"
+			"  --seed <value>         Dataset seed (default: 1)\n"
+			"  --queries <count>      Retrieval queries (default: 50)\n"
+			"  --top <count>          Matches per query (default: 10)\n"
+			"  --threads <count>      Worker threads for the directory stages, 0 = one per hardware thread (default: 0)\n"
+			"  --approximate          Also time the HNSW index build and search\n"
+			"  --intermediate ssm|jpg Format of the converted images (default: ssm)\n"
+			"  --format text|json     Report format on stdout (default: text)\n";
+	}
+
+	bool ParseNumber(const std::string& text, unsigned long long minimum, unsigned long long& value)
+	{
+		try {
+			size_t parsed = 0;
+			value = std::stoull(text, &parsed);
+			return parsed == text.size() && text[0] != '-' && value >= minimum;
+		}
+		catch (const std::exception&) {
+			return false;
+		}
+	}
+
+	bool ParseOptions(int argc, char** argv, BenchmarkOptions& options)
+	{
+		for (int i = 1; i < argc; ++i) {
+			std::string option = argv[i];
+
+			if (option == "--approximate") {
+				options.approximate = true;
+				continue;
+			}
+
+			if (i + 1 >= argc) {
+				std::cerr << "Missing value for option " << option << std::endl;
+				return false;
+			}
+
+			std::string value = argv[++i];
+			unsigned long long number = 0;
+			bool valid = true;
+
+			if (option == "--output")
+				options.outputDirectory = value;
+			else if (option == "--intermediate") {
+				valid = value == "ssm" || value == "jpg";
+				options.intermediateExtension = "." + value;
+			}
+			else if (option == "--format") {
+				valid = value == "text" || value == "json";
+				options.json = value == "json";
+			}
+			else if (option == "--images" && (valid = ParseNumber(value, 1, number)))
+				options.dataset.imageCount = static_cast<size_t>(number);
+			else if (option == "--width" && (valid = ParseNumber(value, 16, number)))
+				options.dataset.width = static_cast<int>(number);
+			else if (option == "--height" && (valid = ParseNumber(value, 16, number)))
+				options.dataset.height = static_cast<int>(number);
+			else if (option == "--shapes" && (valid = ParseNumber(value, 1, number)))
+				options.dataset.shapesPerImage = static_cast<int>(number);
+			else if (option == "--seed" && (valid = ParseNumber(value, 0, number)))
+				options.dataset.seed = number;
+			else if (option == "--queries" && (valid = ParseNumber(value, 1, number)))
+				options.queryCount = static_cast<size_t>(number);
+			else if (option == "--top" && (valid = ParseNumber(value, 1, number)))
+				options.topK = static_cast<int>(number);
+			else if (option == "--threads" && (valid = ParseNumber(value, 0, number)))
+				options.threads = static_cast<unsigned int>(number);
+			else if (valid) {
+				std::cerr << "Unknown option: " << option << std::endl;
+				return false;
+			}
+
+			if (!valid) {
+				std::cerr << "Invalid value for " << option << ": " << value << std::endl;
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	// Share of the exact top K names found by another retrieval path, averaged over the queries
+	double GetRecall(const std::vector<std::vector<std::pair<std::string, double>>>& exact, const std::vector<std::vector<std::pair<std::string, double>>>& candidate)
+	{
+		size_t expected = 0;
+		size_t found = 0;
+		for (size_t query = 0; query < exact.size() && query < candidate.size(); ++query) {
+			for (const auto& match : exact[query]) {
+				++expected;
+				for (const auto& other : candidate[query])
+					found += other.first == match.first ? 1 : 0;
+			}
+		}
+
+		return expected > 0 ? static_cast<double>(found) / expected : 1.0;
+	}
+
+	// Each in-memory filter stage starts from the same decoded images, copied outside the timed region
+	std::vector<cv::Mat> CloneImages(const std::vector<cv::Mat>& images)
+	{
+		std::vector<cv::Mat> copies;
+		copies.reserve(images.size());
+		for (const cv::Mat& image : images)
+			copies.push_back(image.clone());
+
+		return copies;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	BenchmarkOptions options;
+	if (!ParseOptions(argc, argv, options)) {
+		PrintUsage();
+		return 2;
+	}
+
+	ImageProcessor::m_WorkerCount = options.threads;
+	ImageProcessor::m_IntermediateExtension = options.intermediateExtension;
+
+	// Start from an empty directory, so the extraction stage never reuses features of an earlier run
+	fs::path gifDirectory = fs::path(options.outputDirectory);
+	fs::remove_all(gifDirectory);
+
+	size_t generated = ShapeGenerator::GenerateDataset(gifDirectory.string(), options.dataset);
+	if (generated != options.dataset.imageCount) {
+		std::cerr << "Failed to generate the synthetic dataset in: " << gifDirectory.string() << std::endl;
+		return 1;
+	}
+
+	Benchmark benchmark;
+
+	// Conversion, in memory and to the intermediate files
+	std::vector<std::string> gifFiles = ImageProcessor::CollectFiles(gifDirectory.string(), GifDecoder::Extension);
+	benchmark.MeasureEach("gif_decode", gifFiles.size(), [&](size_t item) {
+		cv::Mat image;
+		std::string error;
+		GifDecoder::Decode(gifFiles[item], image, error);
+		});
+
+	std::string intermediateDirectory = ImageProcessor::GetPreprocessingDirectory(gifDirectory.string());
+	fs::create_directories(intermediateDirectory);
+	benchmark.MeasureEach("gif_conversion", gifFiles.size(), [&](size_t item) {
+		ImageProcessor::ConvertGIFToIntermediate(gifFiles[item]);
+		});
+	std::vector<std::string> intermediateFiles = ImageProcessor::CollectFiles(intermediateDirectory, ImageProcessor::m_IntermediateExtension);
+
+	std::vector<cv::Mat> images(intermediateFiles.size());
+	std::vector<std::string> imageNames;
+	size_t intermediateBytes = 0;
+	for (const std::string& path : intermediateFiles) {
+		imageNames.push_back(fs::path(path).stem().string());
+		intermediateBytes += static_cast<size_t>(fs::file_size(path));
+	}
+
+	benchmark.MeasureEach("decode_intermediate", intermediateFiles.size(), [&](size_t item) { images[item] = ImageProcessor::DecodeImage(intermediateFiles[item]); });
+
+	// Pre-processing, one call per decoded image
+	std::vector<cv::Mat> working = CloneImages(images);
+	benchmark.MeasureEach("noise_removal", working.size(), [&](size_t item) { ImageProcessor::ApplyNoiseRemoval(working[item]); });
+	working = CloneImages(images);
+	benchmark.MeasureEach("hole_filling", working.size(), [&](size_t item) { ImageProcessor::ApplyHoleFilling(working[item]); });
+	working = CloneImages(images);
+	benchmark.MeasureEach("histogram_equalization", working.size(), [&](size_t item) { ImageProcessor::ApplyHistogramEqualization(working[item]); });
+	working = CloneImages(images);
+	benchmark.MeasureEach("contour_area_filtering", working.size(), [&](size_t item) { ImageProcessor::ApplyContourAreaFiltering(working[item], 300); });
+	working.clear();
+
+	// Directory pass on the worker pool, including decode and encode
+	benchmark.MeasureBatch("noise_removal_directory", intermediateFiles.size(), [&] { ImageProcessor::ApplyNoiseRemovalToDirectory(intermediateDirectory); });
+
+	// Feature extraction
+	std::unordered_map<std::string, FeatureData> allFeatures;
+	size_t contourCount = 0;
+	benchmark.MeasureEach("extract_features", images.size(), [&](size_t item) {
+		ImageProcessor::ExtractShapeFeatures(images[item], allFeatures[imageNames[item]]);
+		});
+	for (const auto& entry : allFeatures)
+		contourCount += entry.second.shapeFeatures.size();
+
+	// The directory pass above left its outputs in the image cache, start cold so the stage still includes the decode
+	ImageProcessor::m_ImageCache.Clear();
+	benchmark.MeasureBatch("extract_directory", intermediateFiles.size(), [&] { ImageProcessor::ExtractShapeFeaturesAndSave(intermediateDirectory); });
+	benchmark.MeasureBatch("extract_directory_unchanged", intermediateFiles.size(), [&] { ImageProcessor::ExtractShapeFeaturesAndSave(intermediateDirectory); });
+
+	// Fresh dataset ingest straight from the GIFs, nothing written but the index
+	IngestOptions ingestOptions;
+	benchmark.MeasureBatch("gif_ingest", gifFiles.size(), [&] { ImageProcessor::IngestGIFDirectory(gifDirectory.string(), ingestOptions, false); });
+
+	std::string storePath = (gifDirectory / "bench_features.dat").string();
+	benchmark.MeasureEach("save_features", static_cast<size_t>(options.saveRepetitions), [&](size_t) {
+		ImageProcessor::SaveFeaturesToFile(storePath, allFeatures);
+		});
+
+	benchmark.MeasureBatch("load_features", 1, [&] { ImageProcessor::LoadFeaturesFromFile(storePath); });
+
+	// Retrieval, queries cycle through the dataset
+	size_t queryCount = imageNames.empty() ? 0 : options.queryCount;
+	std::vector<std::string> queryNames;
+	for (size_t query = 0; query < queryCount; ++query)
+		queryNames.push_back(imageNames[(query * 7919) % imageNames.size()]);
+
+	benchmark.MeasureEach("retrieve", queryNames.size(), [&](size_t item) { ImageProcessor::RetrieveImages(queryNames[item], options.topK); });
+	benchmark.MeasureBatch("retrieve_batch", queryNames.size(), [&] { ImageProcessor::RetrieveImagesBatch(queryNames, options.topK); });
+
+	// Compressed first pass with exact re-ranking, recall is measured against the exact scan
+	auto exactMatches = ImageProcessor::RetrieveImagesBatch(queryNames, options.topK);
+	std::map<std::string, double> recall;
+	std::map<std::string, size_t> compressedBytes;
+	for (FeatureCompression compression : { FeatureCompression::Float32, FeatureCompression::Int8 }) {
+		std::string name = QuantizedMatrix::GetName(compression);
+		ImageProcessor::m_FeatureCompression = compression;
+		benchmark.MeasureBatch("compress_" + name, ImageProcessor::m_FeatureMatrix.GetContourCount(), [&] { ImageProcessor::UpdateCompressedFeatures(); });
+
+		std::vector<std::vector<std::pair<std::string, double>>> compressedMatches;
+		benchmark.MeasureBatch("retrieve_batch_" + name, queryNames.size(), [&] { compressedMatches = ImageProcessor::RetrieveImagesBatch(queryNames, options.topK); });
+		recall[name] = GetRecall(exactMatches, compressedMatches);
+		compressedBytes[name] = ImageProcessor::m_CompressedFeatures.GetByteSize();
+	}
+	ImageProcessor::m_FeatureCompression = FeatureCompression::None;
+	ImageProcessor::UpdateCompressedFeatures();
+
+	// Descriptor prefilter ahead of the exact scan, with the share of query/image pairs it never scores
+	std::map<std::string, double> cascadeRecall;
+	std::map<std::string, double> cascadeRejected;
+	const ShapeDescriptor* descriptors = ImageProcessor::m_FeatureMatrix.GetDescriptors();
+	for (double tolerance : { 0.25, 0.5 }) {
+		std::string name = "cascade_" + std::to_string(tolerance).substr(0, 4);
+		ImageProcessor::m_CascadeTolerance = tolerance;
+
+		std::vector<std::vector<std::pair<std::string, double>>> cascadeMatches;
+		benchmark.MeasureBatch("retrieve_batch_" + name, queryNames.size(), [&] { cascadeMatches = ImageProcessor::RetrieveImagesBatch(queryNames, options.topK); });
+		cascadeRecall[name] = GetRecall(exactMatches, cascadeMatches);
+
+		size_t rejected = 0;
+		size_t imageCount = ImageProcessor::m_FeatureMatrix.GetImageCount();
+		for (const std::string& queryName : queryNames) {
+			size_t queryImage = ImageProcessor::m_FeatureMatrix.FindImage(queryName);
+			for (size_t image = 0; descriptors && queryImage != FeatureMatrix::NotFound && image < imageCount; ++image)
+				rejected += ShapeCascade::Accepts(descriptors[queryImage], descriptors[image], tolerance) ? 0 : 1;
+		}
+		cascadeRejected[name] = queryNames.empty() || imageCount == 0 ? 0.0 : static_cast<double>(rejected) / (queryNames.size() * imageCount);
+	}
+	ImageProcessor::m_CascadeTolerance = 1.0;
+
+	// Cluster-pruned search, with the share of images each query still scores
+	// The persisted index sits next to the loaded store, it is removed so every run trains from scratch
+	ImageProcessor::m_UseClusterIndex = true;
+	benchmark.MeasureBatch("cluster_index_build", ImageProcessor::m_FeatureMatrix.GetContourCount(), [&] {
+		fs::remove(fs::path(ImageProcessor::m_FeatureExtractionDir) / "output_features.ivf");
+		ImageProcessor::UpdateClusterIndex();
+		});
+
+	std::vector<std::vector<std::pair<std::string, double>>> clusteredMatches;
+	benchmark.MeasureBatch("retrieve_batch_clustered", queryNames.size(), [&] { clusteredMatches = ImageProcessor::RetrieveImagesBatch(queryNames, options.topK); });
+	double clusteredRecall = GetRecall(exactMatches, clusteredMatches);
+
+	double clusteredScanned = 0.0;
+	for (const std::string& queryName : queryNames) {
+		size_t queryImage = ImageProcessor::m_FeatureMatrix.FindImage(queryName);
+		if (queryImage == FeatureMatrix::NotFound || ImageProcessor::m_FeatureMatrix.GetImageCount() == 0)
+			continue;
+
+		size_t candidates = ImageProcessor::m_ClusterIndex.FindCandidates(ImageProcessor::m_FeatureMatrix.GetImageContours(queryImage), ImageProcessor::m_FeatureMatrix.GetContourCount(queryImage),
+			ImageProcessor::m_ClusterIndex.GetParameters().probeCount).size();
+		clusteredScanned += static_cast<double>(candidates) / ImageProcessor::m_FeatureMatrix.GetImageCount();
+	}
+	clusteredScanned = queryNames.empty() ? 0.0 : clusteredScanned / queryNames.size();
+	ImageProcessor::m_UseClusterIndex = false;
+
+	if (options.approximate) {
+		ImageProcessor::m_UseApproximateIndex = true;
+		benchmark.MeasureBatch("approximate_index_build", ImageProcessor::m_FeatureMatrix.GetContourCount(), [&] { ImageProcessor::UpdateApproximateIndex(); });
+		benchmark.MeasureEach("retrieve_approximate", queryNames.size(), [&](size_t item) { ImageProcessor::RetrieveImages(queryNames[item], options.topK); });
+	}
+
+	unsigned int workerCount = BatchExecutor::ResolveWorkerCount(options.threads);
+	if (options.json) {
+		std::cout << "{\"images\":" << options.dataset.imageCount << ",\"width\":" << options.dataset.width << ",\"height\":" << options.dataset.height
+			<< ",\"shapes_per_image\":" << options.dataset.shapesPerImage << ",\"seed\":" << options.dataset.seed << ",\"contours\":" << contourCount
+			<< ",\"intermediate\":\"" << options.intermediateExtension << "\",\"intermediate_bytes\":" << intermediateBytes << ",\"threads\":" << workerCount << ",\"distance_kernel\":\"" << HuDistance::GetKernelName() << "\",\"compression\":{";
+		for (auto it = recall.begin(); it != recall.end(); ++it)
+			std::cout << (it == recall.begin() ? "" : ",") << "\"" << it->first << "\":{\"recall_at_k\":" << it->second << ",\"bytes\":" << compressedBytes[it->first] << "}";
+		std::cout << "},\"cascade\":{";
+		for (auto it = cascadeRecall.begin(); it != cascadeRecall.end(); ++it)
+			std::cout << (it == cascadeRecall.begin() ? "" : ",") << "\"" << it->first << "\":{\"recall_at_k\":" << it->second << ",\"rejected\":" << cascadeRejected[it->first] << "}";
+		std::cout << "},\"clustered\":{\"clusters\":" << ImageProcessor::m_ClusterIndex.GetClusterCount() << ",\"probes\":" << ImageProcessor::m_ClusterIndex.GetParameters().probeCount
+			<< ",\"recall_at_k\":" << clusteredRecall << ",\"scanned\":" << clusteredScanned << "},\"stages\":";
+		benchmark.PrintJson(std::cout);
+		std::cout << "}" << std::endl;
+	}
+	else {
+		std::cout << "Dataset: " << options.dataset.imageCount << " images, " << options.dataset.width << "x" << options.dataset.height << ", "
+			<< options.dataset.shapesPerImage << " shapes per image, seed " << options.dataset.seed << ", " << contourCount << " contours\n";
+		std::cout << "Intermediates: " << options.intermediateExtension << ", " << intermediateBytes << " bytes\n";
+		std::cout << "Threads: " << workerCount << ", distance kernel: " << HuDistance::GetKernelName() << "\n";
+		for (const auto& entry : recall)
+			std::cout << "Compression " << entry.first << ": " << compressedBytes[entry.first] << " bytes, recall@" << options.topK << " " << entry.second << "\n";
+		for (const auto& entry : cascadeRecall)
+			std::cout << "Prefilter " << entry.first << ": " << cascadeRejected[entry.first] << " of images skipped, recall@" << options.topK << " " << entry.second << "\n";
+		std::cout << "Clusters: " << ImageProcessor::m_ClusterIndex.GetClusterCount() << ", " << ImageProcessor::m_ClusterIndex.GetParameters().probeCount << " probed per contour, "
+			<< clusteredScanned << " of images scored, recall@" << options.topK << " " << clusteredRecall << "\n";
+		std::cout << "\n";
+		benchmark.PrintText(std::cout);
+	}
+
+	return 0;
+}
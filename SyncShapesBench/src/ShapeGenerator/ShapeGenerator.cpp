@@ -0,0 +1,137 @@
+#include "ShapeGenerator.h"
+
+#include <FreeImage.h>
+
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace SyncShapes
+{
+	static const double Pi = 3.14159265358979323846;
+
+	cv::Mat ShapeGenerator::GenerateImage(const ShapeDatasetOptions& options, size_t index)
+	{
+		std::mt19937_64 random(options.seed * 0x9E3779B97F4A7C15ull + index);
+
+		cv::Mat image(options.height, options.width, CV_8UC1, cv::Scalar(0));
+
+		// One grid cell per shape keeps the shapes apart, so every shape is one external contour
+		int columns = static_cast<int>(std::ceil(std::sqrt(static_cast<double>(options.shapesPerImage))));
+		int rows = (options.shapesPerImage + columns - 1) / columns;
+		int cellWidth = options.width / columns;
+		int cellHeight = options.height / rows;
+
+		for (int shape = 0; shape < options.shapesPerImage; ++shape) {
+			cv::Rect cell((shape % columns) * cellWidth, (shape / columns) * cellHeight, cellWidth, cellHeight);
+			ShapeKind kind = static_cast<ShapeKind>(UniformInt(random, 0, 2));
+			DrawShape(image, random, kind, cell);
+		}
+
+		return image;
+	}
+
+	size_t ShapeGenerator::GenerateDataset(const std::string& directoryPath, const ShapeDatasetOptions& options)
+	{
+		fs::create_directories(directoryPath);
+
+		FreeImage_Initialise();
+
+		size_t written = 0;
+		for (size_t index = 0; index < options.imageCount; ++index) {
+			char fileName[32];
+			std::snprintf(fileName, sizeof(fileName), "image_%05zu.gif", index);
+
+			std::string path = (fs::path(directoryPath) / fileName).string();
+			if (SaveGIF(path, GenerateImage(options, index)))
+				++written;
+			else
+				std::cerr << "Failed to write the synthetic image: " << path << std::endl;
+		}
+
+		FreeImage_DeInitialise();
+
+		return written;
+	}
+
+	void ShapeGenerator::DrawShape(cv::Mat& image, std::mt19937_64& random, ShapeKind kind, const cv::Rect& cell)
+	{
+		// Leave a margin so neighbouring shapes never touch
+		double maxRadius = 0.4 * std::min(cell.width, cell.height);
+		double minRadius = 0.35 * maxRadius;
+		cv::Point center(cell.x + cell.width / 2 + UniformInt(random, -cell.width / 20, cell.width / 20),
+			cell.y + cell.height / 2 + UniformInt(random, -cell.height / 20, cell.height / 20));
+
+		switch (kind) {
+		case ShapeKind::Ellipse: {
+			cv::Size axes(static_cast<int>(Uniform(random, minRadius, maxRadius)), static_cast<int>(Uniform(random, minRadius, maxRadius)));
+			cv::ellipse(image, center, axes, Uniform(random, 0.0, 180.0), 0.0, 360.0, cv::Scalar(255), cv::FILLED);
+			break;
+		}
+		case ShapeKind::Polygon: {
+			// Vertices at increasing angles around the center give a simple (non self-intersecting) polygon
+			int vertexCount = UniformInt(random, 3, 9);
+			double angle = Uniform(random, 0.0, 2.0 * Pi);
+			std::vector<std::vector<cv::Point>> polygon(1);
+
+			for (int vertex = 0; vertex < vertexCount; ++vertex) {
+				angle += 2.0 * Pi / vertexCount * Uniform(random, 0.6, 1.4);
+				double radius = Uniform(random, minRadius, maxRadius);
+				polygon[0].emplace_back(center.x + static_cast<int>(radius * std::cos(angle)), center.y + static_cast<int>(radius * std::sin(angle)));
+			}
+
+			cv::fillPoly(image, polygon, cv::Scalar(255));
+			break;
+		}
+		case ShapeKind::Blob: {
+			// Radius modulated by a few low-frequency harmonics, a smooth star-shaped outline
+			const int pointCount = 96;
+			double baseRadius = Uniform(random, minRadius, 0.75 * maxRadius);
+			double amplitudes[3], phases[3];
+			for (int harmonic = 0; harmonic < 3; ++harmonic) {
+				amplitudes[harmonic] = Uniform(random, 0.0, 0.25 * baseRadius / (harmonic + 1));
+				phases[harmonic] = Uniform(random, 0.0, 2.0 * Pi);
+			}
+
+			std::vector<std::vector<cv::Point>> outline(1);
+			for (int point = 0; point < pointCount; ++point) {
+				double angle = 2.0 * Pi * point / pointCount;
+				double radius = baseRadius;
+				for (int harmonic = 0; harmonic < 3; ++harmonic)
+					radius += amplitudes[harmonic] * std::sin((harmonic + 2) * angle + phases[harmonic]);
+
+				outline[0].emplace_back(center.x + static_cast<int>(radius * std::cos(angle)), center.y + static_cast<int>(radius * std::sin(angle)));
+			}
+
+			cv::fillPoly(image, outline, cv::Scalar(255));
+			break;
+		}
+		}
+	}
+
+	bool ShapeGenerator::SaveGIF(const std::string& path, const cv::Mat& image)
+	{
+		// 8-bit raw bits get a grayscale palette, which GIF can store directly
+		FIBITMAP* bitmap = FreeImage_ConvertFromRawBits(const_cast<BYTE*>(image.ptr()), image.cols, image.rows, static_cast<int>(image.step), 8, 0, 0, 0, 1);
+		if (!bitmap)
+			return false;
+
+		bool saved = FreeImage_Save(FIF_GIF, bitmap, path.c_str(), GIF_DEFAULT) != 0;
+		FreeImage_Unload(bitmap);
+
+		return saved;
+	}
+
+	double ShapeGenerator::Uniform(std::mt19937_64& random, double low, double high)
+	{
+		return low + (high - low) * static_cast<double>(random() >> 11) * (1.0 / 9007199254740992.0);
+	}
+
+	int ShapeGenerator::UniformInt(std::mt19937_64& random, int low, int high)
+	{
+		return low + static_cast<int>(random() % static_cast<uint64_t>(high - low + 1));
+	}
+}
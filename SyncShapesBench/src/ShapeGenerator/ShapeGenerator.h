@@ -0,0 +1,43 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+
+#include <cstdint>
+#include <random>
+#include <string>
+
+namespace SyncShapes
+{
+	struct ShapeDatasetOptions
+	{
+		size_t imageCount = 200;
+		int width = 256;
+		int height = 256;
+		int shapesPerImage = 3;
+		uint64_t seed = 1;
+	};
+
+	// Reproducible synthetic datasets of white shapes (polygons, ellipses and blobs) on a black background.
+	// Image i depends only on (seed, i, options), the same options produce the same files on every platform.
+	class ShapeGenerator
+	{
+	public:
+		enum class ShapeKind
+		{
+			Polygon,
+			Ellipse,
+			Blob
+		};
+
+		static cv::Mat GenerateImage(const ShapeDatasetOptions& options, size_t index);
+		// Writes image_00000.gif ... to 'directoryPath', returns the number of files written
+		static size_t GenerateDataset(const std::string& directoryPath, const ShapeDatasetOptions& options);
+	private:
+		static void DrawShape(cv::Mat& image, std::mt19937_64& random, ShapeKind kind, const cv::Rect& cell);
+		static bool SaveGIF(const std::string& path, const cv::Mat& image);
+
+		// std distributions differ between standard libraries, these only use the engine output, which is fully specified
+		static double Uniform(std::mt19937_64& random, double low, double high);
+		static int UniformInt(std::mt19937_64& random, int low, int high);
+	};
+}
@@ -0,0 +1,518 @@
+#include <algorithm>
+#include <iostream>
+#include <chrono>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "OpenCVImageProcessor/ImageProcessor.h"
+#include "Profiler/Profiler.h"
+#include "ReportWriter/ReportWriter.h"
+
+using namespace SyncShapes;
+
+namespace
+{
+	struct CommandLine
+	{
+		std::string command;
+		std::vector<std::string> arguments;
+		std::map<std::string, std::string> options;
+	};
+
+	// Options that are switches, every other option takes the next argument as its value
+	const char* const FlagOptions[] = { "--fused", "--write-preprocessed", "--write-converted", "--text", "--approximate", "--clusters", "--exclude-self" };
+
+	void PrintUsage()
+	{
+		std::cerr <<
+			"Usage: SyncShapesCLI <command> [arguments] [options]\n"
+			"\n"
+			"Commands:\n"
+			"  convert <gif-directory>             Convert GIFs to grayscale intermediates in <gif-directory>/pre-processing\n"
+			"  ingest <gif-directory>              Decode the GIFs in memory, pre-process and extract in one pass,\n"
+			"                                      the index goes to <gif-directory>/pre-processing/feature-extraction\n"
+			"      --steps noise,holes,equalize,area|all   Pre-processing steps (default: all)\n"
+			"      --write-converted               Also write the converted intermediates, as convert would\n"
+			"      --write-preprocessed            Save the pre-processed images to <gif-directory>/pre-processing/preprocessed\n"
+			"      --text                          Also export output_features.txt\n"
+			"  preprocess <directory>              Apply pre-processing to the intermediates of <directory>\n"
+			"      --steps all|noise,holes,equalize,area   (default: all, applied in place)\n"
+			"  extract <directory>                 Extract Hu moment features to <directory>/feature-extraction\n"
+			"      --fused                         Pre-process and extract in one in-memory pass\n"
+			"      --steps noise,holes,equalize,area|all   Steps of the fused pass (default: all)\n"
+			"      --write-preprocessed            Save the fused pass images to <directory>/preprocessed\n"
+			"      --text                          Also export output_features.txt\n"
+			"  query <output_features.dat> <image>...  Retrieve the images most similar to each query image\n"
+			"      --top <count>                   Matches per query (default: 5)\n"
+			"      --approximate                   Use the HNSW index instead of the exact scan\n"
+			"      --ef <count>                    HNSW search candidates (default: 64)\n"
+			"      --clusters                      Search only the k-means clusters nearest to the query contours (IVF)\n"
+			"      --probes <count>                Clusters searched per query contour (default: 4)\n"
+			"      --cluster-count <count>         Clusters of the index, 0 = square root of the contour count (default: 0)\n"
+			"      --exclude-self                  Leave the query image out of its own results\n"
+			"      --compression none|float32|int8 Scan compact features first, re-rank the best at full precision (default: none)\n"
+			"      --rerank <factor>               Candidates re-ranked per match after a compressed scan (default: 4)\n"
+			"      --cascade <tolerance>           Skip images whose shape descriptors differ from the query's by more than\n"
+			"                                      this relative amount, 0-1 (default: 1, no prefilter)\n"
+			"      --datasets <store>,<store>...   Also search these feature stores, every store is a shard searched in parallel\n"
+			"                                      and matches are named <dataset>/<image>\n"
+			"\n"
+			"Options:\n"
+			"  --threads <count>                   Worker threads, 0 = one per hardware thread (default: 0)\n"
+			"  --format text|json                  Result and timing output on stdout (default: text)\n"
+			"  --intermediate ssm|jpg              Format of the pre-processing images, lossless masks or JPEG (default: ssm)\n"
+			"  --profile <trace.json>              Time every pipeline stage, add the stats to the report and write a Chrome trace\n";
+	}
+
+	bool IsFlag(const std::string& option)
+	{
+		for (const char* flag : FlagOptions) {
+			if (option == flag)
+				return true;
+		}
+
+		return false;
+	}
+
+	bool ParseCommandLine(int argc, char** argv, CommandLine& commandLine)
+	{
+		if (argc < 2)
+			return false;
+
+		commandLine.command = argv[1];
+
+		for (int i = 2; i < argc; ++i) {
+			std::string argument = argv[i];
+
+			if (argument.rfind("--", 0) != 0) {
+				commandLine.arguments.push_back(argument);
+			}
+			else if (IsFlag(argument)) {
+				commandLine.options[argument] = "1";
+			}
+			else if (i + 1 < argc) {
+				commandLine.options[argument] = argv[++i];
+			}
+			else {
+				std::cerr << "Missing value for option " << argument << std::endl;
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	bool ParseCount(const CommandLine& commandLine, const std::string& option, int defaultValue, int& value)
+	{
+		auto it = commandLine.options.find(option);
+		if (it == commandLine.options.end()) {
+			value = defaultValue;
+			return true;
+		}
+
+		try {
+			size_t parsed = 0;
+			value = std::stoi(it->second, &parsed);
+			if (parsed == it->second.size() && value >= 0)
+				return true;
+		}
+		catch (const std::exception&) {}
+
+		std::cerr << "Invalid value for " << option << ": " << it->second << std::endl;
+		return false;
+	}
+
+	bool ParseFraction(const CommandLine& commandLine, const std::string& option, double defaultValue, double& value)
+	{
+		auto it = commandLine.options.find(option);
+		if (it == commandLine.options.end()) {
+			value = defaultValue;
+			return true;
+		}
+
+		try {
+			size_t parsed = 0;
+			value = std::stod(it->second, &parsed);
+			if (parsed == it->second.size() && value >= 0.0 && value <= 1.0)
+				return true;
+		}
+		catch (const std::exception&) {}
+
+		std::cerr << "Invalid value for " << option << ": " << it->second << std::endl;
+		return false;
+	}
+
+	bool ParseSteps(const CommandLine& commandLine, IngestOptions& options)
+	{
+		auto it = commandLine.options.find("--steps");
+		if (it == commandLine.options.end() || it->second == "all")
+			return true;
+
+		options.noiseRemoval = options.holeFilling = options.histogramEqualization = options.contourAreaFiltering = false;
+
+		std::stringstream steps(it->second);
+		std::string step;
+		while (std::getline(steps, step, ',')) {
+			if (step == "noise")
+				options.noiseRemoval = true;
+			else if (step == "holes")
+				options.holeFilling = true;
+			else if (step == "equalize")
+				options.histogramEqualization = true;
+			else if (step == "area")
+				options.contourAreaFiltering = true;
+			else {
+				std::cerr << "Unknown pre-processing step: " << step << std::endl;
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	double MillisecondsSince(std::chrono::high_resolution_clock::time_point startTime)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+	}
+
+	int RunConvert(const CommandLine& commandLine, ReportWriter& report)
+	{
+		if (commandLine.arguments.size() != 1)
+			return -1;
+
+		// ConvertAllGIFs scans the parent of the path it is given, the trailing separator makes that the directory itself
+		std::string directoryPath = (fs::path(commandLine.arguments[0]) / "").string();
+
+		auto startTime = std::chrono::high_resolution_clock::now();
+		BatchReport batch = ImageProcessor::ConvertAllGIFs(directoryPath);
+		double elapsed = MillisecondsSince(startTime);
+
+		report.Add("output", ImageProcessor::m_PreprocessingDir);
+		report.Add("gif_count", batch.total);
+		report.Add("converted_count", batch.succeeded);
+		report.AddBatchReport("batch", batch);
+		report.Add("elapsed_ms", elapsed);
+
+		return !ImageProcessor::m_PreprocessingDir.empty() && batch.failures.empty() ? 0 : 1;
+	}
+
+	int RunIngest(const CommandLine& commandLine, ReportWriter& report)
+	{
+		if (commandLine.arguments.size() != 1)
+			return -1;
+
+		IngestOptions options;
+		if (!ParseSteps(commandLine, options))
+			return -1;
+
+		options.writeIntermediates = commandLine.options.count("--write-preprocessed") != 0;
+		ImageProcessor::m_ExportFeaturesAsText = commandLine.options.count("--text") != 0;
+		bool writeConverted = commandLine.options.count("--write-converted") != 0;
+
+		auto startTime = std::chrono::high_resolution_clock::now();
+		FeatureUpdateReport update = ImageProcessor::IngestGIFDirectory(commandLine.arguments[0], options, writeConverted);
+		double elapsed = MillisecondsSince(startTime);
+
+		report.Add("output", (fs::path(ImageProcessor::m_FeatureExtractionDir) / "output_features.dat").string());
+		report.Add("extracted", update.extracted);
+		report.Add("reused", update.reused);
+		report.Add("removed", update.removed);
+		report.Add("contours", ImageProcessor::m_FeatureMatrix.GetContourCount());
+		report.AddBatchReport("batch", update.batch);
+		report.Add("elapsed_ms", elapsed);
+
+		return !ImageProcessor::m_FeatureExtractionDir.empty() && update.batch.failures.empty() ? 0 : 1;
+	}
+
+	int RunPreprocess(const CommandLine& commandLine, ReportWriter& report)
+	{
+		if (commandLine.arguments.size() != 1)
+			return -1;
+
+		IngestOptions steps;
+		if (!ParseSteps(commandLine, steps))
+			return -1;
+
+		const std::string& directoryPath = commandLine.arguments[0];
+		bool allSteps = steps.noiseRemoval && steps.holeFilling && steps.histogramEqualization && steps.contourAreaFiltering;
+		bool failed = false;
+
+		auto runStep = [&](const std::string& name, const std::function<BatchReport()>& step) {
+			auto startTime = std::chrono::high_resolution_clock::now();
+			BatchReport batch = step();
+			report.Add(name + "_ms", MillisecondsSince(startTime));
+			report.AddBatchReport(name, batch);
+			failed |= !batch.failures.empty();
+		};
+
+		// Same split as the Editor: all steps run as one in-place pass, single steps write to their own subdirectory
+		if (allSteps) {
+			runStep("all", [&] { return ImageProcessor::ApplyAllToDirectory(directoryPath); });
+		}
+		else {
+			if (steps.noiseRemoval)
+				runStep("noise_removal", [&] { return ImageProcessor::ApplyNoiseRemovalToDirectory(directoryPath); });
+			if (steps.holeFilling)
+				runStep("hole_filling", [&] { return ImageProcessor::ApplyHoleFillingToDirectory(directoryPath); });
+			if (steps.histogramEqualization)
+				runStep("histogram_equalization", [&] { return ImageProcessor::ApplyHistogramEqualizationToDirectory(directoryPath); });
+			if (steps.contourAreaFiltering)
+				runStep("contour_area_filtering", [&] { return ImageProcessor::ApplyContourAreaFilteringToDirectory(directoryPath, steps.minContourArea); });
+		}
+
+		return failed ? 1 : 0;
+	}
+
+	int RunExtract(const CommandLine& commandLine, ReportWriter& report)
+	{
+		if (commandLine.arguments.size() != 1)
+			return -1;
+
+		IngestOptions options;
+		if (!ParseSteps(commandLine, options))
+			return -1;
+
+		options.writeIntermediates = commandLine.options.count("--write-preprocessed") != 0;
+		ImageProcessor::m_ExportFeaturesAsText = commandLine.options.count("--text") != 0;
+
+		bool fused = commandLine.options.count("--fused") != 0;
+		const std::string& directoryPath = commandLine.arguments[0];
+
+		auto startTime = std::chrono::high_resolution_clock::now();
+		FeatureUpdateReport update = fused ? ImageProcessor::IngestDirectory(directoryPath, options) : ImageProcessor::ExtractShapeFeaturesAndSave(directoryPath);
+		double elapsed = MillisecondsSince(startTime);
+
+		report.Add("mode", fused ? "fused" : "extract");
+		report.Add("output", (fs::path(ImageProcessor::m_FeatureExtractionDir) / "output_features.dat").string());
+		report.Add("extracted", update.extracted);
+		report.Add("reused", update.reused);
+		report.Add("removed", update.removed);
+		report.Add("contours", ImageProcessor::m_FeatureMatrix.GetContourCount());
+		report.AddBatchReport("batch", update.batch);
+		report.Add("elapsed_ms", elapsed);
+
+		return update.batch.failures.empty() ? 0 : 1;
+	}
+
+	int RunQuery(const CommandLine& commandLine, ReportWriter& report)
+	{
+		if (commandLine.arguments.size() < 2)
+			return -1;
+
+		int topK = 0;
+		int ef = 0;
+		int rerankFactor = 0;
+		int probeCount = 0;
+		int clusterCount = 0;
+		double cascadeTolerance = 1.0;
+		if (!ParseCount(commandLine, "--top", 5, topK) || !ParseCount(commandLine, "--ef", 64, ef) || !ParseCount(commandLine, "--rerank", 4, rerankFactor)
+			|| !ParseCount(commandLine, "--probes", 4, probeCount) || !ParseCount(commandLine, "--cluster-count", 0, clusterCount)
+			|| !ParseFraction(commandLine, "--cascade", 1.0, cascadeTolerance))
+			return -1;
+
+		auto compressionOption = commandLine.options.find("--compression");
+		if (compressionOption != commandLine.options.end()) {
+			if (compressionOption->second == "float32")
+				ImageProcessor::m_FeatureCompression = FeatureCompression::Float32;
+			else if (compressionOption->second == "int8")
+				ImageProcessor::m_FeatureCompression = FeatureCompression::Int8;
+			else if (compressionOption->second != "none") {
+				std::cerr << "Unknown compression: " << compressionOption->second << std::endl;
+				return -1;
+			}
+		}
+		ImageProcessor::m_RerankFactor = static_cast<size_t>(std::max(1, rerankFactor));
+		ImageProcessor::m_CascadeTolerance = cascadeTolerance;
+
+		auto loadStartTime = std::chrono::high_resolution_clock::now();
+		if (!ImageProcessor::LoadFeaturesFromFile(commandLine.arguments[0])) {
+			std::cerr << "Failed to load features from: " << commandLine.arguments[0] << std::endl;
+			return 1;
+		}
+		report.Add("load_ms", MillisecondsSince(loadStartTime));
+		report.Add("images", ImageProcessor::m_FeatureMatrix.GetImageCount());
+		report.Add("contours", ImageProcessor::m_FeatureMatrix.GetContourCount());
+		report.Add("compression", QuantizedMatrix::GetName(ImageProcessor::m_FeatureCompression));
+		report.Add("compressed_bytes", ImageProcessor::m_CompressedFeatures.GetByteSize());
+		report.Add("cascade_tolerance", cascadeTolerance);
+		if (cascadeTolerance < 1.0 && !ImageProcessor::m_FeatureMatrix.GetDescriptors())
+			std::cerr << "The feature store has no shape descriptors, re-extract it to use --cascade." << std::endl;
+
+		if (commandLine.options.count("--approximate")) {
+			auto indexStartTime = std::chrono::high_resolution_clock::now();
+			ImageProcessor::m_UseApproximateIndex = true;
+			if (!ImageProcessor::UpdateApproximateIndex()) {
+				std::cerr << "Failed to build the approximate index." << std::endl;
+				return 1;
+			}
+			ImageProcessor::m_ApproximateIndex.SetSearchEf(static_cast<uint32_t>(ef));
+			report.Add("index_ms", MillisecondsSince(indexStartTime));
+		}
+
+		if (commandLine.options.count("--clusters")) {
+			auto clusterStartTime = std::chrono::high_resolution_clock::now();
+			ClusterParameters parameters;
+			parameters.clusterCount = static_cast<uint32_t>(clusterCount);
+			parameters.probeCount = static_cast<uint32_t>(std::max(1, probeCount));
+			ImageProcessor::m_ClusterIndex.Reset(parameters);
+			ImageProcessor::m_UseClusterIndex = true;
+			if (!ImageProcessor::UpdateClusterIndex()) {
+				std::cerr << "Failed to build the cluster index." << std::endl;
+				return 1;
+			}
+			report.Add("clusters", ImageProcessor::m_ClusterIndex.GetClusterCount());
+			report.Add("cluster_index_ms", MillisecondsSince(clusterStartTime));
+		}
+
+		// Cross-dataset: the first store and every listed one become shards of m_Datasets
+		auto datasetsOption = commandLine.options.find("--datasets");
+		bool crossDataset = datasetsOption != commandLine.options.end();
+		if (crossDataset) {
+			auto datasetsStartTime = std::chrono::high_resolution_clock::now();
+
+			std::vector<std::string> storePaths = { commandLine.arguments[0] };
+			std::stringstream datasets(datasetsOption->second);
+			std::string storePath;
+			while (std::getline(datasets, storePath, ','))
+				storePaths.push_back(storePath);
+
+			for (const std::string& path : storePaths) {
+				// Datasets in same-named directories are told apart by their position
+				std::string name = ShardedIndex::GetDatasetName(path);
+				for (size_t shard = 0; shard < ImageProcessor::m_Datasets.GetShardCount(); ++shard) {
+					if (ImageProcessor::m_Datasets.GetShardName(shard) == name)
+						name += "#" + std::to_string(ImageProcessor::m_Datasets.GetShardCount());
+				}
+
+				if (!ImageProcessor::m_Datasets.AddShard(name, path, ImageProcessor::m_UseApproximateIndex))
+					return 1;
+			}
+
+			ImageProcessor::m_Datasets.SetSearchEf(static_cast<uint32_t>(ef));
+			report.Add("datasets", ImageProcessor::m_Datasets.GetShardCount());
+			report.Add("datasets_ms", MillisecondsSince(datasetsStartTime));
+		}
+
+		// Queries are stored by file stem, so both "name" and "path/to/name.jpg" are accepted
+		std::vector<std::string> queryNames;
+		for (size_t i = 1; i < commandLine.arguments.size(); ++i)
+			queryNames.push_back(fs::path(commandLine.arguments[i]).stem().string());
+
+		auto queryStartTime = std::chrono::high_resolution_clock::now();
+		bool excludeSelf = commandLine.options.count("--exclude-self") != 0;
+		std::vector<std::vector<std::pair<std::string, double>>> results;
+		if (crossDataset) {
+			for (const std::string& queryName : queryNames) {
+				// The query image itself lives in the first shard
+				std::vector<std::pair<std::string, double>> matches;
+				for (const ShardMatch& match : ImageProcessor::RetrieveAcrossDatasets(queryName, topK + (excludeSelf ? 1 : 0))) {
+					if (excludeSelf && match.shard == 0 && match.image == queryName)
+						continue;
+					matches.push_back({ ImageProcessor::m_Datasets.GetShardName(match.shard) + "/" + match.image, match.distance });
+				}
+
+				if (matches.size() > static_cast<size_t>(topK))
+					matches.resize(static_cast<size_t>(topK));
+				results.push_back(std::move(matches));
+			}
+		}
+		else {
+			results = ImageProcessor::RetrieveImagesBatch(queryNames, topK, excludeSelf);
+		}
+		double queryElapsed = MillisecondsSince(queryStartTime);
+
+		report.Add("mode", ImageProcessor::m_UseApproximateIndex ? "approximate" : ImageProcessor::m_UseClusterIndex ? "clustered" : "exact");
+		report.Add("queries", queryNames.size());
+		report.Add("query_ms", queryElapsed);
+		report.Add("queries_per_second", queryElapsed > 0 ? queryNames.size() * 1000.0 / queryElapsed : 0.0);
+
+		bool missing = false;
+		for (size_t i = 0; i < queryNames.size(); ++i) {
+			report.AddMatches(queryNames[i], results[i]);
+			missing |= ImageProcessor::m_FeatureMatrix.FindImage(queryNames[i]) == FeatureMatrix::NotFound;
+		}
+
+		return missing ? 1 : 0;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	CommandLine commandLine;
+	if (!ParseCommandLine(argc, argv, commandLine)) {
+		PrintUsage();
+		return 2;
+	}
+
+	int threads = 0;
+	if (!ParseCount(commandLine, "--threads", 0, threads)) {
+		PrintUsage();
+		return 2;
+	}
+	ImageProcessor::m_WorkerCount = static_cast<unsigned int>(threads);
+
+	ReportFormat format = ReportFormat::Text;
+	auto formatOption = commandLine.options.find("--format");
+	if (formatOption != commandLine.options.end()) {
+		if (formatOption->second == "json")
+			format = ReportFormat::Json;
+		else if (formatOption->second != "text") {
+			std::cerr << "Unknown format: " << formatOption->second << std::endl;
+			return 2;
+		}
+	}
+
+	auto intermediateOption = commandLine.options.find("--intermediate");
+	if (intermediateOption != commandLine.options.end()) {
+		if (intermediateOption->second == "jpg")
+			ImageProcessor::m_IntermediateExtension = ".jpg";
+		else if (intermediateOption->second != "ssm") {
+			std::cerr << "Unknown intermediate format: " << intermediateOption->second << std::endl;
+			return 2;
+		}
+	}
+
+	auto profileOption = commandLine.options.find("--profile");
+	bool profile = profileOption != commandLine.options.end();
+	Profiler::SetEnabled(profile);
+
+	ReportWriter report(format);
+	report.Add("command", commandLine.command);
+	report.Add("threads", static_cast<size_t>(BatchExecutor::ResolveWorkerCount(ImageProcessor::m_WorkerCount)));
+
+	auto startTime = std::chrono::high_resolution_clock::now();
+	int result = -1;
+
+	if (commandLine.command == "convert")
+		result = RunConvert(commandLine, report);
+	else if (commandLine.command == "ingest")
+		result = RunIngest(commandLine, report);
+	else if (commandLine.command == "preprocess")
+		result = RunPreprocess(commandLine, report);
+	else if (commandLine.command == "extract")
+		result = RunExtract(commandLine, report);
+	else if (commandLine.command == "query")
+		result = RunQuery(commandLine, report);
+	else
+		std::cerr << "Unknown command: " << commandLine.command << std::endl;
+
+	if (result < 0) {
+		PrintUsage();
+		return 2;
+	}
+
+	report.Add("total_ms", MillisecondsSince(startTime));
+
+	if (profile) {
+		Profiler::SetEnabled(false);
+		report.AddStageStats("stages", Profiler::GetStats());
+		if (Profiler::WriteTrace(profileOption->second))
+			report.Add("trace", profileOption->second);
+	}
+
+	report.Print(std::cout);
+
+	return result;
+}
@@ -0,0 +1,151 @@
+#include "ReportWriter.h"
+
+#include <cmath>
+#include <cstdio>
+#include <sstream>
+
+namespace SyncShapes
+{
+	static std::string FormatNumber(double value)
+	{
+		char buffer[32];
+		std::snprintf(buffer, sizeof(buffer), "%.6g", value);
+		return buffer;
+	}
+
+	// JSON has no literal for infinities or NaN, degenerate Hu moments can produce them
+	static std::string FormatJsonNumber(double value)
+	{
+		return std::isfinite(value) ? FormatNumber(value) : "null";
+	}
+
+	ReportWriter::ReportWriter(ReportFormat format) : m_Format(format) {}
+	ReportWriter::~ReportWriter() {}
+
+	void ReportWriter::Add(const std::string& key, const std::string& value)
+	{
+		m_Fields.push_back({ key, value, "\"" + EscapeJson(value) + "\"" });
+	}
+
+	void ReportWriter::Add(const std::string& key, const char* value)
+	{
+		Add(key, std::string(value));
+	}
+
+	void ReportWriter::Add(const std::string& key, double value)
+	{
+		m_Fields.push_back({ key, FormatNumber(value), FormatJsonNumber(value) });
+	}
+
+	void ReportWriter::Add(const std::string& key, size_t value)
+	{
+		std::string number = std::to_string(value);
+		m_Fields.push_back({ key, number, number });
+	}
+
+	void ReportWriter::AddBatchReport(const std::string& key, const BatchReport& report)
+	{
+		std::ostringstream text;
+		std::ostringstream json;
+
+		text << report.succeeded << "/" << report.total << " files processed";
+		json << "{\"total\":" << report.total << ",\"succeeded\":" << report.succeeded << ",\"failures\":[";
+
+		for (size_t i = 0; i < report.failures.size(); ++i) {
+			const BatchFailure& failure = report.failures[i];
+			text << "\n  failed: " << failure.path << ": " << failure.reason;
+			json << (i ? "," : "") << "{\"path\":\"" << EscapeJson(failure.path) << "\",\"reason\":\"" << EscapeJson(failure.reason) << "\"}";
+		}
+		json << "]}";
+
+		m_Fields.push_back({ key, text.str(), json.str() });
+	}
+
+	void ReportWriter::AddStageStats(const std::string& key, const std::vector<StageStats>& stages)
+	{
+		std::ostringstream text;
+		std::ostringstream json;
+
+		text << stages.size() << " stages (count, mean/p50/p99/max us)";
+		json << "{";
+		for (size_t i = 0; i < stages.size(); ++i) {
+			const StageStats& stage = stages[i];
+			text << "\n  " << stage.name << ": " << stage.count << ", " << FormatNumber(stage.GetMeanMicroseconds()) << "/" << stage.GetPercentileMicroseconds(50)
+				<< "/" << stage.GetPercentileMicroseconds(99) << "/" << stage.maxMicroseconds;
+			json << (i ? "," : "") << "\"" << EscapeJson(stage.name) << "\":{\"count\":" << stage.count << ",\"total_us\":" << stage.totalMicroseconds
+				<< ",\"mean_us\":" << FormatJsonNumber(stage.GetMeanMicroseconds()) << ",\"p50_us\":" << stage.GetPercentileMicroseconds(50)
+				<< ",\"p99_us\":" << stage.GetPercentileMicroseconds(99) << ",\"max_us\":" << stage.maxMicroseconds << "}";
+		}
+		json << "}";
+
+		m_Fields.push_back({ key, text.str(), json.str() });
+	}
+
+	void ReportWriter::AddMatches(const std::string& query, const std::vector<std::pair<std::string, double>>& matches)
+	{
+		std::ostringstream text;
+		std::ostringstream json;
+
+		json << "[";
+		for (size_t i = 0; i < matches.size(); ++i) {
+			text << "\n  " << (i + 1) << ". " << matches[i].first << " " << FormatNumber(matches[i].second);
+			json << (i ? "," : "") << "{\"image\":\"" << EscapeJson(matches[i].first) << "\",\"distance\":" << FormatJsonNumber(matches[i].second) << "}";
+		}
+		json << "]";
+
+		m_Matches.push_back({ query, text.str(), json.str() });
+	}
+
+	void ReportWriter::Print(std::ostream& stream) const
+	{
+		if (m_Format == ReportFormat::Text) {
+			for (const Field& field : m_Fields)
+				stream << field.key << ": " << field.text << "\n";
+
+			for (const Field& match : m_Matches)
+				stream << "query " << match.key << ":" << match.text << "\n";
+
+			stream.flush();
+			return;
+		}
+
+		stream << "{";
+		for (size_t i = 0; i < m_Fields.size(); ++i)
+			stream << (i ? "," : "") << "\"" << EscapeJson(m_Fields[i].key) << "\":" << m_Fields[i].json;
+
+		if (!m_Matches.empty()) {
+			stream << (m_Fields.empty() ? "" : ",") << "\"results\":[";
+			for (size_t i = 0; i < m_Matches.size(); ++i)
+				stream << (i ? "," : "") << "{\"query\":\"" << EscapeJson(m_Matches[i].key) << "\",\"matches\":" << m_Matches[i].json << "}";
+			stream << "]";
+		}
+		stream << "}" << std::endl;
+	}
+
+	std::string ReportWriter::EscapeJson(const std::string& value)
+	{
+		std::string escaped;
+		escaped.reserve(value.size());
+
+		for (char c : value) {
+			switch (c) {
+			case '"': escaped += "\\\""; break;
+			case '\\': escaped += "\\\\"; break;
+			case '\n': escaped += "\\n"; break;
+			case '\r': escaped += "\\r"; break;
+			case '\t': escaped += "\\t"; break;
+			default:
+				if (static_cast<unsigned char>(c) < 0x20) {
+					char buffer[8];
+					std::snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+					escaped += buffer;
+				}
+				else {
+					escaped += c;
+				}
+			}
+		}
+
+		return escaped;
+	}
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "BatchExecutor/BatchExecutor.h"
+#include "Profiler/Profiler.h"
+
+namespace SyncShapes
+{
+	enum class ReportFormat
+	{
+		Text,
+		Json
+	};
+
+	// Collects the result of one command as ordered key/value fields and prints them either
+	// as "key: value" lines or as a single JSON object, so batch jobs can parse timings and counts
+	class ReportWriter
+	{
+	public:
+		explicit ReportWriter(ReportFormat format);
+		~ReportWriter();
+
+		void Add(const std::string& key, const std::string& value);
+		void Add(const std::string& key, const char* value);
+		void Add(const std::string& key, double value);
+		void Add(const std::string& key, size_t value);
+		void AddBatchReport(const std::string& key, const BatchReport& report);
+		void AddStageStats(const std::string& key, const std::vector<StageStats>& stages);
+		void AddMatches(const std::string& query, const std::vector<std::pair<std::string, double>>& matches);
+
+		void Print(std::ostream& stream) const;
+
+		static std::string EscapeJson(const std::string& value);
+	private:
+		struct Field
+		{
+			std::string key;
+			std::string text;
+			std::string json; // Already encoded JSON value
+		};
+
+		ReportFormat m_Format;
+		std::vector<Field> m_Fields;
+		std::vector<Field> m_Matches;
+	};
+}